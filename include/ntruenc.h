@@ -43,27 +43,98 @@
 #define NTRU_ERR_RANDOM		30
 /** The operation failed to find an inverse value. */
 #define NTRU_ERR_NO_INVERSE	31
+/** Failed to read or write a file. */
+#define NTRU_ERR_IO		40
+
+/* Encodings of messages/keys into NTRU vectors. */
+/** One bit per element: 0 -> -1 and 1 -> +1. */
+#define NTRU_MSG_BITS		0
+/** Three bits per two elements with each element one of -1, 0 or +1. */
+#define NTRU_MSG_TRITS		1
+
+/** The maximum number of encrypted values in a batch. */
+#define NTRU_BATCH_MAX		16
 
 typedef struct ntruenc_st NTRUENC;
+/** Batch of encrypted values stored for processing together. */
+typedef struct ntruenc_batch_st NTRUENC_BATCH;
+/** Immutable key prepared for use by many operation objects at once. */
+typedef struct ntruenc_prep_key_st NTRUENC_PREP_KEY;
 
+#ifndef NTRUENC_STATIC
 int NTRUENC_new(int strength, int flags, NTRUENC **ne);
+#endif
+int NTRUENC_get_obj_size(void);
 int NTRUENC_init(NTRUENC *ne, int strength, int flags);
 void NTRUENC_final(NTRUENC *ne);
+#ifndef NTRUENC_STATIC
 void NTRUENC_free(NTRUENC *ne);
+#endif
+int NTRUENC_set_format(NTRUENC *ne, int format);
+int NTRUENC_set_msg_format(NTRUENC *ne, int msg_format);
 
 int NTRUENC_encrypt_init(NTRUENC *ne, NTRUENC_PUB_KEY *pub);
+#ifndef NTRUENC_STATIC
+int NTRUENC_encrypt_init_prep(NTRUENC *ne, NTRUENC_PREP_KEY *prep);
+#endif
 int NTRUENC_encrypt(NTRUENC *ne, unsigned char *data, int len,
     unsigned char *enc, int elen);
+int NTRUENC_encrypt_ex(NTRUENC *ne, unsigned char *data, int len,
+    unsigned char *enc, int elen, unsigned char *seed, int slen);
+#ifndef NTRUENC_STATIC
+int NTRUENC_encrypt_precompute(NTRUENC *ne, int cnt);
+#endif
+int NTRUENC_encrypt_precomputed(NTRUENC *ne, int *cnt);
+#ifndef NTRUENC_STATIC
+int NTRUENC_encrypt_batch(NTRUENC *ne, unsigned char **data, int *len,
+    int cnt, NTRUENC_BATCH *batch);
+#endif
 void NTRUENC_encrypt_final(NTRUENC *ne);
 
 int NTRUENC_decrypt_init(NTRUENC *ne, NTRUENC_PRIV_KEY *priv);
+#ifndef NTRUENC_STATIC
+int NTRUENC_decrypt_init_prep(NTRUENC *ne, NTRUENC_PREP_KEY *prep);
+#endif
 int NTRUENC_decrypt(NTRUENC *ne, unsigned char *enc, int elen,
     unsigned char *data, int len, int *olen);
+#ifndef NTRUENC_STATIC
+int NTRUENC_decrypt_batch(NTRUENC *ne, NTRUENC_BATCH *batch,
+    unsigned char **data, int len, int *olen, int *err);
+#endif
 void NTRUENC_decrypt_final(NTRUENC *ne);
 
 int NTRUENC_keygen_init(NTRUENC *ne, NTRUENC_PARAMS *params);
 int NTRUENC_keygen(NTRUENC *ne, NTRUENC_PRIV_KEY **priv, NTRUENC_PUB_KEY **pub);
+int NTRUENC_keygen_ex(NTRUENC *ne, NTRUENC_PRIV_KEY **priv,
+    NTRUENC_PUB_KEY **pub, unsigned char *seed, int slen);
+int NTRUENC_keygen_from_seed(NTRUENC *ne, NTRUENC_PRIV_KEY **priv,
+    NTRUENC_PUB_KEY **pub, unsigned char *seed, int slen);
 void NTRUENC_keygen_final(NTRUENC *ne);
 
+#ifndef NTRUENC_STATIC
+int NTRUENC_BATCH_new(NTRUENC_PARAMS *params, NTRUENC_BATCH **batch);
+void NTRUENC_BATCH_free(NTRUENC_BATCH *batch);
+int NTRUENC_BATCH_num(NTRUENC_BATCH *batch);
+int NTRUENC_BATCH_load(NTRUENC_BATCH *batch, unsigned char **enc, int *elen,
+    int cnt);
+int NTRUENC_BATCH_store(NTRUENC_BATCH *batch, int format, unsigned char **enc,
+    int elen);
+#endif
+
+#ifndef NTRUENC_STATIC
+int NTRUENC_encrypt_oneshot(NTRUENC_PUB_KEY *pub, unsigned char *data,
+    int len, unsigned char *enc, int elen);
+int NTRUENC_decrypt_oneshot(NTRUENC_PRIV_KEY *priv, unsigned char *enc,
+    int elen, unsigned char *data, int len, int *olen);
+void NTRUENC_thread_cleanup(void);
+#endif
+
+#ifndef NTRUENC_STATIC
+int NTRUENC_PREP_KEY_new_priv(NTRUENC_PRIV_KEY *key, NTRUENC_PREP_KEY **prep);
+int NTRUENC_PREP_KEY_new_pub(NTRUENC_PUB_KEY *key, NTRUENC_PREP_KEY **prep);
+int NTRUENC_PREP_KEY_up_ref(NTRUENC_PREP_KEY *prep);
+void NTRUENC_PREP_KEY_free(NTRUENC_PREP_KEY *prep);
+#endif
+
 #endif
 
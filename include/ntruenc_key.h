@@ -24,6 +24,47 @@
 #ifndef NTRUENC_KEY_H
 #define NTRUENC_KEY_H
 
+/* Encoding formats of keys and encrypted data. */
+/** Legacy format: 12 bits per element and no header. */
+#define NTRU_FORMAT_12BITS	0
+/** Format byte followed by 11 bits per element - q is 2048. */
+#define NTRU_FORMAT_11BITS	1
+/**
+ * Private key only: format byte followed by F, where f = 1 + 3F, packed as
+ * 5 trits per byte.
+ */
+#define NTRU_FORMAT_TERNARY	2
+/**
+ * Private key only: format byte, attempt counter and the seed the key was
+ * generated from with NTRUENC_keygen_from_seed().
+ */
+#define NTRU_FORMAT_SEED	3
+
+/** The length in bytes of a seed for NTRUENC_keygen_from_seed(). */
+#define NTRU_KEY_SEED_LEN	32
+
+#ifdef NTRUENC_STATIC
+/*
+ * Static profile: objects hold the vectors in fixed size arrays and the
+ * library never allocates memory. The caller provides the storage of objects
+ * - get the size with NTRUENC_get_obj_size() and friends - and calls _init.
+ */
+#ifndef NTRUENC_STATIC_STRENGTH
+/** The largest security strength that objects have storage for. */
+#define NTRUENC_STATIC_STRENGTH	256
+#endif
+#if NTRUENC_STATIC_STRENGTH <= 112
+/** The number of elements in the vectors stored in objects. */
+#define NTRUENC_STATIC_N	401
+#elif NTRUENC_STATIC_STRENGTH <= 128
+#define NTRUENC_STATIC_N	439
+#elif NTRUENC_STATIC_STRENGTH <= 192
+#define NTRUENC_STATIC_N	593
+#else
+#define NTRUENC_STATIC_N	743
+#endif
+#endif
+
 /** Private key data type.  */
 typedef struct ntruenc_params_st NTRUENC_PARAMS;
 /** Private key data type.  */
@@ -33,26 +74,46 @@ typedef struct ntruenc_pub_key_st NTRUENC_PUB_KEY;
 
 int NTRUENC_PARAMS_get(short strength, NTRUENC_PARAMS **params);
 
+#ifndef NTRUENC_STATIC
 int NTRUENC_PRIV_KEY_new(NTRUENC_PARAMS *params, NTRUENC_PRIV_KEY **key);
+#endif
+int NTRUENC_PRIV_KEY_get_obj_size(void);
 int NTRUENC_PRIV_KEY_init(NTRUENC_PRIV_KEY *key, NTRUENC_PARAMS *params);
 void NTRUENC_PRIV_KEY_final(NTRUENC_PRIV_KEY *key);
+#ifndef NTRUENC_STATIC
 void NTRUENC_PRIV_KEY_free(NTRUENC_PRIV_KEY *key);
+#endif
 int NTRUENC_PRIV_KEY_num_entries(NTRUENC_PRIV_KEY *key, int *n);
 int NTRUENC_PRIV_KEY_get_len(NTRUENC_PRIV_KEY *key, int *len);
+int NTRUENC_PRIV_KEY_get_len_ex(NTRUENC_PRIV_KEY *key, int format, int *len);
 int NTRUENC_PRIV_KEY_encode(NTRUENC_PRIV_KEY *key, unsigned char *data,
     int len);
+int NTRUENC_PRIV_KEY_encode_ex(NTRUENC_PRIV_KEY *key, int format,
+    unsigned char *data, int len);
 int NTRUENC_PRIV_KEY_decode(NTRUENC_PRIV_KEY *key, unsigned char *data,
     int len);
 
+#ifndef NTRUENC_STATIC
 int NTRUENC_PUB_KEY_new(NTRUENC_PARAMS *params, NTRUENC_PUB_KEY **key);
+#endif
+int NTRUENC_PUB_KEY_get_obj_size(void);
 int NTRUENC_PUB_KEY_init(NTRUENC_PUB_KEY *key, NTRUENC_PARAMS *params);
 void NTRUENC_PUB_KEY_final(NTRUENC_PUB_KEY *key);
+#ifndef NTRUENC_STATIC
 void NTRUENC_PUB_KEY_free(NTRUENC_PUB_KEY *key);
+#endif
 int NTRUENC_PUB_KEY_num_entries(NTRUENC_PUB_KEY *key, int *n);
 int NTRUENC_PUB_KEY_get_enc_len(NTRUENC_PUB_KEY *key, int *len);
+int NTRUENC_PUB_KEY_get_enc_len_ex(NTRUENC_PUB_KEY *key, int format,
+    int *len);
 int NTRUENC_PUB_KEY_get_len(NTRUENC_PUB_KEY *key, int *len);
+int NTRUENC_PUB_KEY_get_len_ex(NTRUENC_PUB_KEY *key, int format, int *len);
 int NTRUENC_PUB_KEY_encode(NTRUENC_PUB_KEY *key, unsigned char *data, int len);
+int NTRUENC_PUB_KEY_encode_ex(NTRUENC_PUB_KEY *key, int format,
+    unsigned char *data, int len);
 int NTRUENC_PUB_KEY_decode(NTRUENC_PUB_KEY *key, unsigned char *data, int len);
+int NTRUENC_PUB_KEY_set_packed(NTRUENC_PUB_KEY *key, unsigned char *data,
+    int len);
 
 #endif
 
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#ifndef NTRUENC_STORE_H
+#define NTRUENC_STORE_H
+
+#include "ntruenc_key.h"
+
+/** The length in bytes of a public key identifier. */
+#define NTRU_KEY_ID_LEN		32
+
+typedef struct ntruenc_store_st NTRUENC_STORE;
+
+int NTRUENC_PUB_KEY_get_id(NTRUENC_PUB_KEY *key, unsigned char *id, int len);
+
+int NTRUENC_STORE_write(const char *filename, NTRUENC_PUB_KEY **keys,
+    unsigned char *ids, int cnt);
+int NTRUENC_STORE_open(const char *filename, NTRUENC_STORE **store);
+void NTRUENC_STORE_close(NTRUENC_STORE *store);
+int NTRUENC_STORE_get_params(NTRUENC_STORE *store, NTRUENC_PARAMS **params);
+int NTRUENC_STORE_num_keys(NTRUENC_STORE *store, int *cnt);
+int NTRUENC_STORE_get_key(NTRUENC_STORE *store, unsigned char *id, int len,
+    NTRUENC_PUB_KEY *key);
+
+#endif
+
@@ -285,6 +285,16 @@ class GCC_X86_64 <X86_64
   def set_value(size, val)
     puts "\t.value #{val}"
   end
+  def start_rodata()
+    puts "\t.section\t.rodata"
+    puts "\t.align 64"
+  end
+  def set_quad(val)
+    puts "\t.quad #{val}"
+  end
+  def file_done()
+    puts "\t.section\t.note.GNU-stack,\"\",@progbits"
+  end
 end
 
 class MacOSX_X86_64 <GCC_X86_64
@@ -332,4 +342,10 @@ class MacOSX_X86_64 <GCC_X86_64
   def set_value(size, val)
     puts "\t.value #{val}"
   end
+  def start_rodata()
+    puts "\t.section\t__TEXT,__const"
+    puts "\t.p2align 6"
+  end
+  def file_done()
+  end
 end
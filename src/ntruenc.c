@@ -26,9 +26,7 @@
 #include "ntruenc_lcl.h"
 #include "ntruenc_key_lcl.h"
 
-static unsigned char data_dec_data[3] = { 0, 1, 1 };
-static unsigned char *data_dec = &data_dec_data[1];
-
+#ifndef NTRUENC_STATIC
 /**
  * Create a new NTRU Encryption operation object.
  *
@@ -39,6 +37,7 @@ static unsigned char *data_dec = &data_dec_data[1];
  * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
  *          NTRU_ERR_ALLOC on failure to allocate memory.<br>
  *          NTRU_ERR_NOT_FOUND when no matching implementation available.<br>
+ *          NTRU_ERR_RANDOM when the random number generator fails.<br>
  *          0 otherwise.
  */
 int NTRUENC_new(int strength, int flags, NTRUENC **ne)
@@ -69,6 +68,101 @@ end:
     NTRUENC_free(n);
     return ret;
 }
+#endif
+
+/**
+ * Get the size of the NTRU Encryption operation object.
+ * Use to provide the storage of an object to NTRUENC_init().
+ *
+ * @return  The size of the object in bytes.
+ */
+int NTRUENC_get_obj_size(void)
+{
+    return sizeof(NTRUENC);
+}
+
+/**
+ * Allocate the arena holding the vectors of all operations.
+ * Sized for the largest of encryption, decryption and key generation with
+ * the parameters of the implementation, so that the init and final calls of
+ * operations never allocate. Vectors are bound at padded offsets so that
+ * each one is aligned to a cache line.
+ * With NTRUENC_STATIC, the arena is bound into the storage of the object.
+ *
+ * @param [in] ne  The NTRU Encryption operation object.
+ * @return  NTRU_ERR_NOT_FOUND when no parameters for the implementation or,
+ *          with NTRUENC_STATIC, the storage of the object is too small.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate memory.<br>
+ *          0 otherwise.
+ */
+static int ntruenc_arena_alloc(NTRUENC *ne)
+{
+    int ret;
+    NTRUENC_PARAMS *params;
+    int num;
+
+    ret = NTRUENC_PARAMS_get(ne->meths->strength, &params);
+    if (ret != 0)
+        goto end;
+
+    /* Encryption: m, enc, temporary and an unpacked public key. */
+    num = 2 + ne->meths->enc_num + 1;
+    /* Decryption: m, enc and temporary. */
+    if (num < 2 + ne->meths->dec_num)
+        num = 2 + ne->meths->dec_num;
+    if (num < ne->meths->keygen_num)
+        num = ne->meths->keygen_num;
+
+    ne->arena_n = params->n;
+    ne->arena_len = num * NTRU_VEC_LEN(params->n) * sizeof(short);
+#ifndef NTRUENC_STATIC
+    ne->arena_mem = malloc(ne->arena_len + NTRU_VEC_ALIGN - 1);
+    if (ne->arena_mem == NULL)
+    {
+        ret = NTRU_ERR_ALLOC;
+        goto end;
+    }
+#else
+    if ((num > NTRU_STATIC_ARENA_NUM) || (params->n > NTRUENC_STATIC_N))
+    {
+        ret = NTRU_ERR_NOT_FOUND;
+        goto end;
+    }
+    ne->arena_mem = ne->arena_data;
+#endif
+    ne->arena = NTRU_VEC_ALIGN_PTR(ne->arena_mem);
+    /* Padding of vectors is zero. */
+    memset(ne->arena, 0, ne->arena_len);
+end:
+    return ret;
+}
+
+/**
+ * Zeroize the arena as it may hold secret values and unbind the vectors.
+ *
+ * @param [in] ne  The NTRU Encryption operation object.
+ */
+static void ntruenc_arena_clear(NTRUENC *ne)
+{
+    if (ne->arena != NULL)
+        memset(ne->arena, 0, ne->arena_len);
+    ne->m = NULL;
+    ne->enc = NULL;
+    ne->t = NULL;
+}
+
+/**
+ * Release the reference to the prepared key held by the operation.
+ *
+ * @param [in] ne  The NTRU Encryption operation object.
+ */
+static void ntruenc_prep_release(NTRUENC *ne)
+{
+#ifndef NTRUENC_STATIC
+    NTRUENC_PREP_KEY_free(ne->prep);
+#endif
+    ne->prep = NULL;
+}
 
 /**
  * Initialize an empty NTRU Encryption operation object.
@@ -79,6 +173,8 @@ end:
  *                       implementation.
  * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
  *          NTRU_ERR_NOT_FOUND when no matching implementation available.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate memory.<br>
+ *          NTRU_ERR_RANDOM when the random number generator fails.<br>
  *          0 otherwise.
  */
 int NTRUENC_init(NTRUENC *ne, int strength, int flags)
@@ -94,10 +190,100 @@ int NTRUENC_init(NTRUENC *ne, int strength, int flags)
     memset(ne, 0, sizeof(*ne));
 
     ret = ntruenc_meths_get(strength, flags, &ne->meths);
+    if (ret != 0)
+        goto end;
+
+    ret = ntruenc_arena_alloc(ne);
+    if (ret != 0)
+        goto end;
+
+    if (ntru_drbg_init(&ne->drbg) != 0)
+        ret = NTRU_ERR_RANDOM;
+end:
+    return ret;
+}
+
+/**
+ * Set the format of the encrypted data output by encryption.
+ * Decryption accepts data in any supported format.
+ *
+ * @param [in] ne      The NTRU Encryption operation object.
+ * @param [in] format  The encoding format. e.g. NTRU_FORMAT_11BITS.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_BAD_DATA when the format is not supported.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_set_format(NTRUENC *ne, int format)
+{
+    int ret = 0;
+
+    if (ne == NULL)
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (ntruenc_pack_len(1, format) == 0)
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+
+    ne->format = format;
+end:
+    return ret;
+}
+
+/**
+ * Set the encoding of messages/keys into NTRU vectors.
+ * Trit encoding holds 3 bits in every 2 elements. Encryption and decryption
+ * must use the same encoding.
+ *
+ * @param [in] ne          The NTRU Encryption operation object.
+ * @param [in] msg_format  The encoding: NTRU_MSG_BITS or NTRU_MSG_TRITS.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_BAD_DATA when the encoding is not supported.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_set_msg_format(NTRUENC *ne, int msg_format)
+{
+    int ret = 0;
+
+    if (ne == NULL)
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+    if ((msg_format != NTRU_MSG_BITS) && (msg_format != NTRU_MSG_TRITS))
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+
+    ne->msg_format = msg_format;
 end:
     return ret;
 }
 
+/**
+ * Dispose of the precomputed blinding values.
+ * Unused values are zeroized as they are secret.
+ *
+ * @param [in] ne  The NTRU Encryption operation object.
+ */
+static void ntruenc_pre_clear(NTRUENC *ne)
+{
+    if (ne->pre != NULL)
+    {
+        memset(ne->pre, 0, ne->pre_max * ne->pre_n * sizeof(*ne->pre));
+#ifndef NTRUENC_STATIC
+        free(ne->pre);
+#endif
+        ne->pre = NULL;
+    }
+    ne->pre_cnt = 0;
+    ne->pre_max = 0;
+}
+
 /**
  * Finalize an NTRU Encryption operation object.
  *
@@ -105,8 +291,24 @@ end:
  */
 void NTRUENC_final(NTRUENC *ne)
 {
+    if (ne != NULL)
+    {
+        ntruenc_pre_clear(ne);
+        ntruenc_prep_release(ne);
+        ntru_drbg_final(&ne->drbg);
+        ntruenc_arena_clear(ne);
+        if (ne->arena_mem != NULL)
+        {
+#ifndef NTRUENC_STATIC
+            free(ne->arena_mem);
+#endif
+            ne->arena_mem = NULL;
+            ne->arena = NULL;
+        }
+    }
 }
 
+#ifndef NTRUENC_STATIC
 /**
  * Free memory associated with the NTRU Encryption operation object.
  *
@@ -120,336 +322,264 @@ void NTRUENC_free(NTRUENC *ne)
         free(ne);
     }
 }
+#endif
+
+/** The number of elements the length header is encoded into as trits. */
+#define NTRU_MSG_TRITS_HDR	12
 
 /**
  * Convert the message/key into an NTRU vector.
- * Each bit of the message/key becomes an element in the vector.
+ * The length of the message/key is encoded in 2 bytes before it.
+ * With bit encoding, each bit becomes an element in the vector.
  * 0 -> -1
  * 1 -> +1
+ * With trit encoding, every 3 bits become 2 elements of -1, 0 or +1.
+ * The remaining elements are zero.
  *
- * @param [in] data  The message/key data.
- * @param [in] len   The length of the message/key data in bytes.
- * @param [in] n     The number of elements in the vector.
- * @param [in] m     The NTRU vector.
+ * @param [in] data        The message/key data.
+ * @param [in] len         The length of the message/key data in bytes.
+ * @param [in] n           The number of elements in the vector.
+ * @param [in] msg_format  The encoding: NTRU_MSG_BITS or NTRU_MSG_TRITS.
+ * @param [in] m           The NTRU vector.
  * @return  NTRU_ERR_BAD_LEN if the message/key is too long to fit in the
  *          NTRU vector.<br>
  *          0 otherwise.
  */
-static int ntruenc_encode_msg(unsigned char *data, int len, int n, short *m)
+static int ntruenc_encode_msg(unsigned char *data, int len, int n,
+    int msg_format, short *m)
 {
     int ret = 0;
-    int i, j;
-#ifdef NTRU_BENDIAN
+    int mn;
     unsigned char l[2];
-#else
-    unsigned char *l = (unsigned char *)&len;
-#endif
-    int zlen;
 
-    if ((len + 2) * 8 > n)
+    if (msg_format == NTRU_MSG_TRITS)
+        mn = NTRU_MSG_TRITS_HDR + ntruenc_msg_trits_len(len);
+    else
+        mn = (len + 2) * 8;
+    if (mn > n)
     {
         ret = NTRU_ERR_BAD_LEN;
         goto end;
     }
-    zlen = (n - ((len + 2) * 8)) / 8;
 
-#ifdef NTRU_BENDIAN
     l[0] = (len     ) & 0xff;
     l[1] = (len >> 8) & 0xff;
-#endif
-    for (i=0; i<2; i++)
-    {
-        for (j=0; j<8; j++)
-            m[i*8+j] = (((l[i] >> j) & 1) << 1) - 1;
-    }
-    m += 2*8;
-    for (i=0; i<len; i++)
+    if (msg_format == NTRU_MSG_TRITS)
     {
-        for (j=0; j<8; j++)
-            m[i*8+j] = (((data[i] >> j) & 1) << 1) - 1;
+        ntruenc_msg_expand_trits(l, 2, m);
+        ntruenc_msg_expand_trits(data, len, m + NTRU_MSG_TRITS_HDR);
     }
-    m += len*8;
-    for (i=0; i<zlen; i++)
-    {
-        for (j=0; j<8; j++)
-            m[i*8+j] = 0;
-    }
-    m += zlen*8;
-    switch ((n - ((len + 2) * 8)) & 7)
+    else
     {
-    case 7:
-        m[6] = 0;
-    case 6:
-        m[5] = 0;
-    case 5:
-        m[4] = 0;
-    case 4:
-        m[3] = 0;
-    case 3:
-        m[2] = 0;
-    case 2:
-        m[1] = 0;
-    case 1:
-        m[0] = 0;
-    default:
-        break;
+        ntruenc_msg_expand(l, 2, m);
+        ntruenc_msg_expand(data, len, m + 2*8);
     }
-
+    memset(m + mn, 0, (n - mn) * sizeof(*m));
 end:
     return ret;
 }
 
 /**
  * Convert the NTRU vector into a message/key.
- * Each element of the NTRU vector becomes a bit in the message/key.
+ * The reverse of ntruenc_encode_msg().
+ * With bit encoding, each element of the NTRU vector becomes a bit.
  * -1 -> 0
  * +1 -> 1
+ * With trit encoding, every 2 elements become 3 bits.
+ * Constant time in the elements - every data element and padding element is
+ * checked. The encoded length is clamped to what fits without branching and
+ * the whole vector is scanned even when the length is invalid.
  *
- * @param [in]  m     The NTRU vector.
- * @param [in]  n     The number of elements in the vector.
- * @param [in]  data  The buffer for the message/key.
- * @param [in]  len   The length of the buffer in bytes.
- * @param [out] olen  The length of the data in bytes.
+ * @param [in]  m           The NTRU vector.
+ * @param [in]  n           The number of elements in the vector.
+ * @param [in]  msg_format  The encoding: NTRU_MSG_BITS or NTRU_MSG_TRITS.
+ * @param [in]  data        The buffer for the message/key.
+ * @param [in]  len         The length of the buffer in bytes.
+ * @param [out] olen        The length of the data in bytes.
  * @return  NTRU_ERR_BAD_DATA if the encoded length is too long for the
+ *          NTRU vector or the elements are not a valid encoding.<br>
  *          NTRU_ERR_BAD_LEN if the message/key is too long to fit in the
  *          buffer.<br>
  *          0 otherwise.
  */
-static int ntruenc_decode_msg(short *m, int n, unsigned char *data, int len,
-    int *olen)
+static int ntruenc_decode_msg(short *m, int n, int msg_format,
+    unsigned char *data, int len, int *olen)
 {
     int ret = 0;
-    int i, j;
-    short dlen;
-#ifdef NTRU_BENDIAN
+    int dlen, cap, clen;
+    int hn, mn;
     unsigned char l[2];
-#else
-    unsigned char *l = (unsigned char *)&dlen;
-#endif
-    short *zero = NULL;
-    int zlen;
-    char r = 0;
+    int r;
+    int bad_data, bad_len;
 
-    for (i=0; i<2; i++)
+    if (msg_format == NTRU_MSG_TRITS)
     {
-        l[i] = data_dec[m[(i*8)+0]];
-        for (j=1; j<8; j++)
-            l[i] |= data_dec[m[(i*8)+j]] << j;
+        r = ntruenc_msg_compact_trits(m, 2, l);
+        hn = NTRU_MSG_TRITS_HDR;
     }
-#ifdef NTRU_BENDIAN
-    dlen = l[0] | ((short)l[1]) << 8;
-#endif
+    else
+    {
+        r = 0;
+        ntruenc_msg_compact(m, 2, l);
+        hn = 2*8;
+    }
+    dlen = l[0] | ((int)l[1] << 8);
 
     *olen = dlen;
     if (data == NULL)
         goto end;
 
-    if ((dlen + 2) * 8 > n)
-    {
-        ret = NTRU_ERR_BAD_DATA;
-        dlen = n-10;
-    }
+    /* Most bytes that fit in the vector after the header. */
+    if (msg_format == NTRU_MSG_TRITS)
+        cap = (3 * ((n - hn) / 2)) / 8;
+    else
+        cap = (n - hn) / 8;
+    /* All ones when the length is too long. */
+    bad_data = (cap - dlen) >> 31;
+    bad_len = (len - dlen) >> 31;
+
+    /* Clamp the length to the vector and the buffer. */
+    clen = dlen + ((cap - dlen) & bad_data);
+    clen = clen + ((len - clen) & ((len - clen) >> 31));
+    if (msg_format == NTRU_MSG_TRITS)
+        mn = hn + ntruenc_msg_trits_len(clen);
+    else
+        mn = hn + clen * 8;
 
-    zlen = (n - (dlen + 2) * 8) / 8;
-    zero = malloc(zlen * sizeof(*zero));
-    if (zero == NULL)
-    {
-        ret = NTRU_ERR_ALLOC;
-        goto end;
-    }
+    /* Check all data elements are valid and all padding is zero. */
+    if (msg_format == NTRU_MSG_TRITS)
+        r |= ntruenc_msg_compact_trits(m + hn, clen, data);
+    else
+        r |= ntruenc_msg_compact(m + hn, clen, data);
+    r |= ntruenc_msg_or(m + mn, n - mn);
 
-    m += 2*8;
-    for (i=0; i<dlen; i++)
-    {
-        r |= m[(i*8)+0] == 0;
-        data[i] = data_dec[m[(i*8)+0]];
-        for (j=1; j<8; j++)
-        {
-            r |= m[(i*8)+j] == 0;
-            data[i] |= data_dec[m[(i*8)+j]] << j;
-        }
-    }
-    m += dlen*8;
-    for (i=0; i<zlen; i++)
-    {
-        r |= m[(i*8)+0] != 0;
-        zero[i] = data_dec[m[(i*8)+0]];
-        for (j=1; j<8; j++)
-        {
-            r |= m[(i*8)+j] != 0;
-            zero[i] |= data_dec[m[(i*8)+j]] << j;
-        }
-    }
-    m += zlen*8;
-    switch ((n - ((dlen + 2) * 8)) & 7)
-    {
-    case 7:
-        r |= m[6] != 0;
-    case 6:
-        r |= m[5] != 0;
-    case 5:
-        r |= m[4] != 0;
-    case 4:
-        r |= m[3] != 0;
-    case 3:
-        r |= m[2] != 0;
-    case 2:
-        r |= m[1] != 0;
-    case 1:
-        r |= m[0] != 0;
-    default:
-        break;
-    }
-
-    if (r)
+    /* Length not fitting in the vector is invalid data. */
+    r |= bad_data;
+    if ((bad_len & ~bad_data) != 0)
+        ret = NTRU_ERR_BAD_LEN;
+    else if (r)
         ret = NTRU_ERR_BAD_DATA;
 end:
-    if (zero != NULL) free(zero);
     return ret;
 }
 
 /**
- * Convert the encrypted data as an NTRU vector into a packed buffer.
- * Each entry has 12-bits of data.
+ * Initialize the encryption operation.
+ * The vectors are bound into the arena - no memory is allocated.
+ * The public key is unpacked into temporary data when it references packed
+ * data.
  *
- * @param [in] enc   The encrypted data as an NTRU vector.
- * @param [in] n     The number of elements in the NTRU vector.
- * @param [in] data  The encrypted data buffer.
- * @param [in] len   The length of the buffer in bytes.
- * @return  NTRU_ERR_BAD_LEN if the buffer is too small to hold the
- *          encrypted data.<br>
- *          0 otherwise.
+ * @param [in] ne    The NTRU Encryption operation object.
+ * @param [in] priv  Private key.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_BAD_DATA when the public key has no value, is for
+ *          larger parameters or the packed data is invalid.<br>
+ *          0 otheriwise.
  */
-static int ntruenc_encode_encrypted(short *enc, int n, unsigned char *data,
-    int len)
+int NTRUENC_encrypt_init(NTRUENC *ne, NTRUENC_PUB_KEY *pub)
 {
     int ret = 0;
-    int i, j;
+    int n;
 
-    if (len < (n*12+7)/8)
+    if ((ne == NULL) || (pub == NULL))
     {
-        ret = NTRU_ERR_BAD_LEN;
+        ret = NTRU_ERR_PARAM_NULL;
         goto end;
     }
 
-    for (i=0,j=0; i<(n/2)*2; i+=2,j+=3)
-    {
-        data[j+0] =                             ((enc[i+0]        ) << 0);
-        data[j+1] = ((enc[i+0] & 0xf00) >> 8) | ((enc[i+1] & 0x00f) << 4);
-        data[j+2] = ((enc[i+1] & 0xff0) >> 4)                            ;
-    }
-    if (i < n)
-    {
-        data[j+0] =                             ((enc[i+0] & 0x0ff) << 0);
-        data[j+1] = ((enc[i+0] & 0xf00) >> 8)                            ;
-    }
-
-end:
-    return ret;
-}
-
-/**
- * Convert the packed buffer encrypted data into an NTRU vector.
- * Each entry is 12-bits of data.
- *
- * @param [in] data  The signature buffer.
- * @param [in] len   The length of the buffer in bytes.
- * @param [in] n     The number of elements in the NTRU vector.
- * @param [in] enc   The signature as NTRU vectors.
- * @return  NTRU_ERR_BAD_LEN if the buffer is too small to hold the
- *          signature.<br>
- *          0 otherwise.
- */
-static int ntruenc_decode_encrypted(unsigned char *data, int len, int n,
-    short *enc)
-{
-    int ret = 0;
-    int i, j;
+    /* Precomputed blinding values are only valid for one public key. */
+    ntruenc_pre_clear(ne);
+    ntruenc_prep_release(ne);
 
-    if (len < (n*12+7)/8)
+    n = pub->params->n;
+    if (((pub->h == NULL) && (pub->packed == NULL)) || (n > ne->arena_n))
     {
-        ret = NTRU_ERR_BAD_LEN;
+        ret = NTRU_ERR_BAD_DATA;
         goto end;
     }
 
-    for (i=0,j=0; i<(n/2)*2; i+=2,j+=3)
+    ne->m = ne->arena;
+    ne->enc = ne->m + NTRU_VEC_LEN(n);
+    ne->t = ne->enc + NTRU_VEC_LEN(n);
+
+    if (pub->h != NULL)
+        ne->h = pub->h;
+    else
     {
-        enc[i+0] = ((data[j+0]       ) >> 0) | ((short)(data[j+1] & 0x0f) << 8);
-        enc[i+1] = ((data[j+1] & 0xf0) >> 4) | ((short)(data[j+2]       ) << 4);
+        ne->h = ne->t + ne->meths->enc_num * NTRU_VEC_LEN(n);
+        ret = ntruenc_unpack(pub->packed, pub->packed_len, n, ne->h);
+        if (ret != 0)
+            goto end;
     }
-    if (i < n)
-        enc[i+0] = ((data[j+0]       ) >> 0) | ((short)(data[j+1] & 0x0f) << 8);
 
+    ne->pub = pub;
 end:
+    if ((ret != 0) && (ne != NULL))
+    {
+        ne->pub = NULL;
+        ne->h = NULL;
+        ntruenc_arena_clear(ne);
+    }
     return ret;
 }
 
+#ifndef NTRUENC_STATIC
 /**
- * Initialize memory for the encryption operation.
- * Allocate memory if required.
+ * Initialize the encryption operation with a prepared public key.
+ * The operation holds a reference to the prepared key until
+ * NTRUENC_encrypt_final() is called. Nothing is copied or unpacked.
  *
  * @param [in] ne    The NTRU Encryption operation object.
- * @param [in] priv  Private key.
+ * @param [in] prep  The prepared public key.
  * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
- *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          NTRU_ERR_BAD_DATA when not a prepared public key or the key is
+ *          for larger parameters.<br>
  *          0 otheriwise.
  */
-int NTRUENC_encrypt_init(NTRUENC *ne, NTRUENC_PUB_KEY *pub)
+int NTRUENC_encrypt_init_prep(NTRUENC *ne, NTRUENC_PREP_KEY *prep)
 {
-    int ret = 0;
+    int ret;
 
-    if ((ne == NULL) || (pub == NULL))
+    if ((ne == NULL) || (prep == NULL))
     {
         ret = NTRU_ERR_PARAM_NULL;
         goto end;
     }
-
-    ne->m = malloc(pub->params->n * sizeof(*ne->m));
-    ne->enc = malloc(pub->params->n * sizeof(*ne->enc));
-    if ((ne->m == NULL) || (ne->enc == NULL))
+    if (prep->pub.h == NULL)
     {
-        ret = NTRU_ERR_ALLOC;
+        ret = NTRU_ERR_BAD_DATA;
         goto end;
     }
 
-    if (ne->meths->enc_num > 0)
-    {
-        ne->t = malloc(pub->params->n * sizeof(short) * ne->meths->enc_num);
-        if (ne->t == NULL)
-        {
-            ret = NTRU_ERR_ALLOC;
-            goto end;
-        }
-    }
-
-    ne->pub = pub;
+    ret = NTRUENC_encrypt_init(ne, &prep->pub);
+    if (ret != 0)
+        goto end;
+    NTRUENC_PREP_KEY_up_ref(prep);
+    ne->prep = prep;
 end:
-    if (ret == NTRU_ERR_ALLOC)
-    {
-        if (ne->t != NULL) { free(ne->t); ne->t = NULL; }
-        if (ne->enc != NULL) { free(ne->enc); ne->enc = NULL; }
-        if (ne->m != NULL) { free(ne->m); ne->m = NULL; }
-    }
     return ret;
 }
+#endif
 
 /**
- * Perform the encryption operation.
- * Use the encryption function from the method table.
+ * Perform the encryption operation with the random number generator.
  *
  * @param [in] ne    The NTRU Encryption operation object.
  * @param [in] data  The encoded message or key to encrypt.
  * @param [in] len   The length of the encoded message or key.
  * @param [in] enc   The buffer to hold encrypted data.
  * @param [in] elen  The length of the buffer.
+ * @param [in] drbg  The random number generator to sample with.
+ * @param [in] b     The precomputed blinding value to use. NULL to generate
+ *                   one with drbg.
  * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
  *          NTRU_ERR_INIT when NTRU_encrypt_init() has not been called.<br>
- *          NTRU_ERR_ALLOC on failure to allocate.<br>
  *          NTRU_ERR_BAD_LEN when buffer is too short.<br>
+ *          NTRU_ERR_RANDOM when generating random fails.<br>
  *          0 otheriwise.
  */
-int NTRUENC_encrypt(NTRUENC *ne, unsigned char *data, int len,
-    unsigned char *enc, int elen)
+static int ntruenc_encrypt(NTRUENC *ne, unsigned char *data, int len,
+    unsigned char *enc, int elen, NTRU_DRBG *drbg, short *b)
 {
     int ret;
 
@@ -464,83 +594,405 @@ int NTRUENC_encrypt(NTRUENC *ne, unsigned char *data, int len,
         goto end;
     }
 
-    ret = ntruenc_encode_msg(data, len, ne->pub->params->n, ne->m);
+    ret = ntruenc_encode_msg(data, len, ne->pub->params->n, ne->msg_format,
+        ne->m);
     if (ret != 0)
         goto end;
 
-    ret = ne->meths->enc(ne->enc, ne->m, ne->pub->h, ne->t);
-    if (ret != 0)
-        goto end;
+    if (b != NULL)
+        ne->meths->enc_blinded(ne->enc, ne->m, b);
+    else
+    {
+        ret = ne->meths->enc(ne->enc, ne->m, ne->h, ne->t, drbg);
+        if (ret != 0)
+            goto end;
+    }
 
-    ret = ntruenc_encode_encrypted(ne->enc, ne->pub->params->n, enc, elen);
+    ret = ntruenc_pack(ne->enc, ne->pub->params->n, ne->format, enc, elen);
 end:
     return ret;
 }
 
 /**
- * Cleanup the dynamic memory from encryption.
+ * Perform the encryption operation.
+ * Use the encryption function from the method table.
+ * When blinding values have been precomputed, one is taken off the queue,
+ * used and zeroized.
  *
- * @param [in] ne  The NTRU Encryption operation object.
+ * @param [in] ne    The NTRU Encryption operation object.
+ * @param [in] data  The encoded message or key to encrypt.
+ * @param [in] len   The length of the encoded message or key.
+ * @param [in] enc   The buffer to hold encrypted data.
+ * @param [in] elen  The length of the buffer.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_INIT when NTRU_encrypt_init() has not been called.<br>
+ *          NTRU_ERR_BAD_LEN when buffer is too short.<br>
+ *          NTRU_ERR_RANDOM when generating random fails.<br>
+ *          0 otheriwise.
  */
-void NTRUENC_encrypt_final(NTRUENC *ne)
+int NTRUENC_encrypt(NTRUENC *ne, unsigned char *data, int len,
+    unsigned char *enc, int elen)
 {
-    if (ne != NULL)
-    {
-        ne->pub = NULL;
-        if (ne->t != NULL) { free(ne->t); ne->t = NULL; }
-        if (ne->enc != NULL) { free(ne->enc); ne->enc = NULL; }
-        if (ne->m != NULL) { free(ne->m); ne->m = NULL; }
-    }
+    int ret;
+    short *b;
+
+    if (ne == NULL)
+        return NTRU_ERR_PARAM_NULL;
+    if (ne->pre_cnt == 0)
+        return ntruenc_encrypt(ne, data, len, enc, elen, &ne->drbg, NULL);
+
+    /* Remove from queue before use so that it is never used twice. */
+    ne->pre_cnt--;
+    b = ne->pre + ne->pre_cnt * ne->pre_n;
+    ret = ntruenc_encrypt(ne, data, len, enc, elen, NULL, b);
+    memset(b, 0, ne->pre_n * sizeof(*b));
+
+    return ret;
 }
 
+#ifndef NTRUENC_STATIC
 /**
- * Initialize memory for the decryption operation.
- * Allocate memory if required.
+ * Precompute blinding values for encryption with the public key.
+ * The blinding value is the costly part of encryption and doesn't depend on
+ * the message. With precomputed values, NTRUENC_encrypt() only adds in the
+ * message. Call during idle time - not at the same time as other operations
+ * on the object.
+ * Values are discarded when NTRUENC_encrypt_final() is called.
  *
- * @param [in] ne    The NTRU Encryption operation object.
- * @param [in] priv  Private key.
+ * @param [in] ne   The NTRU Encryption operation object.
+ * @param [in] cnt  The number of blinding values to add to the queue.
  * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_INIT when NTRU_encrypt_init() has not been called.<br>
+ *          NTRU_ERR_BAD_LEN when the count is negative.<br>
  *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          NTRU_ERR_RANDOM when generating random fails.<br>
  *          0 otheriwise.
  */
-int NTRUENC_decrypt_init(NTRUENC *ne, NTRUENC_PRIV_KEY *priv)
+int NTRUENC_encrypt_precompute(NTRUENC *ne, int cnt)
 {
     int ret = 0;
+    int i;
+    int n;
+    short *p;
 
-    if ((ne == NULL) || (priv == NULL))
+    if (ne == NULL)
     {
         ret = NTRU_ERR_PARAM_NULL;
         goto end;
     }
-
-    ne->m = malloc(priv->params->n * sizeof(*ne->m));
-    ne->enc = malloc(priv->params->n * sizeof(*ne->enc));
-    if ((ne->m == NULL) || (ne->enc == NULL))
+    if (ne->pub == NULL)
     {
-        ret = NTRU_ERR_ALLOC;
+        ret = NTRU_ERR_INIT;
+        goto end;
+    }
+    if (cnt < 0)
+    {
+        ret = NTRU_ERR_BAD_LEN;
         goto end;
     }
+    n = NTRU_VEC_LEN(ne->pub->params->n);
 
-    if (ne->meths->enc_num > 0)
+    if (ne->pre_cnt + cnt > ne->pre_max)
     {
-        ne->t = malloc(priv->params->n * sizeof(short) * ne->meths->enc_num);
-        if (ne->t == NULL)
+        /* Not realloc() so that the old buffer can be zeroized. */
+        p = ntruenc_vec_alloc(n, ne->pre_cnt + cnt);
+        if (p == NULL)
         {
             ret = NTRU_ERR_ALLOC;
             goto end;
         }
+        if (ne->pre != NULL)
+        {
+            memcpy(p, ne->pre, ne->pre_cnt * n * sizeof(*p));
+            memset(ne->pre, 0, ne->pre_max * n * sizeof(*p));
+            free(ne->pre);
+        }
+        ne->pre = p;
+        ne->pre_max = ne->pre_cnt + cnt;
+        ne->pre_n = n;
+    }
+
+    for (i=0; i<cnt; i++)
+    {
+        ret = ne->meths->blind(ne->pre + ne->pre_cnt * n, ne->h, ne->t,
+            &ne->drbg);
+        if (ret != 0)
+            goto end;
+        ne->pre_cnt++;
+    }
+end:
+    return ret;
+}
+#endif
+
+/**
+ * Get the number of precomputed blinding values not yet used.
+ *
+ * @param [in]  ne   The NTRU Encryption operation object.
+ * @param [out] cnt  The number of precomputed blinding values.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          0 otheriwise.
+ */
+int NTRUENC_encrypt_precomputed(NTRUENC *ne, int *cnt)
+{
+    if ((ne == NULL) || (cnt == NULL))
+        return NTRU_ERR_PARAM_NULL;
+    *cnt = ne->pre_cnt;
+    return 0;
+}
+
+/**
+ * Perform the encryption operation deterministically.
+ * The random vector is expanded from the seed with SHAKE-256.
+ * The same seed, message and public key always give the same encrypted data.
+ * Never use a seed more than once with different messages.
+ *
+ * @param [in] ne    The NTRU Encryption operation object.
+ * @param [in] data  The encoded message or key to encrypt.
+ * @param [in] len   The length of the encoded message or key.
+ * @param [in] enc   The buffer to hold encrypted data.
+ * @param [in] elen  The length of the buffer.
+ * @param [in] seed  The seed data.
+ * @param [in] slen  The length of the seed data in bytes.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_INIT when NTRU_encrypt_init() has not been called.<br>
+ *          NTRU_ERR_BAD_LEN when buffer is too short.<br>
+ *          0 otheriwise.
+ */
+int NTRUENC_encrypt_ex(NTRUENC *ne, unsigned char *data, int len,
+    unsigned char *enc, int elen, unsigned char *seed, int slen)
+{
+    int ret;
+    NTRU_DRBG drbg;
+
+    if (seed == NULL)
+        return NTRU_ERR_PARAM_NULL;
+
+    ntru_drbg_seed(&drbg, seed, slen);
+    ret = ntruenc_encrypt(ne, data, len, enc, elen, &drbg, NULL);
+    ntru_drbg_final(&drbg);
+
+    return ret;
+}
+
+#ifndef NTRUENC_STATIC
+/**
+ * Allocate the working memory for a batch operation.
+ * The memory holds NTRU_BATCH_MAX vectors, a batch of n rows and the
+ * temporary rows for multiplication. Rows are aligned for SIMD operations.
+ *
+ * @param [in]  n    The number of elements in a vector.
+ * @param [out] mem  The allocated memory to free.
+ * @param [out] len  The length of the working memory in bytes.
+ * @return  NULL on failure to allocate.<br>
+ *          The aligned working memory otherwise.
+ */
+static short *ntruenc_batch_work_alloc(int n, void **mem, size_t *len)
+{
+    *len = (2*n + ntruenc_batch_mul_rows(n)) * NTRU_BATCH_MAX * sizeof(short);
+    *mem = malloc(*len + 63);
+    if (*mem == NULL)
+        return NULL;
+    return (short *)(((size_t)*mem + 63) & ~(size_t)63);
+}
+
+/**
+ * Encrypt a number of encoded messages or keys into a batch.
+ * The random vectors of all the encryptions are multiplied by the public
+ * value together using the batch layout.
+ * Precomputed blinding values are not used.
+ *
+ * @param [in] ne     The NTRU Encryption operation object.
+ * @param [in] data   The encoded messages or keys to encrypt.
+ * @param [in] len    The lengths of the encoded messages or keys.
+ * @param [in] cnt    The number of messages or keys: 1..NTRU_BATCH_MAX.
+ * @param [in] batch  The batch to hold the encrypted values.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_INIT when NTRU_encrypt_init() has not been called.<br>
+ *          NTRU_ERR_BAD_DATA when the batch is for different parameters.<br>
+ *          NTRU_ERR_BAD_LEN when the count is invalid or a message is too
+ *          long.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          NTRU_ERR_RANDOM when generating random fails.<br>
+ *          0 otheriwise.
+ */
+int NTRUENC_encrypt_batch(NTRUENC *ne, unsigned char **data, int *len,
+    int cnt, NTRUENC_BATCH *batch)
+{
+    int ret = 0;
+    int i, k, n, q;
+    void *mem = NULL;
+    size_t mlen = 0;
+    short *v = NULL, *m, *t;
+
+    if ((ne == NULL) || (data == NULL) || (len == NULL) || (batch == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (ne->pub == NULL)
+    {
+        ret = NTRU_ERR_INIT;
+        goto end;
+    }
+    n = ne->pub->params->n;
+    q = ne->pub->params->q;
+    if (batch->params->n != n)
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+    if ((cnt < 1) || (cnt > NTRU_BATCH_MAX))
+    {
+        ret = NTRU_ERR_BAD_LEN;
+        goto end;
     }
 
+    v = ntruenc_batch_work_alloc(n, &mem, &mlen);
+    if (v == NULL)
+    {
+        ret = NTRU_ERR_ALLOC;
+        goto end;
+    }
+    m = v + n * NTRU_BATCH_MAX;
+    t = m + n * NTRU_BATCH_MAX;
+    memset(v + cnt * n, 0, (NTRU_BATCH_MAX - cnt) * n * sizeof(*v));
+
+    /* Encode the messages/keys into the batch layout. */
+    for (k=0; k<cnt; k++)
+    {
+        if (data[k] == NULL)
+        {
+            ret = NTRU_ERR_PARAM_NULL;
+            goto end;
+        }
+        ret = ntruenc_encode_msg(data[k], len[k], n, ne->msg_format,
+            v + k * n);
+        if (ret != 0)
+            goto end;
+    }
+    ntruenc_batch_transpose(m, v, n, 0);
+
+    /* Random vectors for each encryption into the batch layout. */
+    for (k=0; k<cnt; k++)
+    {
+        ret = ne->meths->random(v + k * n, ne->pub->params->df,
+            ne->pub->params->df, 1, &ne->drbg);
+        if (ret != 0)
+            goto end;
+    }
+    ntruenc_batch_transpose(batch->c, v, n, 0);
+
+    /* e = r.h + m mod q for all encryptions at once. */
+    ntruenc_batch_mul_mod_q(batch->c, ne->h, batch->c, n, q, t);
+    for (i=0; i<n*NTRU_BATCH_MAX; i++)
+    {
+        batch->c[i] = (batch->c[i] + m[i]) & (q - 1);
+        batch->c[i] |= 0 - (batch->c[i] & (q >> 1));
+    }
+    batch->cnt = cnt;
+end:
+    if (mem != NULL)
+    {
+        memset(v, 0, mlen);
+        free(mem);
+    }
+    return ret;
+}
+#endif
+
+/**
+ * Cleanup the encryption operation.
+ * The arena is kept for the next operation.
+ *
+ * @param [in] ne  The NTRU Encryption operation object.
+ */
+void NTRUENC_encrypt_final(NTRUENC *ne)
+{
+    if (ne != NULL)
+    {
+        ntruenc_pre_clear(ne);
+        ntruenc_prep_release(ne);
+        ne->pub = NULL;
+        ne->h = NULL;
+        ntruenc_arena_clear(ne);
+    }
+}
+
+/**
+ * Initialize the decryption operation.
+ * The vectors are bound into the arena - no memory is allocated.
+ *
+ * @param [in] ne    The NTRU Encryption operation object.
+ * @param [in] priv  Private key.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_BAD_DATA when the private key is for larger
+ *          parameters.<br>
+ *          0 otheriwise.
+ */
+int NTRUENC_decrypt_init(NTRUENC *ne, NTRUENC_PRIV_KEY *priv)
+{
+    int ret = 0;
+    int n;
+
+    if ((ne == NULL) || (priv == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+    ntruenc_prep_release(ne);
+    n = priv->params->n;
+    if (n > ne->arena_n)
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+
+    ne->m = ne->arena;
+    ne->enc = ne->m + NTRU_VEC_LEN(n);
+    ne->t = ne->enc + NTRU_VEC_LEN(n);
     ne->priv = priv;
 end:
-    if (ret == NTRU_ERR_ALLOC)
+    return ret;
+}
+
+#ifndef NTRUENC_STATIC
+/**
+ * Initialize the decryption operation with a prepared private key.
+ * The operation holds a reference to the prepared key until
+ * NTRUENC_decrypt_final() is called. Nothing is copied.
+ *
+ * @param [in] ne    The NTRU Encryption operation object.
+ * @param [in] prep  The prepared private key.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_BAD_DATA when not a prepared private key or the key is
+ *          for larger parameters.<br>
+ *          0 otheriwise.
+ */
+int NTRUENC_decrypt_init_prep(NTRUENC *ne, NTRUENC_PREP_KEY *prep)
+{
+    int ret;
+
+    if ((ne == NULL) || (prep == NULL))
     {
-        if (ne->t != NULL) { free(ne->t); ne->t = NULL; }
-        if (ne->enc != NULL) { free(ne->enc); ne->enc = NULL; }
-        if (ne->m != NULL) { free(ne->m); ne->m = NULL; }
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
     }
+    if (prep->priv.f == NULL)
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+
+    ret = NTRUENC_decrypt_init(ne, &prep->priv);
+    if (ret != 0)
+        goto end;
+    NTRUENC_PREP_KEY_up_ref(prep);
+    ne->prep = prep;
+end:
     return ret;
 }
+#endif
 
 /**
  * Perform the decryption operation.
@@ -575,19 +1027,115 @@ int NTRUENC_decrypt(NTRUENC *ne, unsigned char *enc, int elen,
         goto end;
     }
 
-    ret = ntruenc_decode_encrypted(enc, elen, ne->priv->params->n, ne->enc);
+    ret = ntruenc_unpack(enc, elen, ne->priv->params->n, ne->enc);
     if (ret != 0)
         goto end;
 
     ne->meths->dec(ne->m, ne->enc, ne->priv->f, ne->t);
 
-    ret = ntruenc_decode_msg(ne->m, ne->priv->params->n, data, len, olen);
+    ret = ntruenc_decode_msg(ne->m, ne->priv->params->n, ne->msg_format,
+        data, len, olen);
+end:
+    return ret;
+}
+
+#ifndef NTRUENC_STATIC
+/**
+ * Decrypt all the encrypted values in a batch.
+ * The encrypted values are multiplied by the private value together using
+ * the batch layout. The result of each decryption is returned in err.
+ *
+ * @param [in]  ne     The NTRU Encryption operation object.
+ * @param [in]  batch  The batch of encrypted values.
+ * @param [in]  data   The buffers for the decrypted data: one for each value
+ *                     in the batch.
+ * @param [in]  len    The length of each buffer in bytes.
+ * @param [out] olen   The length of each decrypted data.
+ * @param [out] err    The error code of each decryption. 0 on success.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_INIT when NTRU_decrypt_init() has not been called.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          NTRU_ERR_BAD_DATA when the batch is for different parameters.<br>
+ *          The error code of the first failed decryption.<br>
+ *          0 otheriwise.
+ */
+int NTRUENC_decrypt_batch(NTRUENC *ne, NTRUENC_BATCH *batch,
+    unsigned char **data, int len, int *olen, int *err)
+{
+    int ret = 0;
+    int i, k, n;
+    void *mem = NULL;
+    size_t mlen = 0;
+    short *v = NULL, *c, *t;
+    short x;
+
+    if ((ne == NULL) || (batch == NULL) || (data == NULL) || (olen == NULL) ||
+        (err == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (ne->priv == NULL)
+    {
+        ret = NTRU_ERR_INIT;
+        goto end;
+    }
+    n = ne->priv->params->n;
+    if (batch->params->n != n)
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+    for (k=0; k<batch->cnt; k++)
+    {
+        if (data[k] == NULL)
+        {
+            ret = NTRU_ERR_PARAM_NULL;
+            goto end;
+        }
+    }
+
+    v = ntruenc_batch_work_alloc(n, &mem, &mlen);
+    if (v == NULL)
+    {
+        ret = NTRU_ERR_ALLOC;
+        goto end;
+    }
+    c = v + n * NTRU_BATCH_MAX;
+    t = c + n * NTRU_BATCH_MAX;
+
+    /* c = f.e mod q for all encrypted values at once. */
+    ntruenc_batch_mul_mod_q(c, ne->priv->f, batch->c, n, ne->priv->params->q,
+        t);
+    /* Calculate mod p in the range -1..1 without a table lookup. */
+    for (i=0; i<n*NTRU_BATCH_MAX; i++)
+    {
+        x = c[i] % 3;
+        c[i] = x - 3 * (x > 1) + 3 * (x < -1);
+    }
+    ntruenc_batch_transpose(c, v, n, 1);
+
+    for (k=0; k<batch->cnt; k++)
+    {
+        err[k] = ntruenc_decode_msg(v + k * n, n, ne->msg_format, data[k],
+            len, &olen[k]);
+        if ((err[k] != 0) && (ret == 0))
+            ret = err[k];
+    }
 end:
+    if (mem != NULL)
+    {
+        memset(v, 0, mlen);
+        free(mem);
+    }
     return ret;
 }
+#endif
 
 /**
- * Cleanup the dynamic memory from decryption.
+ * Cleanup the decryption operation.
+ * The arena is zeroized as it holds decrypted data and kept for the next
+ * operation.
  *
  * @param [in] ne  The NTRU Encryption operation object.
  */
@@ -595,21 +1143,21 @@ void NTRUENC_decrypt_final(NTRUENC *ne)
 {
     if (ne != NULL)
     {
+        ntruenc_prep_release(ne);
         ne->priv = NULL;
-        if (ne->t != NULL) { free(ne->t); ne->t = NULL; }
-        if (ne->enc != NULL) { free(ne->enc); ne->enc = NULL; }
-        if (ne->m != NULL) { free(ne->m); ne->m = NULL; }
+        ntruenc_arena_clear(ne);
     }
 }
 
 /**
- * Initialize memory for the key generation operation.
- * Allocate memory for each of the key fields.
+ * Initialize the key generation operation.
+ * The temporary vectors are bound into the arena - no memory is allocated.
  *
  * @param [in] ne      The NTRU Encryption operation object.
  * @param [in] params  NTRU parameters.
  * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
- *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          NTRU_ERR_BAD_DATA when the parameters are larger than those of
+ *          the implementation.<br>
  *          0 otheriwise.
  */
 int NTRUENC_keygen_init(NTRUENC *ne, NTRUENC_PARAMS *params)
@@ -621,41 +1169,43 @@ int NTRUENC_keygen_init(NTRUENC *ne, NTRUENC_PARAMS *params)
         ret = NTRU_ERR_PARAM_NULL;
         goto end;
     }
-
-    if (ne->meths->keygen_num > 0)
+    if (params->n > ne->arena_n)
     {
-        ne->t = malloc(params->n * sizeof(short) * ne->meths->keygen_num);
-        if (ne->t == NULL)
-        {
-            ret = NTRU_ERR_ALLOC;
-            goto end;
-        }
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
     }
 
+    ne->t = ne->arena;
     ne->params = params;
 end:
     return ret;
 }
 
 /**
- * Perform the key generation operation.
- * Use the key generation function from the method table.
+ * Perform the key generation operation with the random number generator.
+ * Keys are created when NULL is passed in - with NTRUENC_STATIC the keys must
+ * be provided.
  *
  * @param [in]  ne        The NTRU Encryption operation object.
  * @param [out] priv_key  The generated private key.
  * @param [out] pub_key   The generated public key.
+ * @param [in]  drbg      The random number generator to sample with.
  * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
- *          NTRU_ERR_INIT when NTRU_decrypt_init() has not been called.<br>
+ *          NTRU_ERR_INIT when NTRU_keygen_init() has not been called.<br>
  *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          NTRU_ERR_RANDOM when generating random fails.<br>
+ *          NTRU_ERR_NO_INVERSE when the private value has no inverse.<br>
  *          0 otheriwise.
  */
-int NTRUENC_keygen(NTRUENC *ne, NTRUENC_PRIV_KEY **priv_key,
-    NTRUENC_PUB_KEY **pub_key)
+static int ntruenc_keygen(NTRUENC *ne, NTRUENC_PRIV_KEY **priv_key,
+    NTRUENC_PUB_KEY **pub_key, NTRU_DRBG *drbg)
 {
     int ret;
     NTRUENC_PRIV_KEY *priv = NULL;
     NTRUENC_PUB_KEY *pub = NULL;
-    short n = ne->params->n;
+#ifndef NTRUENC_STATIC
+    short n;
+#endif
 
     if ((ne == NULL) || (priv_key == NULL) || (pub_key == NULL))
     {
@@ -668,6 +1218,8 @@ int NTRUENC_keygen(NTRUENC *ne, NTRUENC_PRIV_KEY **priv_key,
         goto end;
     }
 
+#ifndef NTRUENC_STATIC
+    n = ne->params->n;
     if (*priv_key == NULL)
     {
         ret = NTRUENC_PRIV_KEY_new(ne->params, &priv);
@@ -685,30 +1237,193 @@ int NTRUENC_keygen(NTRUENC *ne, NTRUENC_PRIV_KEY **priv_key,
     else
         pub = *pub_key;
 
-    if (priv->f == NULL) priv->f = malloc(n*sizeof(*priv->f));
-    if (pub->h == NULL) pub->h = malloc(n*sizeof(*pub->h));
+    if (priv->f == NULL) priv->f = ntruenc_vec_alloc(n, 1);
+    if (pub->h == NULL) pub->h = ntruenc_vec_alloc(n, 1);
     if ((priv->f == NULL) || (pub->h == NULL))
     {
         ret = NTRU_ERR_ALLOC;
         goto end;
     }
+#else
+    /* Keys are provided by the caller and hold the vectors. */
+    priv = *priv_key;
+    pub = *pub_key;
+    if ((priv == NULL) || (pub == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+    priv->f = NTRU_VEC_ALIGN_PTR(priv->f_data);
+    pub->h = NTRU_VEC_ALIGN_PTR(pub->h_data);
+#endif
 
-    ret = ne->meths->keygen(priv->f, pub->h, ne->t);
+    ret = ne->meths->keygen(priv->f, pub->h, ne->t, drbg);
     if (ret != 0)
         goto end;
+    memset(priv->seed, 0, sizeof(priv->seed));
+    priv->seeded = 0;
 
     *priv_key = priv;
     *pub_key = pub;
     priv = NULL;
     pub = NULL;
 end:
-    if (*pub_key != pub) NTRUENC_PUB_KEY_free(pub);
-    if (*priv_key != priv) NTRUENC_PRIV_KEY_free(priv);
+#ifndef NTRUENC_STATIC
+    if ((pub_key != NULL) && (*pub_key != pub)) NTRUENC_PUB_KEY_free(pub);
+    if ((priv_key != NULL) && (*priv_key != priv))
+        NTRUENC_PRIV_KEY_free(priv);
+#endif
     return ret;
 }
 
 /**
- * Cleanup the dynamic memory from key generation.
+ * Perform the key generation operation.
+ * Use the key generation function from the method table.
+ *
+ * @param [in]  ne        The NTRU Encryption operation object.
+ * @param [out] priv_key  The generated private key.
+ * @param [out] pub_key   The generated public key.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_INIT when NTRU_keygen_init() has not been called.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          NTRU_ERR_RANDOM when generating random fails.<br>
+ *          NTRU_ERR_NO_INVERSE when the private value has no inverse.<br>
+ *          0 otheriwise.
+ */
+int NTRUENC_keygen(NTRUENC *ne, NTRUENC_PRIV_KEY **priv_key,
+    NTRUENC_PUB_KEY **pub_key)
+{
+    if (ne == NULL)
+        return NTRU_ERR_PARAM_NULL;
+    return ntruenc_keygen(ne, priv_key, pub_key, &ne->drbg);
+}
+
+/**
+ * Perform the key generation operation deterministically.
+ * The random vectors f and g are expanded from the seed with SHAKE-256.
+ * The same seed always gives the same key pair.
+ *
+ * @param [in]  ne        The NTRU Encryption operation object.
+ * @param [out] priv_key  The generated private key.
+ * @param [out] pub_key   The generated public key.
+ * @param [in]  seed      The seed data.
+ * @param [in]  slen      The length of the seed data in bytes.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_INIT when NTRU_keygen_init() has not been called.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          NTRU_ERR_NO_INVERSE when the private value has no inverse.<br>
+ *          0 otheriwise.
+ */
+int NTRUENC_keygen_ex(NTRUENC *ne, NTRUENC_PRIV_KEY **priv_key,
+    NTRUENC_PUB_KEY **pub_key, unsigned char *seed, int slen)
+{
+    int ret;
+    NTRU_DRBG drbg;
+
+    if (seed == NULL)
+        return NTRU_ERR_PARAM_NULL;
+
+    ntru_drbg_seed(&drbg, seed, slen);
+    ret = ntruenc_keygen(ne, priv_key, pub_key, &drbg);
+    ntru_drbg_final(&drbg);
+
+    return ret;
+}
+
+/**
+ * Perform the key generation operation from a seed that can be stored in
+ * place of the private key.
+ * The seed and an attempt counter are expanded with SHAKE-256. Attempts are
+ * made with increasing counter until f has an inverse.
+ * The private key can be encoded with NTRU_FORMAT_SEED.
+ *
+ * @param [in]  ne        The NTRU Encryption operation object.
+ * @param [out] priv_key  The generated private key.
+ * @param [out] pub_key   The generated public key.
+ * @param [in]  seed      The seed data.
+ * @param [in]  slen      The length of the seed data in bytes:
+ *                        NTRU_KEY_SEED_LEN.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_BAD_LEN when the seed is not NTRU_KEY_SEED_LEN bytes.<br>
+ *          NTRU_ERR_INIT when NTRU_keygen_init() has not been called.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          NTRU_ERR_NO_INVERSE when no attempt had an inverse.<br>
+ *          0 otheriwise.
+ */
+int NTRUENC_keygen_from_seed(NTRUENC *ne, NTRUENC_PRIV_KEY **priv_key,
+    NTRUENC_PUB_KEY **pub_key, unsigned char *seed, int slen)
+{
+    int ret;
+    int i;
+    NTRUENC_PRIV_KEY *priv = NULL;
+    NTRU_DRBG drbg;
+
+    if ((ne == NULL) || (priv_key == NULL) || (seed == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (slen != NTRU_KEY_SEED_LEN)
+    {
+        ret = NTRU_ERR_BAD_LEN;
+        goto end;
+    }
+    if (ne->params == NULL)
+    {
+        ret = NTRU_ERR_INIT;
+        goto end;
+    }
+
+#ifndef NTRUENC_STATIC
+    if (*priv_key == NULL)
+    {
+        ret = NTRUENC_PRIV_KEY_new(ne->params, &priv);
+        if (ret != 0)
+            goto end;
+    }
+    else
+        priv = *priv_key;
+#else
+    priv = *priv_key;
+    if (priv == NULL)
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+#endif
+
+    memcpy(priv->seed, seed, NTRU_KEY_SEED_LEN);
+    ret = NTRU_ERR_NO_INVERSE;
+    for (i=0; (i<256) && (ret == NTRU_ERR_NO_INVERSE); i++)
+    {
+        priv->seed[NTRU_KEY_SEED_LEN] = i;
+        ntruenc_priv_key_seed_drbg(priv, &drbg);
+        ret = ntruenc_keygen(ne, &priv, pub_key, &drbg);
+        ntru_drbg_final(&drbg);
+    }
+    if (ret != 0)
+    {
+        memset(priv->seed, 0, sizeof(priv->seed));
+        goto end;
+    }
+
+    memcpy(priv->seed, seed, NTRU_KEY_SEED_LEN);
+    priv->seed[NTRU_KEY_SEED_LEN] = i - 1;
+    priv->seeded = 1;
+    *priv_key = priv;
+    priv = NULL;
+end:
+#ifndef NTRUENC_STATIC
+    if ((priv_key != NULL) && (*priv_key != priv))
+        NTRUENC_PRIV_KEY_free(priv);
+#endif
+    return ret;
+}
+
+/**
+ * Cleanup the key generation operation.
+ * The arena is zeroized as it holds secret values and kept for the next
+ * operation.
  *
  * @param [in] ne  The NTRU Encryption operation object.
  */
@@ -717,11 +1432,7 @@ void NTRUENC_keygen_final(NTRUENC *ne)
     if (ne != NULL)
     {
         ne->params = NULL;
-        if (ne->t != NULL)
-        {
-            free(ne->t);
-            ne->t = NULL;
-        }
+        ntruenc_arena_clear(ne);
     }
 }
 
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "ntruenc_aes.h"
+
+#if defined(CPU_X86_64) && (defined(CC_GCC) || defined(CC_CLANG))
+#include <immintrin.h>
+
+/** The number of rounds in AES-256. */
+#define NTRU_AES256_ROUNDS	14
+/** The number of blocks encrypted at once to fill the AES-NI pipeline. */
+#define NTRU_AES_PIPE		8
+
+/**
+ * Calculate the next even round key of AES-256.
+ *
+ * @param [in] k  The round key two before.
+ * @param [in] t  The output of AESKEYGENASSIST on the previous round key.
+ * @return  The next round key.
+ */
+__attribute__((target("aes,sse2")))
+static __m128i ntru_aes256_key_even(__m128i k, __m128i t)
+{
+    t = _mm_shuffle_epi32(t, 0xff);
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    return _mm_xor_si128(k, t);
+}
+
+/**
+ * Calculate the next odd round key of AES-256.
+ *
+ * @param [in] k  The round key two before.
+ * @param [in] t  The output of AESKEYGENASSIST on the previous round key.
+ * @return  The next round key.
+ */
+__attribute__((target("aes,sse2")))
+static __m128i ntru_aes256_key_odd(__m128i k, __m128i t)
+{
+    t = _mm_shuffle_epi32(t, 0xaa);
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    return _mm_xor_si128(k, t);
+}
+
+/**
+ * Calculate the next two round keys of AES-256.
+ * AESKEYGENASSIST takes the round constant as an immediate.
+ *
+ * @param [in] rk    The round keys.
+ * @param [in] i     The index of the next round key to calculate.
+ * @param [in] rcon  The round constant.
+ */
+#define NTRU_AES256_KEY_2(rk, i, rcon)                                  \
+do                                                                      \
+{                                                                       \
+    rk[i] = ntru_aes256_key_even(rk[i-2],                               \
+        _mm_aeskeygenassist_si128(rk[i-1], rcon));                      \
+    if (i+1 <= NTRU_AES256_ROUNDS)                                      \
+        rk[i+1] = ntru_aes256_key_odd(rk[i-1],                          \
+            _mm_aeskeygenassist_si128(rk[i], 0));                       \
+}                                                                       \
+while (0)
+
+/**
+ * Expand the AES-256 key into round keys.
+ *
+ * @param [in] rk   The round keys.
+ * @param [in] key  The AES-256 key.
+ */
+__attribute__((target("aes,sse2")))
+static void ntru_aes256_key_expand(__m128i *rk, const uint8_t *key)
+{
+    rk[0] = _mm_loadu_si128((const __m128i *)key);
+    rk[1] = _mm_loadu_si128((const __m128i *)(key + 16));
+    NTRU_AES256_KEY_2(rk,  2, 0x01);
+    NTRU_AES256_KEY_2(rk,  4, 0x02);
+    NTRU_AES256_KEY_2(rk,  6, 0x04);
+    NTRU_AES256_KEY_2(rk,  8, 0x08);
+    NTRU_AES256_KEY_2(rk, 10, 0x10);
+    NTRU_AES256_KEY_2(rk, 12, 0x20);
+    NTRU_AES256_KEY_2(rk, 14, 0x40);
+}
+
+/**
+ * Generate AES-256-CTR key stream using AES-NI.
+ * Eight counter blocks are encrypted at a time to hide the latency of
+ * AESENC. The remaining blocks are encrypted one at a time.
+ *
+ * @param [in] r       The buffer to fill.
+ * @param [in] blocks  The number of blocks to generate.
+ * @param [in] key     The AES-256 key.
+ * @param [in] n       The nonce: first 8 bytes of each counter block.
+ * @param [in] c       The counter of the first block.
+ */
+__attribute__((target("aes,sse2")))
+static void ntru_aes256_ctr_ni(uint8_t *r, int blocks, const uint8_t *key,
+    uint64_t n, uint64_t c)
+{
+    int i, j, k;
+    __m128i rk[NTRU_AES256_ROUNDS+1];
+    __m128i b[NTRU_AES_PIPE];
+    __m128i ctr, one;
+
+    ntru_aes256_key_expand(rk, key);
+
+    ctr = _mm_set_epi64x((long long)c, (long long)n);
+    one = _mm_set_epi64x(1, 0);
+    for (i=0; i+NTRU_AES_PIPE<=blocks; i+=NTRU_AES_PIPE)
+    {
+        for (j=0; j<NTRU_AES_PIPE; j++)
+        {
+            b[j] = _mm_xor_si128(ctr, rk[0]);
+            ctr = _mm_add_epi64(ctr, one);
+        }
+        for (k=1; k<NTRU_AES256_ROUNDS; k++)
+        {
+            for (j=0; j<NTRU_AES_PIPE; j++)
+                b[j] = _mm_aesenc_si128(b[j], rk[k]);
+        }
+        for (j=0; j<NTRU_AES_PIPE; j++)
+        {
+            b[j] = _mm_aesenclast_si128(b[j], rk[NTRU_AES256_ROUNDS]);
+            _mm_storeu_si128((__m128i *)(r + (i+j)*NTRU_AES_BLOCK_LEN), b[j]);
+        }
+    }
+    for (; i<blocks; i++)
+    {
+        b[0] = _mm_xor_si128(ctr, rk[0]);
+        ctr = _mm_add_epi64(ctr, one);
+        for (k=1; k<NTRU_AES256_ROUNDS; k++)
+            b[0] = _mm_aesenc_si128(b[0], rk[k]);
+        b[0] = _mm_aesenclast_si128(b[0], rk[NTRU_AES256_ROUNDS]);
+        _mm_storeu_si128((__m128i *)(r + i*NTRU_AES_BLOCK_LEN), b[0]);
+    }
+
+    for (k=0; k<=NTRU_AES256_ROUNDS; k++)
+        rk[k] = _mm_setzero_si128();
+    for (j=0; j<NTRU_AES_PIPE; j++)
+        b[j] = _mm_setzero_si128();
+}
+
+/**
+ * Check whether the CPU supports the AES-NI instructions.
+ *
+ * @return  1 when AES-NI is available.<br>
+ *          0 otherwise.
+ */
+int ntru_aes_ni_available(void)
+{
+    return __builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2");
+}
+
+/**
+ * Generate AES-256-CTR key stream.
+ * Counter block i is n (8 bytes little-endian) || c+i (8 bytes
+ * little-endian).
+ *
+ * @param [in] r       The buffer to fill.
+ * @param [in] blocks  The number of 16 byte blocks to generate.
+ * @param [in] key     The AES-256 key - 32 bytes.
+ * @param [in] n       The nonce.
+ * @param [in] c       The counter of the first block.
+ * @return  1 on success.<br>
+ *          0 when AES-NI is not available.
+ */
+int ntru_aes256_ctr(uint8_t *r, int blocks, const uint8_t *key, uint64_t n,
+    uint64_t c)
+{
+    if (!ntru_aes_ni_available())
+        return 0;
+    ntru_aes256_ctr_ni(r, blocks, key, n, c);
+    return 1;
+}
+#else
+/**
+ * Check whether the CPU supports the AES-NI instructions.
+ *
+ * @return  0 as AES-NI is not supported in this build.
+ */
+int ntru_aes_ni_available(void)
+{
+    return 0;
+}
+
+/**
+ * Generate AES-256-CTR key stream.
+ *
+ * @param [in] r       The buffer to fill.
+ * @param [in] blocks  The number of 16 byte blocks to generate.
+ * @param [in] key     The AES-256 key - 32 bytes.
+ * @param [in] n       The nonce.
+ * @param [in] c       The counter of the first block.
+ * @return  0 as AES-NI is not supported in this build.
+ */
+int ntru_aes256_ctr(uint8_t *r, int blocks, const uint8_t *key, uint64_t n,
+    uint64_t c)
+{
+    (void)r;
+    (void)blocks;
+    (void)key;
+    (void)n;
+    (void)c;
+    return 0;
+}
+#endif
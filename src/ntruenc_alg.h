@@ -39,6 +39,9 @@ static short *neg_mod_3 = &neg_mod_3_data[2];
  */
 #define ntruenc_neg_mod_3(a)	(neg_mod_3[(a) % 3])
 
+/** The number of elements in a padded NTRU vector. */
+#define NTRU_N_PAD	NTRU_VEC_LEN(NTRU_N)
+
 #ifdef NTRUENC_SMALL_CODE
 /**
  * Multiply to NTRU vectors.
@@ -103,19 +106,21 @@ int NTRUENC_MOD_INV_Q(short *fq, short *f)
  *   g  = (random vector mod q) * p
  *   h  = g.t
  *
- * @param [in] f  The random private value f.
- * @param [in] h  The public value h.
- * @param [in] t  The temprorary buffer to use in generation.
+ * @param [in] f     The random private value f.
+ * @param [in] h     The public value h.
+ * @param [in] t     The temprorary buffer to use in generation: two padded
+ *                   vectors.
+ * @param [in] drbg  The random number generator to sample with.
  * @return  NTRU_ERR_RANDOM if generating random fails.<br>
  *          NTRU_ERR_NO_INVERSE if the f has no inverse.<br>
  *          0 on successful generation of a key pair.
  */
-int NTRUENC_KEYGEN(short *f, short *h, short *t)
+int NTRUENC_KEYGEN(short *f, short *h, short *t, NTRU_DRBG *drbg)
 {
     int ret;
-    short *g = &t[NTRU_N];
+    short *g = &t[NTRU_N_PAD];
 
-    ret = NTRUENC_RANDOM(f, NTRU_DF, NTRU_DF, 3);
+    ret = NTRUENC_RANDOM(f, NTRU_DF, NTRU_DF, 3, drbg);
     if (ret != 0) return ret;
 
     f[0] += 1;
@@ -123,7 +128,7 @@ int NTRUENC_KEYGEN(short *f, short *h, short *t)
     ret = NTRUENC_MOD_INV_Q(t, f);
     if (ret != 0) return ret;
 
-    ret = NTRUENC_RANDOM(g, NTRU_DG, NTRU_DG, 3);
+    ret = NTRUENC_RANDOM(g, NTRU_DG, NTRU_DG, 3, drbg);
     if (ret != 0) return ret;
 
     NTRUENC_MUL_MOD_Q(h, t, g);
@@ -132,36 +137,75 @@ int NTRUENC_KEYGEN(short *f, short *h, short *t)
 }
 
 /**
- * Generate an encryption of the encoded message or key using the public value.
+ * Generate the blinding value of an encryption using the public value.
+ * The blinding value doesn't depend on the message and can be precomputed.
+ *   b = r.h where r is a random vector
  *
- * @param [in] e  The encrypted value.
- * @param [in] m  The endocode message or key.
- * @param [in] h  The public vlaue.
- * @param [in] t  The temporary buffer to use in generation.
+ * @param [in] b     The blinding value.
+ * @param [in] h     The public vlaue.
+ * @param [in] t     The temporary buffer to use in generation.
+ * @param [in] drbg  The random number generator to sample with.
  * @return  NTRU_ERR_RANDOM if generating random fails.<br>
- *          0 on successful generation of a key pair.
+ *          0 on successful generation of the blinding value.
  */
-int NTRUENC_ENCRYPT(short *e, short *m, short *h, short *t)
+int NTRUENC_BLIND(short *b, short *h, short *t, NTRU_DRBG *drbg)
 {
     int ret;
-    int i;
 
-    ret = NTRUENC_RANDOM(t, NTRU_DF, NTRU_DF, 1);
+    ret = NTRUENC_RANDOM(t, NTRU_DF, NTRU_DF, 1, drbg);
     if (ret != 0) return ret;
 
-    NTRUENC_MUL_MOD_Q(e, t, h);
+    NTRUENC_MUL_MOD_Q(b, t, h);
+
+    return 0;
+}
+
+/**
+ * Generate an encryption of the encoded message or key from a blinding value.
+ * Operates on the padding of the vectors - zero stays zero.
+ *
+ * @param [in] e  The encrypted value.
+ * @param [in] m  The endocode message or key.
+ * @param [in] b  The blinding value.
+ */
+void NTRUENC_ENCRYPT_BLINDED(short *e, short *m, short *b)
+{
+    int i;
+
     /* Add in message/key and ensure the values are in the right range. */
-    for (i=0; i<NTRU_N; i++)
+    for (i=0; i<NTRU_N_PAD; i++)
     {
-        e[i] = (e[i] + m[i]) & (NTRU_Q-1);
+        e[i] = (b[i] + m[i]) & (NTRU_Q-1);
         e[i] |= 0 - (e[i] & (1<<(NTRU_Q_BITS-1)));
     }
+}
+
+/**
+ * Generate an encryption of the encoded message or key using the public value.
+ *
+ * @param [in] e     The encrypted value.
+ * @param [in] m     The endocode message or key.
+ * @param [in] h     The public vlaue.
+ * @param [in] t     The temporary buffer to use in generation.
+ * @param [in] drbg  The random number generator to sample with.
+ * @return  NTRU_ERR_RANDOM if generating random fails.<br>
+ *          0 on successful generation of a key pair.
+ */
+int NTRUENC_ENCRYPT(short *e, short *m, short *h, short *t, NTRU_DRBG *drbg)
+{
+    int ret;
+
+    ret = NTRUENC_BLIND(e, h, t, drbg);
+    if (ret != 0) return ret;
+
+    NTRUENC_ENCRYPT_BLINDED(e, m, e);
 
     return 0;
 }
 
 /**
  * Decrypt the message/key using the private value.
+ * Operates on the padding of the vectors - zero stays zero.
  *
  * @param [in] c  The decrypted message/key.
  * @param [in] e  The encrypted value.
@@ -174,7 +218,7 @@ void NTRUENC_DECRYPT(short *c, short *e, short *f, short *t)
 
     NTRUENC_MUL_MOD_Q(c, f, e);
     /* Calculate mod p to isolate the message/key. */
-    for (i=0; i<NTRU_N; i++)
+    for (i=0; i<NTRU_N_PAD; i++)
         c[i] = ntruenc_neg_mod_3(c[i]);
 }
 
@@ -0,0 +1,627 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ntruenc_lcl.h"
+#include "ntruenc_key_lcl.h"
+
+/**
+ * The number of shorts in a row of batch data: one element of each value.
+ */
+#define NTRU_BATCH_ROW		NTRU_BATCH_MAX
+/** The alignment in bytes of the batch data. */
+#define NTRU_BATCH_ALIGN	64
+/**
+ * The number of rows at or below which the Karatsuba multiplication is done
+ * with the schoolbook method.
+ */
+#define NTRU_BATCH_KARA_MIN	32
+
+/**
+ * Creates a new batch of encrypted values for the parameters.
+ * The encrypted values are stored transposed: element i of value k is at
+ * c[i * NTRU_BATCH_MAX + k]. Rows are aligned for SIMD operations.
+ *
+ * @param [in]  params  The NTRU parameters.
+ * @param [out] batch   The new batch object.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          0 otheriwise.
+ */
+int NTRUENC_BATCH_new(NTRUENC_PARAMS *params, NTRUENC_BATCH **batch)
+{
+    int ret = 0;
+    NTRUENC_BATCH *b = NULL;
+    size_t sz;
+
+    if ((params == NULL) || (batch == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    b = malloc(sizeof(*b));
+    if (b == NULL)
+    {
+        ret = NTRU_ERR_ALLOC;
+        goto end;
+    }
+    memset(b, 0, sizeof(*b));
+
+    sz = params->n * NTRU_BATCH_ROW * sizeof(short);
+    b->mem = malloc(sz + NTRU_BATCH_ALIGN - 1);
+    if (b->mem == NULL)
+    {
+        ret = NTRU_ERR_ALLOC;
+        goto end;
+    }
+    b->c = (short *)(((size_t)b->mem + NTRU_BATCH_ALIGN - 1) &
+        ~(size_t)(NTRU_BATCH_ALIGN - 1));
+    memset(b->c, 0, sz);
+    b->params = params;
+
+    *batch = b;
+    b = NULL;
+end:
+    NTRUENC_BATCH_free(b);
+    return ret;
+}
+
+/**
+ * Free the dynamic memory of the batch object.
+ * The encrypted values are zeroized.
+ *
+ * @param [in] batch  The batch object.
+ */
+void NTRUENC_BATCH_free(NTRUENC_BATCH *batch)
+{
+    if (batch != NULL)
+    {
+        if (batch->mem != NULL)
+        {
+            memset(batch->c, 0, batch->params->n * NTRU_BATCH_ROW *
+                sizeof(short));
+            free(batch->mem);
+        }
+        free(batch);
+    }
+}
+
+/**
+ * Retrieves the number of encrypted values in the batch.
+ *
+ * @param [in] batch  The batch object.
+ * @return  The number of encrypted values.<br>
+ *          0 when the batch is NULL.
+ */
+int NTRUENC_BATCH_num(NTRUENC_BATCH *batch)
+{
+    if (batch == NULL)
+        return 0;
+    return batch->cnt;
+}
+
+/**
+ * Transpose NTRU_BATCH_MAX vectors into batch rows, or back, in plain C.
+ * Element i of vector k: v[k * n + i] <-> c[i * NTRU_BATCH_MAX + k].
+ *
+ * @param [in] c     The batch data.
+ * @param [in] v     The vectors.
+ * @param [in] n     The number of elements in a vector.
+ * @param [in] from  Non-zero to transpose from the batch to the vectors.
+ * @param [in] i     The first element to transpose.
+ */
+static void ntruenc_batch_transpose_c(short *c, short *v, int n, int from,
+    int i)
+{
+    int k;
+
+    for (; i<n; i++)
+    {
+        for (k=0; k<NTRU_BATCH_ROW; k++)
+        {
+            if (from)
+                v[k*n + i] = c[i*NTRU_BATCH_ROW + k];
+            else
+                c[i*NTRU_BATCH_ROW + k] = v[k*n + i];
+        }
+    }
+}
+
+/**
+ * Calculate the number of temporary rows needed to multiply a vector by a
+ * batch with the Karatsuba method.
+ *
+ * @param [in] n  The number of elements in a vector.
+ * @return  The number of rows.
+ */
+static int ntruenc_batch_kara_rows(int n)
+{
+    int h;
+
+    if (n <= NTRU_BATCH_KARA_MIN)
+        return 0;
+    h = n - n/2;
+    return 3*h + (h + NTRU_BATCH_ROW - 1) / NTRU_BATCH_ROW +
+        ntruenc_batch_kara_rows(h);
+}
+
+/**
+ * Multiply a vector by a batch in plain C using the schoolbook method.
+ *   r = a.b where b and r are batches of n and 2n rows.
+ * The last row of r is zero.
+ *
+ * @param [in] r  The batch result.
+ * @param [in] a  The vector operand.
+ * @param [in] b  The batch operand.
+ * @param [in] n  The number of elements in a vector.
+ */
+static void ntruenc_batch_mul_school_c(short *r, short *a, short *b, int n)
+{
+    int i, j, k;
+    short *p;
+
+    memset(r, 0, n * 2 * NTRU_BATCH_ROW * sizeof(*r));
+    for (i=0; i<n; i++)
+    {
+        p = r + i * NTRU_BATCH_ROW;
+        for (j=0; j<n; j++)
+        {
+            for (k=0; k<NTRU_BATCH_ROW; k++)
+                p[j*NTRU_BATCH_ROW + k] += a[i] * b[j*NTRU_BATCH_ROW + k];
+        }
+    }
+}
+
+/**
+ * Multiply a vector by a batch in plain C using the Karatsuba
+ * method.
+ *   r = a.b where b and r are batches of n and 2n rows.
+ * The last row of r is zero.
+ *
+ * @param [in] r  The batch result.
+ * @param [in] a  The vector operand.
+ * @param [in] b  The batch operand.
+ * @param [in] n  The number of elements in a vector.
+ * @param [in] t  Temporary rows. See ntruenc_batch_kara_rows().
+ */
+static void ntruenc_batch_mul_kara_c(short *r, short *a, short *b, int n,
+    short *t)
+{
+    int i, l, h;
+    short *z1, *sb, *sa;
+
+    if (n <= NTRU_BATCH_KARA_MIN)
+    {
+        ntruenc_batch_mul_school_c(r, a, b, n);
+        return;
+    }
+
+    /* Split into low of l elements and high of h elements: h >= l. */
+    l = n / 2;
+    h = n - l;
+    z1 = t;
+    sb = z1 + 2*h*NTRU_BATCH_ROW;
+    sa = sb + h*NTRU_BATCH_ROW;
+    t = sa + ((h + NTRU_BATCH_ROW - 1) / NTRU_BATCH_ROW) * NTRU_BATCH_ROW;
+
+    /* Sums of low and high halves. */
+    for (i=0; i<l; i++)
+        sa[i] = a[i] + a[l+i];
+    if (h > l)
+        sa[l] = a[n-1];
+    for (i=0; i<l*NTRU_BATCH_ROW; i++)
+        sb[i] = b[i] + b[l*NTRU_BATCH_ROW + i];
+    for (; i<h*NTRU_BATCH_ROW; i++)
+        sb[i] = b[l*NTRU_BATCH_ROW + i];
+
+    ntruenc_batch_mul_kara_c(r, a, b, l, t);
+    ntruenc_batch_mul_kara_c(r + 2*l*NTRU_BATCH_ROW, a + l,
+        b + l*NTRU_BATCH_ROW, h, t);
+    ntruenc_batch_mul_kara_c(z1, sa, sb, h, t);
+
+    /* z1 = (a0+a1).(b0+b1) - a0.b0 - a1.b1 added in at the middle. */
+    for (i=0; i<2*l*NTRU_BATCH_ROW; i++)
+        z1[i] -= r[i];
+    for (i=0; i<2*h*NTRU_BATCH_ROW; i++)
+        z1[i] -= r[2*l*NTRU_BATCH_ROW + i];
+    for (i=0; i<(2*h-1)*NTRU_BATCH_ROW; i++)
+        r[l*NTRU_BATCH_ROW + i] += z1[i];
+}
+
+#if defined(CPU_X86_64) && (defined(CC_GCC) || defined(CC_CLANG))
+#include <immintrin.h>
+
+/**
+ * Transpose eight rows of eight elements using SSE2.
+ *
+ * @param [in] d   The destination of the first row.
+ * @param [in] ds  The stride of destination rows in elements.
+ * @param [in] s   The source of the first row.
+ * @param [in] ss  The stride of source rows in elements.
+ */
+static void ntruenc_batch_transpose_8x8_sse2(short *d, int ds, short *s,
+    int ss)
+{
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7;
+    __m128i y0, y1, y2, y3, y4, y5, y6, y7;
+
+    x0 = _mm_loadu_si128((__m128i *)(s + 0*ss));
+    x1 = _mm_loadu_si128((__m128i *)(s + 1*ss));
+    x2 = _mm_loadu_si128((__m128i *)(s + 2*ss));
+    x3 = _mm_loadu_si128((__m128i *)(s + 3*ss));
+    x4 = _mm_loadu_si128((__m128i *)(s + 4*ss));
+    x5 = _mm_loadu_si128((__m128i *)(s + 5*ss));
+    x6 = _mm_loadu_si128((__m128i *)(s + 6*ss));
+    x7 = _mm_loadu_si128((__m128i *)(s + 7*ss));
+
+    y0 = _mm_unpacklo_epi16(x0, x1);
+    y1 = _mm_unpackhi_epi16(x0, x1);
+    y2 = _mm_unpacklo_epi16(x2, x3);
+    y3 = _mm_unpackhi_epi16(x2, x3);
+    y4 = _mm_unpacklo_epi16(x4, x5);
+    y5 = _mm_unpackhi_epi16(x4, x5);
+    y6 = _mm_unpacklo_epi16(x6, x7);
+    y7 = _mm_unpackhi_epi16(x6, x7);
+
+    x0 = _mm_unpacklo_epi32(y0, y2);
+    x1 = _mm_unpackhi_epi32(y0, y2);
+    x2 = _mm_unpacklo_epi32(y1, y3);
+    x3 = _mm_unpackhi_epi32(y1, y3);
+    x4 = _mm_unpacklo_epi32(y4, y6);
+    x5 = _mm_unpackhi_epi32(y4, y6);
+    x6 = _mm_unpacklo_epi32(y5, y7);
+    x7 = _mm_unpackhi_epi32(y5, y7);
+
+    _mm_storeu_si128((__m128i *)(d + 0*ds), _mm_unpacklo_epi64(x0, x4));
+    _mm_storeu_si128((__m128i *)(d + 1*ds), _mm_unpackhi_epi64(x0, x4));
+    _mm_storeu_si128((__m128i *)(d + 2*ds), _mm_unpacklo_epi64(x1, x5));
+    _mm_storeu_si128((__m128i *)(d + 3*ds), _mm_unpackhi_epi64(x1, x5));
+    _mm_storeu_si128((__m128i *)(d + 4*ds), _mm_unpacklo_epi64(x2, x6));
+    _mm_storeu_si128((__m128i *)(d + 5*ds), _mm_unpackhi_epi64(x2, x6));
+    _mm_storeu_si128((__m128i *)(d + 6*ds), _mm_unpacklo_epi64(x3, x7));
+    _mm_storeu_si128((__m128i *)(d + 7*ds), _mm_unpackhi_epi64(x3, x7));
+}
+
+/**
+ * Transpose NTRU_BATCH_MAX vectors into batch rows, or back, using SSE2.
+ * Blocks of eight elements of eight vectors are transposed at a time.
+ *
+ * @param [in] c     The batch data.
+ * @param [in] v     The vectors.
+ * @param [in] n     The number of elements in a vector.
+ * @param [in] from  Non-zero to transpose from the batch to the vectors.
+ */
+static void ntruenc_batch_transpose_sse2(short *c, short *v, int n, int from)
+{
+    int i, k;
+    short *p, *q;
+
+    for (i=0; i+8<=n; i+=8)
+    {
+        for (k=0; k<NTRU_BATCH_ROW; k+=8)
+        {
+            p = c + i*NTRU_BATCH_ROW + k;
+            q = v + k*n + i;
+            if (from)
+                ntruenc_batch_transpose_8x8_sse2(q, n, p, NTRU_BATCH_ROW);
+            else
+                ntruenc_batch_transpose_8x8_sse2(p, NTRU_BATCH_ROW, q, n);
+        }
+    }
+    ntruenc_batch_transpose_c(c, v, n, from, i);
+}
+
+/**
+ * Multiply a vector by a batch using AVX2 and the schoolbook method.
+ *   r = a.b where b and r are batches of n and 2n rows.
+ * A row is one 256-bit register. Eight result rows are accumulated in
+ * registers at a time. The batch operand is copied between zero rows so that
+ * no bounds checks are needed. The last row of r is zero.
+ *
+ * @param [in] r  The batch result.
+ * @param [in] a  The vector operand.
+ * @param [in] b  The batch operand.
+ * @param [in] n  The number of elements in a vector: at most
+ *                NTRU_BATCH_KARA_MIN.
+ */
+__attribute__((target("avx2")))
+static void ntruenc_batch_mul_school_avx2(short *r, short *a, short *b,
+    int n)
+{
+    int i, j, o, u, e;
+    __m256i p[7 + NTRU_BATCH_KARA_MIN + 7];
+    __m256i s[8];
+    __m256i x, *q;
+
+    for (i=0; i<7; i++)
+    {
+        p[i] = _mm256_setzero_si256();
+        p[7 + n + i] = _mm256_setzero_si256();
+    }
+    for (i=0; i<n; i++)
+        p[7 + i] = _mm256_load_si256((__m256i *)(b + i*NTRU_BATCH_ROW));
+
+    for (o=0; o<2*n; o+=8)
+    {
+        for (u=0; u<8; u++)
+            s[u] = _mm256_setzero_si256();
+        j = (o < n) ? 0 : o - n + 1;
+        e = (o + 7 < n) ? o + 7 : n - 1;
+        for (; j<=e; j++)
+        {
+            x = _mm256_set1_epi16(a[j]);
+            q = p + 7 + o - j;
+            for (u=0; u<8; u++)
+                s[u] = _mm256_add_epi16(s[u], _mm256_mullo_epi16(x, q[u]));
+        }
+        for (u=0; (u<8) && (o+u<2*n); u++)
+            _mm256_store_si256((__m256i *)(r + (o+u)*NTRU_BATCH_ROW), s[u]);
+    }
+}
+
+/**
+ * Multiply a vector by a batch using AVX2 and the Karatsuba method.
+ *   r = a.b where b and r are batches of n and 2n rows.
+ * The last row of r is zero.
+ *
+ * @param [in] r  The batch result.
+ * @param [in] a  The vector operand.
+ * @param [in] b  The batch operand.
+ * @param [in] n  The number of elements in a vector.
+ * @param [in] t  Temporary rows. See ntruenc_batch_kara_rows().
+ */
+__attribute__((target("avx2")))
+static void ntruenc_batch_mul_kara_avx2(short *r, short *a, short *b, int n,
+    short *t)
+{
+    int i, l, h;
+    short *sa;
+    __m256i *z1, *sb, *r0, *r1, *rm, *b0, *b1;
+
+    if (n <= NTRU_BATCH_KARA_MIN)
+    {
+        ntruenc_batch_mul_school_avx2(r, a, b, n);
+        return;
+    }
+
+    /* Split into low of l elements and high of h elements: h >= l. */
+    l = n / 2;
+    h = n - l;
+    z1 = (__m256i *)t;
+    sb = z1 + 2*h;
+    sa = (short *)(sb + h);
+    t = sa + ((h + NTRU_BATCH_ROW - 1) / NTRU_BATCH_ROW) * NTRU_BATCH_ROW;
+    r0 = (__m256i *)r;
+    r1 = r0 + 2*l;
+    rm = r0 + l;
+    b0 = (__m256i *)b;
+    b1 = b0 + l;
+
+    /* Sums of low and high halves. */
+    for (i=0; i<l; i++)
+        sa[i] = a[i] + a[l+i];
+    if (h > l)
+        sa[l] = a[n-1];
+    for (i=0; i<l; i++)
+        sb[i] = _mm256_add_epi16(b0[i], b1[i]);
+    if (h > l)
+        sb[l] = b1[l];
+
+    ntruenc_batch_mul_kara_avx2(r, a, b, l, t);
+    ntruenc_batch_mul_kara_avx2((short *)r1, a + l, (short *)b1, h, t);
+    ntruenc_batch_mul_kara_avx2((short *)z1, sa, (short *)sb, h, t);
+
+    /* z1 = (a0+a1).(b0+b1) - a0.b0 - a1.b1 added in at the middle. */
+    for (i=0; i<2*l; i++)
+        z1[i] = _mm256_sub_epi16(z1[i], _mm256_add_epi16(r0[i], r1[i]));
+    for (; i<2*h; i++)
+        z1[i] = _mm256_sub_epi16(z1[i], r1[i]);
+    for (i=0; i<2*h-1; i++)
+        rm[i] = _mm256_add_epi16(rm[i], z1[i]);
+}
+
+/** Check whether the CPU supports the AVX2 instructions. */
+#define NTRU_HAVE_AVX2()	__builtin_cpu_supports("avx2")
+#endif
+
+/**
+ * Transpose NTRU_BATCH_MAX vectors into batch rows, or back.
+ * Element i of vector k: v[k * n + i] <-> c[i * NTRU_BATCH_MAX + k].
+ *
+ * @param [in] c     The batch data.
+ * @param [in] v     The vectors.
+ * @param [in] n     The number of elements in a vector.
+ * @param [in] from  Non-zero to transpose from the batch to the vectors.
+ */
+void ntruenc_batch_transpose(short *c, short *v, int n, int from)
+{
+#if defined(CPU_X86_64) && (defined(CC_GCC) || defined(CC_CLANG))
+    ntruenc_batch_transpose_sse2(c, v, n, from);
+#else
+    ntruenc_batch_transpose_c(c, v, n, from, 0);
+#endif
+}
+
+/**
+ * Calculate the number of temporary rows needed by ntruenc_batch_mul_mod_q().
+ *
+ * @param [in] n  The number of elements in a vector.
+ * @return  The number of rows.
+ */
+int ntruenc_batch_mul_rows(int n)
+{
+    return 2*n + ntruenc_batch_kara_rows(n);
+}
+
+/**
+ * Multiply a vector by each value in a batch modulo q and x^n - 1.
+ *   r = a.b mod q
+ * Elements are in the range -q/2..q/2-1.
+ * All operations are on rows so each value in the batch is processed at once.
+ * Uses the widest SIMD instructions the CPU supports.
+ *
+ * @param [in] r       The batch result: n rows.
+ * @param [in] a       The vector operand.
+ * @param [in] b       The batch operand: n rows.
+ * @param [in] n       The number of elements in a vector.
+ * @param [in] q       The modulus: a power of 2.
+ * @param [in] t       Temporary rows. See ntruenc_batch_mul_rows(). Aligned
+ *                     to a row.
+ */
+void ntruenc_batch_mul_mod_q(short *r, short *a, short *b, int n, int q,
+    short *t)
+{
+    int i;
+    short x;
+
+#ifdef NTRU_HAVE_AVX2
+    if (NTRU_HAVE_AVX2())
+        ntruenc_batch_mul_kara_avx2(t, a, b, n, t + 2*n*NTRU_BATCH_ROW);
+    else
+#endif
+        ntruenc_batch_mul_kara_c(t, a, b, n, t + 2*n*NTRU_BATCH_ROW);
+    for (i=0; i<n*NTRU_BATCH_ROW; i++)
+    {
+        x = (t[i] + t[n*NTRU_BATCH_ROW + i]) & (q - 1);
+        r[i] = x | (0 - (x & (q >> 1)));
+    }
+}
+
+/**
+ * Unpack encrypted values into the batch.
+ * Each encrypted value is unpacked and then the values are transposed into
+ * the batch with SIMD operations. Unused values in the batch are zero.
+ *
+ * @param [in] batch  The batch object.
+ * @param [in] enc    The encrypted values.
+ * @param [in] elen   The lengths of the encrypted values.
+ * @param [in] cnt    The number of encrypted values: 1..NTRU_BATCH_MAX.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_BAD_LEN when the count is invalid or an encrypted value
+ *          is too short.<br>
+ *          NTRU_ERR_BAD_DATA when an encrypted value is invalid.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          0 otheriwise.
+ */
+int NTRUENC_BATCH_load(NTRUENC_BATCH *batch, unsigned char **enc, int *elen,
+    int cnt)
+{
+    int ret = 0;
+    int i, n;
+    short *v = NULL;
+
+    if ((batch == NULL) || (enc == NULL) || (elen == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+    if ((cnt < 1) || (cnt > NTRU_BATCH_MAX))
+    {
+        ret = NTRU_ERR_BAD_LEN;
+        goto end;
+    }
+
+    n = batch->params->n;
+    v = malloc(n * NTRU_BATCH_MAX * sizeof(*v));
+    if (v == NULL)
+    {
+        ret = NTRU_ERR_ALLOC;
+        goto end;
+    }
+    memset(v + cnt * n, 0, (NTRU_BATCH_MAX - cnt) * n * sizeof(*v));
+
+    for (i=0; i<cnt; i++)
+    {
+        if (enc[i] == NULL)
+        {
+            ret = NTRU_ERR_PARAM_NULL;
+            goto end;
+        }
+        ret = ntruenc_unpack(enc[i], elen[i], n, v + i * n);
+        if (ret != 0)
+            goto end;
+    }
+
+    ntruenc_batch_transpose(batch->c, v, n, 0);
+    batch->cnt = cnt;
+end:
+    if (v != NULL) free(v);
+    return ret;
+}
+
+/**
+ * Pack the encrypted values in the batch.
+ * The values are transposed out of the batch with SIMD operations and then
+ * each is packed in the format.
+ *
+ * @param [in] batch   The batch object.
+ * @param [in] format  The packing format. e.g. NTRU_FORMAT_11BITS.
+ * @param [in] enc     The buffers to hold the encrypted values: one for each
+ *                     value in the batch.
+ * @param [in] elen    The length of each buffer in bytes.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_BAD_DATA when the format is not supported.<br>
+ *          NTRU_ERR_BAD_LEN when a buffer is too small.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          0 otheriwise.
+ */
+int NTRUENC_BATCH_store(NTRUENC_BATCH *batch, int format, unsigned char **enc,
+    int elen)
+{
+    int ret = 0;
+    int i, n;
+    short *v = NULL;
+
+    if ((batch == NULL) || (enc == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    n = batch->params->n;
+    v = malloc(n * NTRU_BATCH_MAX * sizeof(*v));
+    if (v == NULL)
+    {
+        ret = NTRU_ERR_ALLOC;
+        goto end;
+    }
+
+    ntruenc_batch_transpose(batch->c, v, n, 1);
+
+    for (i=0; i<batch->cnt; i++)
+    {
+        if (enc[i] == NULL)
+        {
+            ret = NTRU_ERR_PARAM_NULL;
+            goto end;
+        }
+        ret = ntruenc_pack(v + i * n, n, format, enc[i], elen);
+        if (ret != 0)
+            goto end;
+    }
+end:
+    if (v != NULL) free(v);
+    return ret;
+}
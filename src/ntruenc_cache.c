@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "ntruenc_lcl.h"
+#include "ntruenc_key_lcl.h"
+
+/** The number of operation objects cached: one for each parameter set. */
+#define NTRU_CACHE_MAX		4
+
+/**
+ * Operation objects cached by a thread for the one-shot operations.
+ */
+typedef struct ntruenc_cache_st
+{
+    /** The strength of the parameters each operation object is for. */
+    short strength[NTRU_CACHE_MAX];
+    /** Operation objects with the arena allocated and the DRBG seeded. */
+    NTRUENC *ne[NTRU_CACHE_MAX];
+} NTRUENC_CACHE;
+
+/** Cache of operation objects - one per thread. */
+static __thread NTRUENC_CACHE *ntruenc_thread_cache = NULL;
+/** Key used to dispose of the thread's cache when the thread exits. */
+static pthread_key_t ntruenc_cache_key;
+/** Ensures the thread exit key is only created once. */
+static pthread_once_t ntruenc_cache_once = PTHREAD_ONCE_INIT;
+/** Indicates whether the thread exit key was created. */
+static int ntruenc_cache_key_ok = 0;
+
+/**
+ * Dispose of a cache and the operation objects in it.
+ * Called by the thread that owns the cache, including as the thread exit
+ * destructor, and so the thread's pointer to the cache is cleared.
+ * Later one-shot calls in the thread, such as from other destructors,
+ * create a new cache.
+ *
+ * @param [in] cache  The cache.
+ */
+static void ntruenc_cache_free(void *cache)
+{
+    NTRUENC_CACHE *c = cache;
+    int i;
+
+    if (c != NULL)
+    {
+        if (ntruenc_thread_cache == c)
+            ntruenc_thread_cache = NULL;
+        for (i=0; i<NTRU_CACHE_MAX; i++)
+            NTRUENC_free(c->ne[i]);
+        free(c);
+    }
+}
+
+/**
+ * Create the key that disposes of caches when threads exit.
+ */
+static void ntruenc_cache_key_create(void)
+{
+    ntruenc_cache_key_ok =
+        (pthread_key_create(&ntruenc_cache_key, ntruenc_cache_free) == 0);
+}
+
+/**
+ * Get the calling thread's cached operation object for the parameters.
+ * The cache and operation object are created on first use.
+ *
+ * @param [in]  params  The NTRU parameters of the key.
+ * @param [out] ne      The cached operation object.
+ * @return  NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          NTRU_ERR_NOT_FOUND when no implementation for the parameters or
+ *          the cache is full.<br>
+ *          NTRU_ERR_RANDOM when the random number generator fails.<br>
+ *          0 otherwise.
+ */
+static int ntruenc_cache_get(NTRUENC_PARAMS *params, NTRUENC **ne)
+{
+    int ret = 0;
+    int i;
+    NTRUENC_CACHE *c = ntruenc_thread_cache;
+
+    if (c == NULL)
+    {
+        pthread_once(&ntruenc_cache_once, ntruenc_cache_key_create);
+        c = malloc(sizeof(*c));
+        if (c == NULL)
+        {
+            ret = NTRU_ERR_ALLOC;
+            goto end;
+        }
+        memset(c, 0, sizeof(*c));
+        if (ntruenc_cache_key_ok)
+            pthread_setspecific(ntruenc_cache_key, c);
+        ntruenc_thread_cache = c;
+    }
+
+    for (i=0; (i<NTRU_CACHE_MAX) && (c->ne[i] != NULL); i++)
+    {
+        if (c->strength[i] == params->strength)
+            break;
+    }
+    if (i == NTRU_CACHE_MAX)
+    {
+        ret = NTRU_ERR_NOT_FOUND;
+        goto end;
+    }
+    if (c->ne[i] == NULL)
+    {
+        ret = NTRUENC_new(params->strength, 0, &c->ne[i]);
+        if (ret != 0)
+            goto end;
+        c->strength[i] = params->strength;
+    }
+
+    *ne = c->ne[i];
+end:
+    return ret;
+}
+
+/**
+ * Encrypt with the public key in one call.
+ * Uses an operation object cached by the calling thread so that no memory
+ * is allocated after the first call for the parameters. The default formats
+ * of encrypted data and messages are used.
+ *
+ * @param [in] pub   The public key.
+ * @param [in] data  The encoded message or key to encrypt.
+ * @param [in] len   The length of the encoded message or key.
+ * @param [in] enc   The buffer to hold encrypted data.
+ * @param [in] elen  The length of the buffer.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          NTRU_ERR_NOT_FOUND when no implementation for the parameters.<br>
+ *          NTRU_ERR_BAD_DATA when the public key has no value.<br>
+ *          NTRU_ERR_BAD_LEN when the buffer is too short.<br>
+ *          NTRU_ERR_RANDOM when generating random fails.<br>
+ *          0 otheriwise.
+ */
+int NTRUENC_encrypt_oneshot(NTRUENC_PUB_KEY *pub, unsigned char *data,
+    int len, unsigned char *enc, int elen)
+{
+    int ret;
+    NTRUENC *ne = NULL;
+
+    if ((pub == NULL) || (data == NULL) || (enc == NULL))
+        return NTRU_ERR_PARAM_NULL;
+
+    ret = ntruenc_cache_get(pub->params, &ne);
+    if (ret == 0)
+        ret = NTRUENC_encrypt_init(ne, pub);
+    if (ret == 0)
+        ret = NTRUENC_encrypt(ne, data, len, enc, elen);
+    NTRUENC_encrypt_final(ne);
+
+    return ret;
+}
+
+/**
+ * Decrypt with the private key in one call.
+ * Uses an operation object cached by the calling thread so that no memory
+ * is allocated after the first call for the parameters. The default format
+ * of messages is used.
+ *
+ * @param [in]  priv  The private key.
+ * @param [in]  enc   The encrypted data.
+ * @param [in]  elen  The length of the encrypted data.
+ * @param [in]  data  The buffer to hold the decrypted data.
+ * @param [in]  len   The length of the buffer.
+ * @param [out] olen  The length of the decrypted data.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          NTRU_ERR_NOT_FOUND when no implementation for the parameters.<br>
+ *          NTRU_ERR_BAD_LEN when a length is invalid.<br>
+ *          NTRU_ERR_BAD_DATA when the encrypted data is invalid.<br>
+ *          0 otheriwise.
+ */
+int NTRUENC_decrypt_oneshot(NTRUENC_PRIV_KEY *priv, unsigned char *enc,
+    int elen, unsigned char *data, int len, int *olen)
+{
+    int ret;
+    NTRUENC *ne = NULL;
+
+    if ((priv == NULL) || (enc == NULL) || (data == NULL) || (olen == NULL))
+        return NTRU_ERR_PARAM_NULL;
+
+    ret = ntruenc_cache_get(priv->params, &ne);
+    if (ret == 0)
+        ret = NTRUENC_decrypt_init(ne, priv);
+    if (ret == 0)
+        ret = NTRUENC_decrypt(ne, enc, elen, data, len, olen);
+    NTRUENC_decrypt_final(ne);
+
+    return ret;
+}
+
+/**
+ * Dispose of the operation objects cached by the calling thread.
+ * Called automatically when a thread exits - call from the main thread, or
+ * to release the memory of a thread early.
+ */
+void NTRUENC_thread_cleanup(void)
+{
+    if (ntruenc_thread_cache != NULL)
+    {
+        if (ntruenc_cache_key_ok)
+            pthread_setspecific(ntruenc_cache_key, NULL);
+        ntruenc_cache_free(ntruenc_thread_cache);
+    }
+}
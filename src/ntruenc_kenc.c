@@ -26,64 +26,43 @@
 #include "ntruenc_lcl.h"
 #include "ntruenc_key_lcl.h"
 
+/** The length of a private key encoded as a seed: format, seed and counter. */
+#define NTRU_PRIV_KEY_SEED_ENC_LEN	(1 + NTRU_KEY_SEED_LEN + 1)
+
 /**
- * Encodes an NTRU vector as packed 12-bit data.
+ * Regenerate the private key vector f from the key's seed.
+ * Samples f the same way as key generation and so needs no inverse.
  *
- * @param [in]  a     The NTRU vector.
- * @param [in]  n     The number of elements in the NTRU vector.
- * @param [in]  data  The buffer to hold encoded data.
- * @param [out] len   The number of bytes of encoded data.
+ * @param [in] key  The private key with the seed set.
+ * @return  NTRU_ERR_NOT_FOUND when no implementation for the parameters.<br>
+ *          NTRU_ERR_RANDOM when generating random fails.<br>
+ *          0 otherwise.
  */
-static void ntruenc_encode_12bits(short *a, int n, unsigned char *data,
-    int *len)
+static int ntruenc_priv_key_expand(NTRUENC_PRIV_KEY *key)
 {
-    int i, j;
+    int ret;
+    NTRUENC_METHS *meths;
+    NTRU_DRBG drbg;
 
-    for (i=0,j=0; i<(n/2)*2; i+=2,j+=3)
-    {
-        data[j+0] =                           ((a[i+0]        ) << 0);
-        data[j+1] = ((a[i+0] & 0xf00) >> 8) | ((a[i+1] & 0x00f) << 4);
-        data[j+2] = ((a[i+1] & 0xff0) >> 4);
-    }
-    if ((n & 1) == 1)
-    {
-        data[j+0] =                           ((a[i+0] & 0x0ff) << 0);
-        data[j+1] = ((a[i+0] & 0xf00) >> 8);
-        j += 2;
-    }
-    if (len != NULL)
-        *len = j;
-}
+    ret = ntruenc_meths_get(key->params->strength, 0, &meths);
+    if (ret != 0)
+        goto end;
 
-/**
- * Decodes packed 12-bit data into an NTRU vector.
- *
- * @param [in]  data  The buffer holding the encoded data.
- * @param [in]  n     The number of elements in the NTRU vector.
- * @param [in]  a     The NTRU vector.
- * @param [out] len   The number of bytes of encoded data.
- */
-static void ntruenc_decode_12bits(unsigned char *data, int n, short *a,
-    int *len)
-{
-    int i, j;
+    ntruenc_priv_key_seed_drbg(key, &drbg);
+    ret = meths->random(key->f, key->params->df, key->params->df, 3, &drbg);
+    ntru_drbg_final(&drbg);
+    if (ret != 0)
+        goto end;
 
-    for (i=0,j=0; i<(n/2)*2; i+=2,j+=3)
-    {
-        a[i+0] = ((data[j+0]       ) >> 0) | ((short)(data[j+1] & 0x0f) << 8);
-        a[i+1] = ((data[j+1] & 0xf0) >> 4) | ((short)(data[j+2]       ) << 4);
-    }
-    if ((n & 1) == 1)
-    {
-        a[i+0] = ((data[j+0]       ) >> 0) | ((short)(data[j+1] & 0x0f) << 8);
-        j += 2;
-    }
-    if (len != NULL)
-        *len = j;
+    key->f[0] += 1;
+end:
+    return ret;
 }
 
+
 /**
  * Retrieves the length of an encoded private key.
+ * The length is of the legacy 12-bit format.
  *
  * @param [in]  key  The private key object.
  * @param [out] len  The length of an encoded private key.
@@ -91,9 +70,23 @@ static void ntruenc_decode_12bits(unsigned char *data, int n, short *a,
  *          0 otherwise.
  */
 int NTRUENC_PRIV_KEY_get_len(NTRUENC_PRIV_KEY *key, int *len)
+{
+    return NTRUENC_PRIV_KEY_get_len_ex(key, NTRU_FORMAT_12BITS, len);
+}
+
+/**
+ * Retrieves the length of an encoded private key in the format.
+ *
+ * @param [in]  key     The private key object.
+ * @param [in]  format  The encoding format. e.g. NTRU_FORMAT_TERNARY.
+ * @param [out] len     The length of an encoded private key.
+ * @return  NTRU_ERR_PARAM_NULL when a calling parameter is NULL.<br>
+ *          NTRU_ERR_BAD_DATA when the format is not supported.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_PRIV_KEY_get_len_ex(NTRUENC_PRIV_KEY *key, int format, int *len)
 {
     int ret = 0;
-    int n = key->params->n;
 
     if ((key == NULL) || (len == NULL))
     {
@@ -101,13 +94,20 @@ int NTRUENC_PRIV_KEY_get_len(NTRUENC_PRIV_KEY *key, int *len)
         goto end;
     }
 
-    *len = (n*12+6)/8;
+    if (format == NTRU_FORMAT_TERNARY)
+        *len = ntruenc_pack_trits_len(key->params->n);
+    else if (format == NTRU_FORMAT_SEED)
+        *len = NTRU_PRIV_KEY_SEED_ENC_LEN;
+    else
+        *len = ntruenc_pack_len(key->params->n, format);
+    if (*len == 0)
+        ret = NTRU_ERR_BAD_DATA;
 end:
     return ret;
 }
 
 /**
- * Encode the private key.
+ * Encode the private key in the legacy 12-bit format.
  * The required length for encoding is available through:
  *   NTRUENC_PRIV_KEY_get_len()
  *
@@ -120,9 +120,29 @@ end:
  *          0 otherwise.
  */
 int NTRUENC_PRIV_KEY_encode(NTRUENC_PRIV_KEY *key, unsigned char *data, int len)
+{
+    return NTRUENC_PRIV_KEY_encode_ex(key, NTRU_FORMAT_12BITS, data, len);
+}
+
+/**
+ * Encode the private key in the format.
+ * The required length for encoding is available through:
+ *   NTRUENC_PRIV_KEY_get_len_ex()
+ *
+ * @param [in] key     The key to encode.
+ * @param [in] format  The encoding format. e.g. NTRU_FORMAT_TERNARY.
+ * @param [in] data    The buffer to hold the encoded data.
+ * @param [in] len     The length of the buffer.
+ * @return  NTRU_ERR_PARAM_NULL when a required parameter is NULL.<br>
+ *          NTRU_ERR_BAD_LEN when the buffer is too small for encoded data.<br>
+ *          NTRU_ERR_BAD_DATA when the key is missing data to encode or the
+ *          format is not supported.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_PRIV_KEY_encode_ex(NTRUENC_PRIV_KEY *key, int format,
+    unsigned char *data, int len)
 {
     int ret = 0;
-    int n = key->params->n;
 
     if ((key == NULL) || (data == NULL))
     {
@@ -130,61 +150,93 @@ int NTRUENC_PRIV_KEY_encode(NTRUENC_PRIV_KEY *key, unsigned char *data, int len)
         goto end;
     }
 
-    /* f is 12-bits */
-    if (len < (n*12+6)/8)
-    {
-        ret = NTRU_ERR_BAD_LEN;
-        goto end;
-    }
-
     if (key->f == NULL)
     {
         ret = NTRU_ERR_BAD_DATA;
         goto end;
     }
 
-    ntruenc_encode_12bits(key->f, n, data, NULL);
+    if (format == NTRU_FORMAT_SEED)
+    {
+        if (!key->seeded)
+            ret = NTRU_ERR_BAD_DATA;
+        else if (len < NTRU_PRIV_KEY_SEED_ENC_LEN)
+            ret = NTRU_ERR_BAD_LEN;
+        else
+        {
+            data[0] = NTRU_FORMAT_SEED;
+            memcpy(data + 1, key->seed, sizeof(key->seed));
+        }
+    }
+    else if (format == NTRU_FORMAT_TERNARY)
+        ret = ntruenc_pack_trits(key->f, key->params->n, data, len);
+    else
+        ret = ntruenc_pack(key->f, key->params->n, format, data, len);
 end:
     return ret;
 }
 
 /**
  * Decodes the private key data into a private key object.
+ * The format of the encoding is detected.
  *
  * @param [in] key   The key to encode.
  * @param [in] data  The buffer to hold the encoded data.
  * @param [in] len   The length of the buffer.
  * @return  NTRU_ERR_PARAM_NULL when a required parameter is NULL.<br>
  *          NTRU_ERR_BAD_LEN when the buffer is too small.<br>
+ *          NTRU_ERR_BAD_DATA when the encoded data is invalid.<br>
  *          NTRU_ERR_ALLOC when unable to allocate memory.<br>
  *          0 otherwise.
  */
 int NTRUENC_PRIV_KEY_decode(NTRUENC_PRIV_KEY *key, unsigned char *data, int len)
 {
     int ret = 0;
-    int n = key->params->n;
+    int n;
 
     if ((key == NULL) || (data == NULL))
     {
         ret = NTRU_ERR_PARAM_NULL;
         goto end;
     }
+    n = key->params->n;
 
-    /* f is 12-bits */
-    if (len < (n*12+6)/8)
+    if ((len != NTRU_PRIV_KEY_SEED_ENC_LEN) &&
+        (len != ntruenc_pack_trits_len(n)) &&
+        (len < ntruenc_pack_len(n, NTRU_FORMAT_11BITS)))
     {
         ret = NTRU_ERR_BAD_LEN;
         goto end;
     }
 
-    if (key->f == NULL) key->f = malloc(sizeof(*key->f) * n);
+#ifndef NTRUENC_STATIC
+    if (key->f == NULL) key->f = ntruenc_vec_alloc(n, 1);
+#else
+    key->f = NTRU_VEC_ALIGN_PTR(key->f_data);
+#endif
     if (key->f == NULL)
     {
         ret = NTRU_ERR_ALLOC;
         goto end;
     }
 
-    ntruenc_decode_12bits(data, n, key->f, NULL);
+    memset(key->seed, 0, sizeof(key->seed));
+    key->seeded = 0;
+    if (len == NTRU_PRIV_KEY_SEED_ENC_LEN)
+    {
+        if (data[0] != NTRU_FORMAT_SEED)
+        {
+            ret = NTRU_ERR_BAD_DATA;
+            goto end;
+        }
+        memcpy(key->seed, data + 1, sizeof(key->seed));
+        key->seeded = 1;
+        ret = ntruenc_priv_key_expand(key);
+    }
+    else if (len == ntruenc_pack_trits_len(n))
+        ret = ntruenc_unpack_trits(data, len, n, key->f);
+    else
+        ret = ntruenc_unpack(data, len, n, key->f);
 end:
     return ret;
 }
@@ -192,6 +244,7 @@ end:
 
 /**
  * Retrieves the length of an encoded public key.
+ * The length is of the legacy 12-bit format.
  *
  * @param [in]  key  The public key object.
  * @param [out] len  The length of an encoded public key.
@@ -199,9 +252,23 @@ end:
  *          0 otherwise.
  */
 int NTRUENC_PUB_KEY_get_len(NTRUENC_PUB_KEY *key, int *len)
+{
+    return NTRUENC_PUB_KEY_get_len_ex(key, NTRU_FORMAT_12BITS, len);
+}
+
+/**
+ * Retrieves the length of an encoded public key in the format.
+ *
+ * @param [in]  key     The public key object.
+ * @param [in]  format  The encoding format. e.g. NTRU_FORMAT_11BITS.
+ * @param [out] len     The length of an encoded public key.
+ * @return  NTRU_ERR_PARAM_NULL when a calling parameter is NULL.<br>
+ *          NTRU_ERR_BAD_DATA when the format is not supported.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_PUB_KEY_get_len_ex(NTRUENC_PUB_KEY *key, int format, int *len)
 {
     int ret = 0;
-    int n = key->params->n;
 
     if ((key == NULL) || (len == NULL))
     {
@@ -209,13 +276,15 @@ int NTRUENC_PUB_KEY_get_len(NTRUENC_PUB_KEY *key, int *len)
         goto end;
     }
 
-    *len = (n*12+6)/8;
+    *len = ntruenc_pack_len(key->params->n, format);
+    if (*len == 0)
+        ret = NTRU_ERR_BAD_DATA;
 end:
     return ret;
 }
 
 /**
- * Encode the public key.
+ * Encode the public key in the legacy 12-bit format.
  * The required length for encoding is available through:
  *   NTRUENC_PUB_KEY_get_len()
  *
@@ -228,9 +297,29 @@ end:
  *          0 otherwise.
  */
 int NTRUENC_PUB_KEY_encode(NTRUENC_PUB_KEY *key, unsigned char *data, int len)
+{
+    return NTRUENC_PUB_KEY_encode_ex(key, NTRU_FORMAT_12BITS, data, len);
+}
+
+/**
+ * Encode the public key in the format.
+ * The required length for encoding is available through:
+ *   NTRUENC_PUB_KEY_get_len_ex()
+ *
+ * @param [in] key     The key to encode.
+ * @param [in] format  The encoding format. e.g. NTRU_FORMAT_11BITS.
+ * @param [in] data    The buffer to hold the encoded data.
+ * @param [in] len     The length of the buffer.
+ * @return  NTRU_ERR_PARAM_NULL when a required parameter is NULL.<br>
+ *          NTRU_ERR_BAD_LEN when the buffer is too small for encoded data.<br>
+ *          NTRU_ERR_BAD_DATA when the key is missing data to encode or the
+ *          format is not supported.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_PUB_KEY_encode_ex(NTRUENC_PUB_KEY *key, int format,
+    unsigned char *data, int len)
 {
     int ret = 0;
-    int n = key->params->n;
 
     if ((key == NULL) || (data == NULL))
     {
@@ -238,62 +327,109 @@ int NTRUENC_PUB_KEY_encode(NTRUENC_PUB_KEY *key, unsigned char *data, int len)
         goto end;
     }
 
-    /* h is 12-bits */
-    if (len < (n*12+6)/8)
-    {
-        ret = NTRU_ERR_BAD_LEN;
-        goto end;
-    }
-
     if (key->h == NULL)
     {
         ret = NTRU_ERR_BAD_DATA;
         goto end;
     }
 
-    ntruenc_encode_12bits(key->h, n, data, NULL);
+    ret = ntruenc_pack(key->h, key->params->n, format, data, len);
 end:
     return ret;
 }
 
 /**
  * Decodes the public key data into a public key object.
+ * The format of the encoding is detected.
  *
  * @param [in] key   The key to encode.
  * @param [in] data  The buffer to hold the encoded data.
  * @param [in] len   The length of the buffer.
  * @return  NTRU_ERR_PARAM_NULL when a required parameter is NULL.<br>
  *          NTRU_ERR_BAD_LEN when the buffer is too small.<br>
+ *          NTRU_ERR_BAD_DATA when the encoded data is invalid.<br>
  *          NTRU_ERR_ALLOC when unable to allocate memory.<br>
  *          0 otherwise.
  */
 int NTRUENC_PUB_KEY_decode(NTRUENC_PUB_KEY *key, unsigned char *data, int len)
 {
     int ret = 0;
-    int n = key->params->n;
+    int n;
 
     if ((key == NULL) || (data == NULL))
     {
         ret = NTRU_ERR_PARAM_NULL;
         goto end;
     }
+    n = key->params->n;
 
-    /* y is 12-bits, r1 is 2-bits */
-    if (len < (n*12+6)/8)
+    if (len < ntruenc_pack_len(n, NTRU_FORMAT_11BITS))
     {
         ret = NTRU_ERR_BAD_LEN;
         goto end;
     }
 
-    if (key->h == NULL) key->h = malloc(sizeof(*key->h) * n);
+    /* Views don't own the memory - decode into a new buffer. */
+    if (key->view)
+    {
+        key->h = NULL;
+        key->view = 0;
+    }
+    key->packed = NULL;
+    key->packed_len = 0;
+#ifndef NTRUENC_STATIC
+    if (key->h == NULL) key->h = ntruenc_vec_alloc(n, 1);
+#else
+    key->h = NTRU_VEC_ALIGN_PTR(key->h_data);
+#endif
     if (key->h == NULL)
     {
         ret = NTRU_ERR_ALLOC;
         goto end;
     }
 
-    ntruenc_decode_12bits(data, n, key->h, NULL);
+    ret = ntruenc_unpack(data, len, n, key->h);
 end:
     return ret;
 }
 
+/**
+ * Sets the public key to reference the encoded key data.
+ * The data is not copied or decoded: it is unpacked into the temporary
+ * data of the operation object when encryption is initialized.
+ * The data must not be changed or freed while the key is in use.
+ *
+ * @param [in] key   The public key.
+ * @param [in] data  The encoded key data.
+ * @param [in] len   The length of the encoded key data.
+ * @return  NTRU_ERR_PARAM_NULL when a required parameter is NULL.<br>
+ *          NTRU_ERR_BAD_LEN when the data is too small.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_PUB_KEY_set_packed(NTRUENC_PUB_KEY *key, unsigned char *data,
+    int len)
+{
+    int ret = 0;
+
+    if ((key == NULL) || (data == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (len < ntruenc_pack_len(key->params->n, NTRU_FORMAT_11BITS))
+    {
+        ret = NTRU_ERR_BAD_LEN;
+        goto end;
+    }
+
+#ifndef NTRUENC_STATIC
+    if ((!key->view) && (key->h != NULL))
+        free(key->h);
+#endif
+    key->h = NULL;
+    key->view = 0;
+    key->packed = data;
+    key->packed_len = len;
+end:
+    return ret;
+}
@@ -79,6 +79,28 @@ end:
     return ret;
 }
 
+#ifndef NTRUENC_STATIC
+/**
+ * Allocate NTRU vectors with the layout of the library.
+ * Each vector is padded to a multiple of NTRU_VEC_PAD elements and aligned to
+ * NTRU_VEC_ALIGN bytes. All elements are zero. Dispose of with free().
+ *
+ * @param [in] n    The number of elements in a vector.
+ * @param [in] cnt  The number of vectors.
+ * @return  NULL on failure to allocate.<br>
+ *          The vectors otherwise.
+ */
+short *ntruenc_vec_alloc(int n, int cnt)
+{
+    short *v;
+    size_t len = (size_t)cnt * NTRU_VEC_LEN(n) * sizeof(*v);
+
+    v = aligned_alloc(NTRU_VEC_ALIGN, len);
+    if (v != NULL)
+        memset(v, 0, len);
+    return v;
+}
+
 /**
  * Allocate and initialize a private key.
  *
@@ -116,6 +138,18 @@ end:
     NTRUENC_PRIV_KEY_free(k);
     return ret;
 }
+#endif
+
+/**
+ * Get the size of the private key object.
+ * Use to provide the storage of an object to NTRUENC_PRIV_KEY_init().
+ *
+ * @return  The size of the object in bytes.
+ */
+int NTRUENC_PRIV_KEY_get_obj_size(void)
+{
+    return sizeof(NTRUENC_PRIV_KEY);
+}
 
 /**
  * Initialize a private key object.
@@ -123,6 +157,8 @@ end:
  * @param [in] key     The private key.
  * @param [in] params  The NTRU encryption parameters.
  * @return  NTRU_ERR_PARAM_NULL when a calling parameter is NULL.<br>
+ *          NTRU_ERR_BAD_DATA when the parameters are too big for the storage
+ *          in the object.<br>
  *          0 otherwise.
  */
 int NTRUENC_PRIV_KEY_init(NTRUENC_PRIV_KEY *key, NTRUENC_PARAMS *params)
@@ -134,6 +170,13 @@ int NTRUENC_PRIV_KEY_init(NTRUENC_PRIV_KEY *key, NTRUENC_PARAMS *params)
         ret = NTRU_ERR_PARAM_NULL;
         goto end;
     }
+#ifdef NTRUENC_STATIC
+    if (params->n > NTRUENC_STATIC_N)
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+#endif
 
     memset(key, 0, sizeof(*key));
 
@@ -152,10 +195,31 @@ void NTRUENC_PRIV_KEY_final(NTRUENC_PRIV_KEY *key)
 {
     if (key != NULL)
     {
+#ifndef NTRUENC_STATIC
         if (key->f != NULL) free(key->f);
+#else
+        /* Zeroize the secret value and padding as the storage is reused. */
+        memset(key->f_data, 0, sizeof(key->f_data));
+        key->f = NULL;
+#endif
+        memset(key->seed, 0, sizeof(key->seed));
+        key->seeded = 0;
     }
 }
 
+/**
+ * Seed a random number generator with the private key's seed and attempt
+ * counter.
+ *
+ * @param [in] key   The private key with the seed set.
+ * @param [in] drbg  The random number generator to seed.
+ */
+void ntruenc_priv_key_seed_drbg(NTRUENC_PRIV_KEY *key, NTRU_DRBG *drbg)
+{
+    ntru_drbg_seed(drbg, key->seed, sizeof(key->seed));
+}
+
+#ifndef NTRUENC_STATIC
 /**
  * Frees the private key fields and object.
  *
@@ -169,6 +233,7 @@ void NTRUENC_PRIV_KEY_free(NTRUENC_PRIV_KEY *key)
         free(key);
     }
 }
+#endif
 
 /**
  * Retrieves the number of elements in an NTRU vector.
@@ -194,6 +259,7 @@ end:
 }
 
 
+#ifndef NTRUENC_STATIC
 /**
  * Allocate and initialize a public key.
  *
@@ -231,6 +297,18 @@ end:
     NTRUENC_PUB_KEY_free(k);
     return ret;
 }
+#endif
+
+/**
+ * Get the size of the public key object.
+ * Use to provide the storage of an object to NTRUENC_PUB_KEY_init().
+ *
+ * @return  The size of the object in bytes.
+ */
+int NTRUENC_PUB_KEY_get_obj_size(void)
+{
+    return sizeof(NTRUENC_PUB_KEY);
+}
 
 /**
  * Initialize a public key object.
@@ -238,6 +316,8 @@ end:
  * @param [in] key       The public key.
  * @param [in] params  The NTRU encryption parameters.
  * @return  NTRU_ERR_PARAM_NULL when a calling parameter is NULL.<br>
+ *          NTRU_ERR_BAD_DATA when the parameters are too big for the storage
+ *          in the object.<br>
  *          0 otherwise.
  */
 int NTRUENC_PUB_KEY_init(NTRUENC_PUB_KEY *key, NTRUENC_PARAMS *params)
@@ -249,6 +329,13 @@ int NTRUENC_PUB_KEY_init(NTRUENC_PUB_KEY *key, NTRUENC_PARAMS *params)
         ret = NTRU_ERR_PARAM_NULL;
         goto end;
     }
+#ifdef NTRUENC_STATIC
+    if (params->n > NTRUENC_STATIC_N)
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+#endif
 
     memset(key, 0, sizeof(*key));
 
@@ -267,10 +354,15 @@ void NTRUENC_PUB_KEY_final(NTRUENC_PUB_KEY *key)
 {
     if (key != NULL)
     {
-        if (key->h != NULL) free(key->h);
+#ifndef NTRUENC_STATIC
+        if ((key->h != NULL) && (!key->view)) free(key->h);
+#else
+        key->h = NULL;
+#endif
     }
 }
 
+#ifndef NTRUENC_STATIC
 /**
  * Frees the public key fields and object.
  *
@@ -284,6 +376,7 @@ void NTRUENC_PUB_KEY_free(NTRUENC_PUB_KEY *key)
         free(key);
     }
 }
+#endif
 
 /**
  * Retrieves the number of elements in an NTRU vector.
@@ -310,6 +403,7 @@ end:
 
 /**
  * Retrieves the number of bytes in an NTRU Encryption.
+ * The length is of the legacy 12-bit format.
  *
  * @param [in]  key  The public key object.
  * @param [out] len  The number of byes in an NTRU Encryption.
@@ -317,6 +411,22 @@ end:
  *          0 otherwise.
  */
 int NTRUENC_PUB_KEY_get_enc_len(NTRUENC_PUB_KEY *key, int *len)
+{
+    return NTRUENC_PUB_KEY_get_enc_len_ex(key, NTRU_FORMAT_12BITS, len);
+}
+
+/**
+ * Retrieves the number of bytes in an NTRU Encryption in the format.
+ *
+ * @param [in]  key     The public key object.
+ * @param [in]  format  The encoding format. e.g. NTRU_FORMAT_11BITS.
+ * @param [out] len     The number of byes in an NTRU Encryption.
+ * @return  NTRU_ERR_PARAM_NULL when a calling parameter is NULL.<br>
+ *          NTRU_ERR_BAD_DATA when the format is not supported.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_PUB_KEY_get_enc_len_ex(NTRUENC_PUB_KEY *key, int format,
+    int *len)
 {
     int ret = 0;
 
@@ -326,7 +436,9 @@ int NTRUENC_PUB_KEY_get_enc_len(NTRUENC_PUB_KEY *key, int *len)
         goto end;
     }
 
-    *len = (key->params->n * 12 + 7) / 8;
+    *len = ntruenc_pack_len(key->params->n, format);
+    if (*len == 0)
+        ret = NTRU_ERR_BAD_DATA;
 end:
     return ret;
 }
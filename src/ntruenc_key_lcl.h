@@ -26,6 +26,23 @@
 
 #include "ntruenc_key.h"
 
+/*
+ * Layout of NTRU vectors: padded to a multiple of NTRU_VEC_PAD elements with
+ * the padding zero, and aligned to NTRU_VEC_ALIGN bytes. Loops can operate on
+ * whole SIMD registers without handling the tail.
+ */
+/** The alignment in bytes of NTRU vectors: a cache line. */
+#define NTRU_VEC_ALIGN		64
+/** The number of elements that vectors are padded to a multiple of. */
+#define NTRU_VEC_PAD		32
+/** The number of elements in a padded NTRU vector of n elements. */
+#define NTRU_VEC_LEN(n)		\
+    (((n) + NTRU_VEC_PAD - 1) & ~(NTRU_VEC_PAD - 1))
+/** Align a pointer up to the alignment of NTRU vectors. */
+#define NTRU_VEC_ALIGN_PTR(p)	\
+    ((short *)(((size_t)(p) + NTRU_VEC_ALIGN - 1) & \
+               ~(size_t)(NTRU_VEC_ALIGN - 1)))
+
 /**
  * The parameters structure for NTRU.
  */
@@ -52,6 +69,14 @@ struct ntruenc_priv_key_st
     NTRUENC_PARAMS *params;
     /* Private key value. */
     short *f;
+    /** Seed the key was generated from followed by the attempt counter. */
+    unsigned char seed[NTRU_KEY_SEED_LEN + 1];
+    /** Indicates that the seed is set. */
+    char seeded;
+#ifdef NTRUENC_STATIC
+    /** Storage of the private key value - f references it when set. */
+    short f_data[NTRU_VEC_LEN(NTRUENC_STATIC_N) + NTRU_VEC_PAD];
+#endif
 };
 
 struct ntruenc_pub_key_st
@@ -60,6 +85,16 @@ struct ntruenc_pub_key_st
     NTRUENC_PARAMS *params;
     /* Public key value. */
     short *h;
+    /** Indicates h references memory not owned by the key. e.g. a store. */
+    char view;
+    /** Caller owned encoding of the key used when h is NULL. */
+    unsigned char *packed;
+    /** The length of the encoded key in bytes. */
+    int packed_len;
+#ifdef NTRUENC_STATIC
+    /** Storage of the public key value - h references it when set. */
+    short h_data[NTRU_VEC_LEN(NTRUENC_STATIC_N) + NTRU_VEC_PAD];
+#endif
 };
 
 #endif /* NTRUENC_KEY_LCL_H */
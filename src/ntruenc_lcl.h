@@ -22,6 +22,8 @@
 
 #include "ntruenc.h"
 #include "ntruenc_key.h"
+#include "ntruenc_key_lcl.h"
+#include "random.h"
 
 /**
  * The method table for NTRU Encryption operations.
@@ -39,13 +41,23 @@ typedef struct ntruenc_meths_st
     /** Number of NTRU vectors required for key generation by implementation. */
     char keygen_num;
     /** Function to perform encryption. */
-    int (*enc)(short *e, short *m, short *h, short *t);
+    int (*enc)(short *e, short *m, short *h, short *t, NTRU_DRBG *drbg);
     /** Function to perform decryption. */
     void (*dec)(short *c, short *e, short *f, short *t);
     /** Function to perform key generation. */
-    int (*keygen)(short *f, short *h, short *t);
+    int (*keygen)(short *f, short *h, short *t, NTRU_DRBG *drbg);
+    /** Function to generate the message independent part of encryption. */
+    int (*blind)(short *b, short *h, short *t, NTRU_DRBG *drbg);
+    /** Function to perform encryption with a precomputed blinding value. */
+    void (*enc_blinded)(short *e, short *m, short *b);
+    /** Function to generate a random NTRU vector. */
+    int (*random)(short *a, int df1, int df2, short v, NTRU_DRBG *drbg);
 } NTRUENC_METHS;
 
+#ifdef NTRUENC_STATIC
+/** The largest number of vectors an operation binds into the arena. */
+#define NTRU_STATIC_ARENA_NUM	4
+#endif
 
 struct ntruenc_st
 {
@@ -63,10 +75,122 @@ struct ntruenc_st
     short *enc;
     /** Temprorary dynamicly allocated data. */
     short *t;
+    /** Random number generator for this object - not shared. */
+    NTRU_DRBG drbg;
+    /** Precomputed blinding values for the public key: pre_max vectors. */
+    short *pre;
+    /** The number of precomputed blinding values not yet used. */
+    int pre_cnt;
+    /** The number of blinding values the precomputed buffer holds. */
+    int pre_max;
+    /** The padded number of elements in each precomputed blinding value. */
+    int pre_n;
+    /** The format of encrypted data output. e.g. NTRU_FORMAT_11BITS. */
+    int format;
+    /** The encoding of messages/keys into NTRU vectors. e.g. NTRU_MSG_TRITS. */
+    int msg_format;
+    /** The public key value: the key's or unpacked into temporary data. */
+    short *h;
+    /** The prepared key that the operation holds a reference to. */
+    NTRUENC_PREP_KEY *prep;
+    /** Aligned memory that m, enc and t are bound into by operations. */
+    short *arena;
+    /** The length of the arena in bytes. */
+    int arena_len;
+    /** The largest number of elements in a vector the arena holds. */
+    int arena_n;
+    /** The allocated memory that the arena is aligned in. */
+    void *arena_mem;
+#ifdef NTRUENC_STATIC
+    /** Storage of the arena - arena_mem references it. */
+    short arena_data[NTRU_STATIC_ARENA_NUM * NTRU_VEC_LEN(NTRUENC_STATIC_N) +
+        NTRU_VEC_PAD];
+#endif
 };
 
+struct ntruenc_batch_st
+{
+    /** The parameters of the encrypted values. */
+    NTRUENC_PARAMS *params;
+    /** The number of encrypted values in the batch. */
+    int cnt;
+    /** Encrypted values: element i of value k at c[i * NTRU_BATCH_MAX + k]. */
+    short *c;
+    /** The allocated memory that c is aligned in. */
+    void *mem;
+};
+
+#ifndef NTRUENC_STATIC
+#if defined(CC_GCC) || defined(CC_CLANG)
+/** A reference count updated with the atomic builtins. */
+typedef int NTRU_REF;
+/** Atomically add one to the reference count. */
+#define NTRU_REF_INC(r)		__atomic_add_fetch(r, 1, __ATOMIC_RELAXED)
+/** Atomically subtract one from the reference count and get the result. */
+#define NTRU_REF_DEC(r)		__atomic_sub_fetch(r, 1, __ATOMIC_ACQ_REL)
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && \
+    !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+/** A reference count updated with C11 atomics. */
+typedef atomic_int NTRU_REF;
+/** Atomically add one to the reference count. */
+#define NTRU_REF_INC(r)							\
+    atomic_fetch_add_explicit(r, 1, memory_order_relaxed)
+/** Atomically subtract one from the reference count and get the result. */
+#define NTRU_REF_DEC(r)							\
+    (atomic_fetch_sub_explicit(r, 1, memory_order_acq_rel) - 1)
+#else
+#error "Prepared keys need atomic operations: use GCC, Clang or C11 atomics"
+#endif
+
+struct ntruenc_prep_key_st
+{
+    /** The number of references: the creator's and those of operations. */
+    NTRU_REF ref;
+    /** The private key when prepared from one: f is owned by the object. */
+    NTRUENC_PRIV_KEY priv;
+    /** The public key when prepared from one: h is owned by the object. */
+    NTRUENC_PUB_KEY pub;
+};
+#endif
+
+/** Don't use the SSSE3 implementations. */
+#define NTRU_SIMD_SSSE3		0x01
+/** Don't use the AVX2 implementations. */
+#define NTRU_SIMD_AVX2		0x02
+/** Don't use any SIMD implementations - use the C code. */
+#define NTRU_SIMD_ALL		(NTRU_SIMD_SSSE3 | NTRU_SIMD_AVX2)
+
+extern int ntruenc_simd_off;
+
 int ntruenc_meths_get(short strength, int flags, NTRUENC_METHS **meths);
 
+void ntruenc_priv_key_seed_drbg(NTRUENC_PRIV_KEY *key, NTRU_DRBG *drbg);
+#ifndef NTRUENC_STATIC
+short *ntruenc_vec_alloc(int n, int cnt);
+#endif
+
+void ntruenc_sort_int32(int32_t *x, int n);
+
+int ntruenc_pack_len(int n, int format);
+int ntruenc_pack(short *a, int n, int format, unsigned char *data, int len);
+int ntruenc_unpack(unsigned char *data, int len, int n, short *a);
+int ntruenc_pack_trits_len(int n);
+int ntruenc_pack_trits(short *f, int n, unsigned char *data, int len);
+int ntruenc_unpack_trits(unsigned char *data, int len, int n, short *f);
+
+void ntruenc_msg_expand(unsigned char *data, int len, short *m);
+int ntruenc_msg_compact(short *m, int len, unsigned char *data);
+int ntruenc_msg_or(short *m, int n);
+int ntruenc_msg_trits_len(int len);
+void ntruenc_msg_expand_trits(unsigned char *data, int len, short *m);
+int ntruenc_msg_compact_trits(short *m, int len, unsigned char *data);
+
+void ntruenc_batch_transpose(short *c, short *v, int n, int from);
+int ntruenc_batch_mul_rows(int n);
+void ntruenc_batch_mul_mod_q(short *r, short *a, short *b, int n, int q,
+    short *t);
+
 /* Common parameter */
 #define NTRU_P		3
 
@@ -93,9 +217,13 @@ int ntruenc_meths_get(short strength, int flags, NTRUENC_METHS **meths);
  * strength of 112-bits.
  */
 #define NTRU_S112_Q_BITS	11
-int ntruenc_s112_random(short *a, int df1, int df2, short v);
-int ntruenc_s112_keygen(short *f, short *h, short *t);
-int ntruenc_s112_encrypt(short *e, short *m, short *h, short *t);
+int ntruenc_s112_random(short *a, int df1, int df2, short v,
+    NTRU_DRBG *drbg);
+int ntruenc_s112_keygen(short *f, short *h, short *t, NTRU_DRBG *drbg);
+int ntruenc_s112_encrypt(short *e, short *m, short *h, short *t,
+    NTRU_DRBG *drbg);
+int ntruenc_s112_blind(short *b, short *h, short *t, NTRU_DRBG *drbg);
+void ntruenc_s112_encrypt_blinded(short *e, short *m, short *b);
 void ntruenc_s112_decrypt(short *c, short *e, short *f, short *t);
 int ntruenc_s112_mod_inv_2(short *r, short *a);
 int ntruenc_s112_mod_inv_q(short *r, short *a);
@@ -125,9 +253,13 @@ void ntruenc_s112_mul_mod_q(short *r, short *a, short *b);
  * strength of 128-bits.
  */
 #define NTRU_S128_Q_BITS	11
-int ntruenc_s128_random(short *a, int df1, int df2, short v);
-int ntruenc_s128_keygen(short *f, short *h, short *t);
-int ntruenc_s128_encrypt(short *e, short *m, short *h, short *t);
+int ntruenc_s128_random(short *a, int df1, int df2, short v,
+    NTRU_DRBG *drbg);
+int ntruenc_s128_keygen(short *f, short *h, short *t, NTRU_DRBG *drbg);
+int ntruenc_s128_encrypt(short *e, short *m, short *h, short *t,
+    NTRU_DRBG *drbg);
+int ntruenc_s128_blind(short *b, short *h, short *t, NTRU_DRBG *drbg);
+void ntruenc_s128_encrypt_blinded(short *e, short *m, short *b);
 void ntruenc_s128_decrypt(short *c, short *e, short *f, short *t);
 int ntruenc_s128_mod_inv_2(short *r, short *a);
 int ntruenc_s128_mod_inv_q(short *r, short *a);
@@ -156,9 +288,13 @@ void ntruenc_s128_mul_mod_q(short *r, short *a, short *b);
  * strength of 192-bits.
  */
 #define NTRU_S192_Q_BITS	11
-int ntruenc_s192_random(short *a, int df1, int df2, short v);
-int ntruenc_s192_keygen(short *f, short *h, short *t);
-int ntruenc_s192_encrypt(short *e, short *m, short *h, short *t);
+int ntruenc_s192_random(short *a, int df1, int df2, short v,
+    NTRU_DRBG *drbg);
+int ntruenc_s192_keygen(short *f, short *h, short *t, NTRU_DRBG *drbg);
+int ntruenc_s192_encrypt(short *e, short *m, short *h, short *t,
+    NTRU_DRBG *drbg);
+int ntruenc_s192_blind(short *b, short *h, short *t, NTRU_DRBG *drbg);
+void ntruenc_s192_encrypt_blinded(short *e, short *m, short *b);
 void ntruenc_s192_decrypt(short *c, short *e, short *f, short *t);
 int ntruenc_s192_mod_inv_2(short *r, short *a);
 int ntruenc_s192_mod_inv_q(short *r, short *a);
@@ -187,9 +323,13 @@ void ntruenc_s192_mul_mod_q(short *r, short *a, short *b);
  * strength of 256-bits.
  */
 #define NTRU_S256_Q_BITS	11
-int ntruenc_s256_random(short *a, int df1, int df2, short v);
-int ntruenc_s256_keygen(short *f, short *h, short *t);
-int ntruenc_s256_encrypt(short *e, short *m, short *h, short *t);
+int ntruenc_s256_random(short *a, int df1, int df2, short v,
+    NTRU_DRBG *drbg);
+int ntruenc_s256_keygen(short *f, short *h, short *t, NTRU_DRBG *drbg);
+int ntruenc_s256_encrypt(short *e, short *m, short *h, short *t,
+    NTRU_DRBG *drbg);
+int ntruenc_s256_blind(short *b, short *h, short *t, NTRU_DRBG *drbg);
+void ntruenc_s256_encrypt_blinded(short *e, short *m, short *b);
 void ntruenc_s256_decrypt(short *c, short *e, short *f, short *t);
 int ntruenc_s256_mod_inv_2(short *r, short *a);
 int ntruenc_s256_mod_inv_q(short *r, short *a);
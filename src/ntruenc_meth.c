@@ -24,6 +24,13 @@
 #include <stdlib.h>
 #include "ntruenc_lcl.h"
 
+/**
+ * The SIMD instruction sets not to use: NTRU_SIMD_* bits.
+ * Set when testing to compare the SIMD implementations with the C code.
+ * Not for use while other threads are performing operations.
+ */
+int ntruenc_simd_off = 0;
+
 /**
  * NTRU Encrypt implementations.
  */
@@ -32,19 +39,27 @@ NTRUENC_METHS ntruenc_meths[] =
     /* Security strength 112 in C. */
     { 112, 0,
       1, 1, 2,
-      ntruenc_s112_encrypt, ntruenc_s112_decrypt, ntruenc_s112_keygen },
+      ntruenc_s112_encrypt, ntruenc_s112_decrypt, ntruenc_s112_keygen,
+      ntruenc_s112_blind, ntruenc_s112_encrypt_blinded,
+      ntruenc_s112_random },
     /* Security strength 128 in C. */
     { 128, 0,
       1, 1, 2,
-      ntruenc_s128_encrypt, ntruenc_s128_decrypt, ntruenc_s128_keygen },
+      ntruenc_s128_encrypt, ntruenc_s128_decrypt, ntruenc_s128_keygen,
+      ntruenc_s128_blind, ntruenc_s128_encrypt_blinded,
+      ntruenc_s128_random },
     /* Security strength 192 in C. */
     { 192, 0,
       1, 1, 2,
-      ntruenc_s192_encrypt, ntruenc_s192_decrypt, ntruenc_s192_keygen },
+      ntruenc_s192_encrypt, ntruenc_s192_decrypt, ntruenc_s192_keygen,
+      ntruenc_s192_blind, ntruenc_s192_encrypt_blinded,
+      ntruenc_s192_random },
     /* Security strength 256 in C. */
     { 256, 0,
       1, 1, 2,
-      ntruenc_s256_encrypt, ntruenc_s256_decrypt, ntruenc_s256_keygen },
+      ntruenc_s256_encrypt, ntruenc_s256_decrypt, ntruenc_s256_keygen,
+      ntruenc_s256_blind, ntruenc_s256_encrypt_blinded,
+      ntruenc_s256_random },
 };
 /**
  * The number of implementations.
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "ntruenc_lcl.h"
+
+/**
+ * Expand each bit of the data into an element of an NTRU vector.
+ * 0 -> -1
+ * 1 -> +1
+ *
+ * @param [in] data  The data to expand.
+ * @param [in] len   The length of the data in bytes.
+ * @param [in] m     The NTRU vector: len * 8 elements.
+ */
+static void ntruenc_msg_expand_c(unsigned char *data, int len, short *m)
+{
+    int i, j;
+
+    for (i=0; i<len; i++)
+    {
+        for (j=0; j<8; j++)
+            m[i*8+j] = (((data[i] >> j) & 1) << 1) - 1;
+    }
+}
+
+/**
+ * Compact the elements of an NTRU vector into the bits of the data.
+ * -1 -> 0
+ * +1 -> 1
+ * The top bit of the element is the inverse of the data bit.
+ * A 0 element is not a valid message bit and is reported.
+ *
+ * @param [in] m     The NTRU vector: len * 8 elements.
+ * @param [in] len   The length of the data in bytes.
+ * @param [in] data  The buffer to hold the data.
+ * @return  Non-zero when an element is 0.<br>
+ *          0 otherwise.
+ */
+static int ntruenc_msg_compact_c(short *m, int len, unsigned char *data)
+{
+    int i, j;
+    int r = 0;
+    unsigned char b;
+
+    for (i=0; i<len; i++)
+    {
+        b = 0;
+        for (j=0; j<8; j++)
+        {
+            r |= m[i*8+j] == 0;
+            b |= (((m[i*8+j] >> 15) + 1) & 1) << j;
+        }
+        data[i] = b;
+    }
+
+    return r;
+}
+
+/**
+ * OR together all the elements of an NTRU vector.
+ *
+ * @param [in] m  The NTRU vector.
+ * @param [in] n  The number of elements in the vector.
+ * @return  Non-zero when an element is not 0.<br>
+ *          0 otherwise.
+ */
+static int ntruenc_msg_or_c(short *m, int n)
+{
+    int i;
+    short r = 0;
+
+    for (i=0; i<n; i++)
+        r |= m[i];
+
+    return r;
+}
+
+#if defined(CPU_X86_64) && (defined(CC_GCC) || defined(CC_CLANG))
+#include <immintrin.h>
+
+/**
+ * Expand each bit of the data into an element of an NTRU vector using AVX2.
+ * Two bytes are expanded into 16 elements each iteration.
+ * Two bytes are broadcast to all 16-bit lanes and each lane tests one bit.
+ *
+ * @param [in] data  The data to expand.
+ * @param [in] len   The length of the data in bytes.
+ * @param [in] m     The NTRU vector: len * 8 elements.
+ */
+__attribute__((target("avx2")))
+static void ntruenc_msg_expand_avx2(unsigned char *data, int len, short *m)
+{
+    int i;
+    __m256i v;
+    const __m256i bits = _mm256_setr_epi16(0x0001, 0x0002, 0x0004, 0x0008,
+        0x0010, 0x0020, 0x0040, 0x0080, 0x0100, 0x0200, 0x0400, 0x0800,
+        0x1000, 0x2000, 0x4000, (short)0x8000);
+    const __m256i minus1 = _mm256_set1_epi16(-1);
+
+    for (i=0; i+2<=len; i+=2)
+    {
+        v = _mm256_set1_epi16(data[i] | (data[i+1] << 8));
+        v = _mm256_cmpeq_epi16(_mm256_and_si256(v, bits), bits);
+        /* -1 - 2 * mask: bit set -> +1, bit clear -> -1. */
+        v = _mm256_sub_epi16(minus1, _mm256_add_epi16(v, v));
+        _mm256_storeu_si256((__m256i *)(m + i*8), v);
+    }
+    ntruenc_msg_expand_c(data + i, len - i, m + i*8);
+}
+
+/**
+ * Compact the elements of an NTRU vector into the bits of the data using
+ * AVX2.
+ * Thirty-two elements are compacted into four bytes each iteration.
+ * Elements are saturated to bytes and the top bits gathered with movemask.
+ *
+ * @param [in] m     The NTRU vector: len * 8 elements.
+ * @param [in] len   The length of the data in bytes.
+ * @param [in] data  The buffer to hold the data.
+ * @return  Non-zero when an element is 0.<br>
+ *          0 otherwise.
+ */
+__attribute__((target("avx2")))
+static int ntruenc_msg_compact_avx2(short *m, int len, unsigned char *data)
+{
+    int i;
+    uint32_t b;
+    __m256i a, c, z;
+    const __m256i zero = _mm256_setzero_si256();
+
+    z = zero;
+    for (i=0; i+4<=len; i+=4)
+    {
+        a = _mm256_loadu_si256((__m256i *)(m + i*8));
+        c = _mm256_loadu_si256((__m256i *)(m + i*8 + 16));
+        z = _mm256_or_si256(z, _mm256_cmpeq_epi16(a, zero));
+        z = _mm256_or_si256(z, _mm256_cmpeq_epi16(c, zero));
+        a = _mm256_permute4x64_epi64(_mm256_packs_epi16(a, c), 0xd8);
+        b = ~(uint32_t)_mm256_movemask_epi8(a);
+        memcpy(data + i, &b, sizeof(b));
+    }
+
+    return (!_mm256_testz_si256(z, z)) |
+        ntruenc_msg_compact_c(m + i*8, len - i, data + i);
+}
+
+/**
+ * OR together all the elements of an NTRU vector using AVX2.
+ *
+ * @param [in] m  The NTRU vector.
+ * @param [in] n  The number of elements in the vector.
+ * @return  Non-zero when an element is not 0.<br>
+ *          0 otherwise.
+ */
+__attribute__((target("avx2")))
+static int ntruenc_msg_or_avx2(short *m, int n)
+{
+    int i;
+    __m256i r = _mm256_setzero_si256();
+
+    for (i=0; i+16<=n; i+=16)
+        r = _mm256_or_si256(r, _mm256_loadu_si256((__m256i *)(m + i)));
+
+    return (!_mm256_testz_si256(r, r)) | ntruenc_msg_or_c(m + i, n - i);
+}
+
+/** Check whether the AVX2 instructions are supported and to be used. */
+#define NTRU_HAVE_AVX2()						\
+    (((ntruenc_simd_off & NTRU_SIMD_AVX2) == 0) &&			\
+     __builtin_cpu_supports("avx2"))
+#endif
+
+/**
+ * Expand each bit of the data into an element of an NTRU vector.
+ * 0 -> -1
+ * 1 -> +1
+ *
+ * @param [in] data  The data to expand.
+ * @param [in] len   The length of the data in bytes.
+ * @param [in] m     The NTRU vector: len * 8 elements.
+ */
+void ntruenc_msg_expand(unsigned char *data, int len, short *m)
+{
+#ifdef NTRU_HAVE_AVX2
+    if (NTRU_HAVE_AVX2())
+    {
+        ntruenc_msg_expand_avx2(data, len, m);
+        return;
+    }
+#endif
+    ntruenc_msg_expand_c(data, len, m);
+}
+
+/**
+ * Compact the elements of an NTRU vector into the bits of the data.
+ * -1 -> 0
+ * +1 -> 1
+ * Constant time - the check of every element is always performed.
+ *
+ * @param [in] m     The NTRU vector: len * 8 elements.
+ * @param [in] len   The length of the data in bytes.
+ * @param [in] data  The buffer to hold the data.
+ * @return  Non-zero when an element is 0.<br>
+ *          0 otherwise.
+ */
+int ntruenc_msg_compact(short *m, int len, unsigned char *data)
+{
+#ifdef NTRU_HAVE_AVX2
+    if (NTRU_HAVE_AVX2())
+        return ntruenc_msg_compact_avx2(m, len, data);
+#endif
+    return ntruenc_msg_compact_c(m, len, data);
+}
+
+/**
+ * OR together all the elements of an NTRU vector.
+ * Used to check the padding of a message is all zero in constant time.
+ *
+ * @param [in] m  The NTRU vector.
+ * @param [in] n  The number of elements in the vector.
+ * @return  Non-zero when an element is not 0.<br>
+ *          0 otherwise.
+ */
+int ntruenc_msg_or(short *m, int n)
+{
+#ifdef NTRU_HAVE_AVX2
+    if (NTRU_HAVE_AVX2())
+        return ntruenc_msg_or_avx2(m, n);
+#endif
+    return ntruenc_msg_or_c(m, n);
+}
+
+/**
+ * Retrieves the number of elements that data expands to as trits.
+ * Every 3 bits become 2 elements with the last bits padded with zeros.
+ *
+ * @param [in] len  The length of the data in bytes.
+ * @return  The number of elements.
+ */
+int ntruenc_msg_trits_len(int len)
+{
+    return ((len * 8 + 2) / 3) * 2;
+}
+
+/**
+ * Expand every 3 bits of the data into 2 trit elements of an NTRU vector.
+ * The 3 bits, v, are split into base 3 digits: v = d0 + 3 * d1.
+ * Digits are mapped to elements: 0 -> 0, 1 -> +1, 2 -> -1.
+ * Constant time - no branches or lookups on the data.
+ *
+ * @param [in] data  The data to expand.
+ * @param [in] len   The length of the data in bytes.
+ * @param [in] m     The NTRU vector: ntruenc_msg_trits_len(len) elements.
+ */
+void ntruenc_msg_expand_trits(unsigned char *data, int len, short *m)
+{
+    int i, j, c;
+    uint32_t w;
+    short v, d0, d1;
+
+    for (i=0; i<len; i+=3)
+    {
+        /* 24 bits are 8 groups of 3 bits. */
+        w = data[i];
+        if (i + 1 < len) w |= (uint32_t)data[i+1] << 8;
+        if (i + 2 < len) w |= (uint32_t)data[i+2] << 16;
+        c = ntruenc_msg_trits_len(len - i) / 2;
+        if (c > 8) c = 8;
+
+        for (j=0; j<c; j++)
+        {
+            v = (w >> (3 * j)) & 7;
+            d1 = (v * 11) >> 5;
+            d0 = v - 3 * d1;
+            m[0] = d0 - 3 * (d0 >> 1);
+            m[1] = d1 - 3 * (d1 >> 1);
+            m += 2;
+        }
+    }
+}
+
+/**
+ * Compact every 2 trit elements of an NTRU vector into 3 bits of the data.
+ * The reverse of ntruenc_msg_expand_trits().
+ * The pair -1, -1 is 8 and is not a valid encoding. The padding bits after
+ * the data must be zero.
+ * Constant time - the check of every element is always performed.
+ *
+ * @param [in] m     The NTRU vector: ntruenc_msg_trits_len(len) elements.
+ * @param [in] len   The length of the data in bytes.
+ * @param [in] data  The buffer to hold the data.
+ * @return  Non-zero when the elements are not a valid encoding.<br>
+ *          0 otherwise.
+ */
+int ntruenc_msg_compact_trits(short *m, int len, unsigned char *data)
+{
+    int i, j, c, b;
+    int r = 0;
+    uint32_t w;
+    short v, d0, d1;
+
+    for (i=0; i<len; i+=3)
+    {
+        c = ntruenc_msg_trits_len(len - i) / 2;
+        if (c > 8) c = 8;
+
+        w = 0;
+        for (j=0; j<c; j++)
+        {
+            /* -1 -> 2 */
+            d0 = m[0] + ((m[0] >> 15) & 3);
+            d1 = m[1] + ((m[1] >> 15) & 3);
+            v = d0 + 3 * d1;
+            r |= v >> 3;
+            w |= (uint32_t)(v & 7) << (3 * j);
+            m += 2;
+        }
+
+        b = (len - i < 3) ? len - i : 3;
+        data[i] = w;
+        if (b > 1) data[i+1] = w >> 8;
+        if (b > 2) data[i+2] = w >> 16;
+        r |= w >> (b * 8);
+    }
+
+    return r;
+}
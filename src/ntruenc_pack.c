@@ -0,0 +1,667 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "ntruenc_lcl.h"
+
+/**
+ * Encodes an NTRU vector as packed 12-bit data.
+ *
+ * @param [in] a     The NTRU vector.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] data  The buffer to hold encoded data.
+ */
+static void ntruenc_pack_12bits_c(short *a, int n, unsigned char *data)
+{
+    int i, j;
+
+    for (i=0,j=0; i<(n/2)*2; i+=2,j+=3)
+    {
+        data[j+0] =                           ((a[i+0] & 0x0ff) << 0);
+        data[j+1] = ((a[i+0] & 0xf00) >> 8) | ((a[i+1] & 0x00f) << 4);
+        data[j+2] = ((a[i+1] & 0xff0) >> 4);
+    }
+    if ((n & 1) == 1)
+    {
+        data[j+0] =                           ((a[i+0] & 0x0ff) << 0);
+        data[j+1] = ((a[i+0] & 0xf00) >> 8);
+    }
+}
+
+/**
+ * Decodes packed 12-bit data into an NTRU vector.
+ *
+ * @param [in] data  The buffer holding the encoded data.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] a     The NTRU vector.
+ */
+static void ntruenc_unpack_12bits_c(unsigned char *data, int n, short *a)
+{
+    int i, j;
+
+    for (i=0,j=0; i<(n/2)*2; i+=2,j+=3)
+    {
+        a[i+0] = ((data[j+0]       ) >> 0) | ((short)(data[j+1] & 0x0f) << 8);
+        a[i+1] = ((data[j+1] & 0xf0) >> 4) | ((short)(data[j+2]       ) << 4);
+    }
+    if ((n & 1) == 1)
+        a[i+0] = ((data[j+0]       ) >> 0) | ((short)(data[j+1] & 0x0f) << 8);
+}
+
+/**
+ * Encodes an NTRU vector as packed 11-bit data.
+ * Elements are mod q = 2048 and so only the bottom 11 bits are kept.
+ *
+ * @param [in] a     The NTRU vector.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] data  The buffer to hold encoded data.
+ */
+static void ntruenc_pack_11bits_c(short *a, int n, unsigned char *data)
+{
+    int i, j;
+    int bits = 0;
+    uint32_t v = 0;
+
+    for (i=0,j=0; i<n; i++)
+    {
+        v |= (uint32_t)(a[i] & 0x7ff) << bits;
+        for (bits+=11; bits>=8; bits-=8,v>>=8)
+            data[j++] = v;
+    }
+    if (bits > 0)
+        data[j] = v;
+}
+
+/**
+ * Decodes packed 11-bit data into an NTRU vector.
+ * Elements are sign extended to the range: -1024..1023.
+ *
+ * @param [in] data  The buffer holding the encoded data.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] a     The NTRU vector.
+ * @return  NTRU_ERR_BAD_DATA when the padding bits are not zero.<br>
+ *          0 otherwise.
+ */
+static int ntruenc_unpack_11bits_c(unsigned char *data, int n, short *a)
+{
+    int i, j;
+    int bits = 0;
+    uint32_t v = 0;
+
+    for (i=0,j=0; i<n; i++)
+    {
+        for (; bits<11; bits+=8)
+            v |= (uint32_t)data[j++] << bits;
+        a[i] = v & 0x7ff;
+        a[i] |= 0 - (a[i] & 0x400);
+        v >>= 11;
+        bits -= 11;
+    }
+
+    return (v != 0) ? NTRU_ERR_BAD_DATA : 0;
+}
+
+#if defined(CPU_X86_64) && (defined(CC_GCC) || defined(CC_CLANG))
+#include <immintrin.h>
+
+/**
+ * Encodes an NTRU vector as packed 12-bit data using SSSE3.
+ * Eight elements are packed into 12 bytes each iteration.
+ * Pairs of elements are combined into 24-bit values with a multiply-add and
+ * the three low bytes of each 32-bit lane are gathered with a shuffle.
+ *
+ * @param [in] a     The NTRU vector.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] data  The buffer to hold encoded data.
+ */
+__attribute__((target("ssse3")))
+static void ntruenc_pack_12bits_ssse3(short *a, int n, unsigned char *data)
+{
+    int i, j;
+    uint32_t w;
+    __m128i v;
+    const __m128i mask = _mm_set1_epi16(0xfff);
+    const __m128i mul = _mm_set1_epi32(0x10000001);
+    const __m128i shuf = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14,
+        -1, -1, -1, -1);
+
+    for (i=0,j=0; i+8<=n; i+=8,j+=12)
+    {
+        v = _mm_loadu_si128((__m128i *)(a + i));
+        v = _mm_and_si128(v, mask);
+        v = _mm_madd_epi16(v, mul);
+        v = _mm_shuffle_epi8(v, shuf);
+        _mm_storel_epi64((__m128i *)(data + j), v);
+        w = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+        memcpy(data + j + 8, &w, sizeof(w));
+    }
+    ntruenc_pack_12bits_c(a + i, n - i, data + j);
+}
+
+/**
+ * Decodes packed 12-bit data into an NTRU vector using SSSE3.
+ * Eight elements are unpacked from 12 bytes each iteration.
+ * The two bytes holding each element are shuffled into a 16-bit lane and
+ * odd elements are shifted down by 4.
+ *
+ * @param [in] data  The buffer holding the encoded data.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] a     The NTRU vector.
+ */
+__attribute__((target("ssse3")))
+static void ntruenc_unpack_12bits_ssse3(unsigned char *data, int n, short *a)
+{
+    int i, j;
+    uint32_t w;
+    __m128i v;
+    const __m128i even = _mm_set1_epi32(0x00000fff);
+    const __m128i odd = _mm_set1_epi32(0x0fff0000);
+    const __m128i shuf = _mm_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8,
+        9, 10, 10, 11);
+
+    for (i=0,j=0; i+8<=n; i+=8,j+=12)
+    {
+        memcpy(&w, data + j + 8, sizeof(w));
+        v = _mm_unpacklo_epi64(_mm_loadl_epi64((__m128i *)(data + j)),
+            _mm_cvtsi32_si128(w));
+        v = _mm_shuffle_epi8(v, shuf);
+        v = _mm_or_si128(_mm_and_si128(v, even),
+            _mm_and_si128(_mm_srli_epi16(v, 4), odd));
+        _mm_storeu_si128((__m128i *)(a + i), v);
+    }
+    ntruenc_unpack_12bits_c(data + j, n - i, a + i);
+}
+
+/**
+ * Encodes an NTRU vector as packed 12-bit data using AVX2.
+ * Sixteen elements are packed into 24 bytes each iteration.
+ * The 12 bytes from each 128-bit lane are made contiguous with a permute.
+ *
+ * @param [in] a     The NTRU vector.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] data  The buffer to hold encoded data.
+ */
+__attribute__((target("avx2")))
+static void ntruenc_pack_12bits_avx2(short *a, int n, unsigned char *data)
+{
+    int i, j;
+    __m256i v;
+    const __m256i mask = _mm256_set1_epi16(0xfff);
+    const __m256i mul = _mm256_set1_epi32(0x10000001);
+    const __m256i shuf = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i perm = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+
+    for (i=0,j=0; i+16<=n; i+=16,j+=24)
+    {
+        v = _mm256_loadu_si256((__m256i *)(a + i));
+        v = _mm256_and_si256(v, mask);
+        v = _mm256_madd_epi16(v, mul);
+        v = _mm256_shuffle_epi8(v, shuf);
+        v = _mm256_permutevar8x32_epi32(v, perm);
+        _mm_storeu_si128((__m128i *)(data + j), _mm256_castsi256_si128(v));
+        _mm_storel_epi64((__m128i *)(data + j + 16),
+            _mm256_extracti128_si256(v, 1));
+    }
+    ntruenc_pack_12bits_c(a + i, n - i, data + j);
+}
+
+/**
+ * Decodes packed 12-bit data into an NTRU vector using AVX2.
+ * Sixteen elements are unpacked from 24 bytes each iteration.
+ * The upper lane is loaded from 8 bytes in so that no more than 24 bytes
+ * are read.
+ *
+ * @param [in] data  The buffer holding the encoded data.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] a     The NTRU vector.
+ */
+__attribute__((target("avx2")))
+static void ntruenc_unpack_12bits_avx2(unsigned char *data, int n, short *a)
+{
+    int i, j;
+    __m256i v;
+    const __m256i mask = _mm256_set1_epi16(0xfff);
+    const __m256i shuf = _mm256_setr_epi8(
+        0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11,
+        4, 5, 5, 6, 7, 8, 8, 9, 10, 11, 11, 12, 13, 14, 14, 15);
+
+    for (i=0,j=0; i+16<=n; i+=16,j+=24)
+    {
+        v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((__m128i *)(data + j))),
+            _mm_loadu_si128((__m128i *)(data + j + 8)), 1);
+        v = _mm256_shuffle_epi8(v, shuf);
+        v = _mm256_blend_epi16(v, _mm256_srli_epi16(v, 4), 0xaa);
+        v = _mm256_and_si256(v, mask);
+        _mm256_storeu_si256((__m256i *)(a + i), v);
+    }
+    ntruenc_unpack_12bits_c(data + j, n - i, a + i);
+}
+
+/**
+ * Encodes an NTRU vector as packed 11-bit data using AVX2.
+ * Sixteen elements are packed into 22 bytes each iteration.
+ * Elements are combined into 22-bit, 44-bit and then 88-bit values.
+ * Each 128-bit lane is stored whole - the 5 extra bytes are overwritten by
+ * the next store. At least 4 elements are left for the last iteration to
+ * overwrite so that no byte past the packed data is written.
+ *
+ * @param [in] a     The NTRU vector.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] data  The buffer to hold encoded data.
+ */
+__attribute__((target("avx2")))
+static void ntruenc_pack_11bits_avx2(short *a, int n, unsigned char *data)
+{
+    int i, j;
+    __m256i v, h;
+    const __m256i mask = _mm256_set1_epi16(0x7ff);
+    const __m256i mul = _mm256_set1_epi32(0x08000001);
+    const __m256i lo32 = _mm256_set1_epi64x(0xffffffff);
+    const __m256i lo64 = _mm256_setr_epi64x(-1, 0, -1, 0);
+
+    for (i=0,j=0; i+20<=n; i+=16,j+=22)
+    {
+        v = _mm256_loadu_si256((__m256i *)(a + i));
+        v = _mm256_and_si256(v, mask);
+        v = _mm256_madd_epi16(v, mul);
+        h = _mm256_srli_epi64(v, 32);
+        v = _mm256_and_si256(v, lo32);
+        v = _mm256_or_si256(v, _mm256_slli_epi64(h, 22));
+        h = _mm256_srli_si256(v, 8);
+        v = _mm256_and_si256(v, lo64);
+        v = _mm256_or_si256(v, _mm256_slli_epi64(h, 44));
+        v = _mm256_or_si256(v, _mm256_slli_si256(_mm256_srli_epi64(h, 20),
+            8));
+        _mm_storeu_si128((__m128i *)(data + j), _mm256_castsi256_si128(v));
+        _mm_storeu_si128((__m128i *)(data + j + 11),
+            _mm256_extracti128_si256(v, 1));
+    }
+    ntruenc_pack_11bits_c(a + i, n - i, data + j);
+}
+
+/**
+ * Decodes packed 11-bit data into an NTRU vector using AVX2.
+ * Sixteen elements are unpacked from 22 bytes each iteration.
+ * The four bytes holding each element are shuffled into a 32-bit lane,
+ * shifted by the element's bit offset and packed back to 16 bits.
+ * Each half reads 16 bytes so at least 4 elements are left for the last
+ * iteration to keep reads within the packed data.
+ *
+ * @param [in] data  The buffer holding the encoded data.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] a     The NTRU vector.
+ * @return  NTRU_ERR_BAD_DATA when the padding bits are not zero.<br>
+ *          0 otherwise.
+ */
+__attribute__((target("avx2")))
+static int ntruenc_unpack_11bits_avx2(unsigned char *data, int n, short *a)
+{
+    int i, j;
+    __m256i x, y;
+    const __m256i mask = _mm256_set1_epi32(0x7ff);
+    const __m256i shuf = _mm256_setr_epi8(
+        0, 1, 2, 3, 1, 2, 3, 4, 2, 3, 4, 5, 4, 5, 6, 7,
+        5, 6, 7, 8, 6, 7, 8, 9, 8, 9, 10, 11, 9, 10, 11, 12);
+    const __m256i shift = _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5);
+
+    for (i=0,j=0; i+20<=n; i+=16,j+=22)
+    {
+        x = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((__m128i *)(data + j)));
+        y = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((__m128i *)(data + j + 11)));
+        x = _mm256_srlv_epi32(_mm256_shuffle_epi8(x, shuf), shift);
+        y = _mm256_srlv_epi32(_mm256_shuffle_epi8(y, shuf), shift);
+        x = _mm256_and_si256(x, mask);
+        y = _mm256_and_si256(y, mask);
+        x = _mm256_packus_epi32(x, y);
+        x = _mm256_permute4x64_epi64(x, 0xd8);
+        x = _mm256_srai_epi16(_mm256_slli_epi16(x, 5), 5);
+        _mm256_storeu_si256((__m256i *)(a + i), x);
+    }
+    return ntruenc_unpack_11bits_c(data + j, n - i, a + i);
+}
+
+/** Check whether the SSSE3 instructions are supported and to be used. */
+#define NTRU_HAVE_SSSE3()						\
+    (((ntruenc_simd_off & NTRU_SIMD_SSSE3) == 0) &&			\
+     __builtin_cpu_supports("ssse3"))
+/** Check whether the AVX2 instructions are supported and to be used. */
+#define NTRU_HAVE_AVX2()						\
+    (((ntruenc_simd_off & NTRU_SIMD_AVX2) == 0) &&			\
+     __builtin_cpu_supports("avx2"))
+#endif
+
+/**
+ * Encodes an NTRU vector as packed 12-bit data.
+ * Uses the widest SIMD instructions the CPU supports.
+ *
+ * @param [in] a     The NTRU vector.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] data  The buffer to hold encoded data.
+ */
+static void ntruenc_pack_12bits(short *a, int n, unsigned char *data)
+{
+#ifdef NTRU_HAVE_AVX2
+    if (NTRU_HAVE_AVX2())
+    {
+        ntruenc_pack_12bits_avx2(a, n, data);
+        return;
+    }
+#endif
+#ifdef NTRU_HAVE_SSSE3
+    if (NTRU_HAVE_SSSE3())
+    {
+        ntruenc_pack_12bits_ssse3(a, n, data);
+        return;
+    }
+#endif
+    ntruenc_pack_12bits_c(a, n, data);
+}
+
+/**
+ * Decodes packed 12-bit data into an NTRU vector.
+ * Uses the widest SIMD instructions the CPU supports.
+ *
+ * @param [in] data  The buffer holding the encoded data.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] a     The NTRU vector.
+ */
+static void ntruenc_unpack_12bits(unsigned char *data, int n, short *a)
+{
+#ifdef NTRU_HAVE_AVX2
+    if (NTRU_HAVE_AVX2())
+    {
+        ntruenc_unpack_12bits_avx2(data, n, a);
+        return;
+    }
+#endif
+#ifdef NTRU_HAVE_SSSE3
+    if (NTRU_HAVE_SSSE3())
+    {
+        ntruenc_unpack_12bits_ssse3(data, n, a);
+        return;
+    }
+#endif
+    ntruenc_unpack_12bits_c(data, n, a);
+}
+
+/**
+ * Encodes an NTRU vector as packed 11-bit data.
+ * Uses AVX2 when the CPU supports it.
+ *
+ * @param [in] a     The NTRU vector.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] data  The buffer to hold encoded data.
+ */
+static void ntruenc_pack_11bits(short *a, int n, unsigned char *data)
+{
+#ifdef NTRU_HAVE_AVX2
+    if (NTRU_HAVE_AVX2())
+    {
+        ntruenc_pack_11bits_avx2(a, n, data);
+        return;
+    }
+#endif
+    ntruenc_pack_11bits_c(a, n, data);
+}
+
+/**
+ * Decodes packed 11-bit data into an NTRU vector.
+ * Uses AVX2 when the CPU supports it.
+ *
+ * @param [in] data  The buffer holding the encoded data.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] a     The NTRU vector.
+ * @return  NTRU_ERR_BAD_DATA when the padding bits are not zero.<br>
+ *          0 otherwise.
+ */
+static int ntruenc_unpack_11bits(unsigned char *data, int n, short *a)
+{
+#ifdef NTRU_HAVE_AVX2
+    if (NTRU_HAVE_AVX2())
+        return ntruenc_unpack_11bits_avx2(data, n, a);
+#endif
+    return ntruenc_unpack_11bits_c(data, n, a);
+}
+
+/**
+ * Retrieves the length of an NTRU vector packed in the format.
+ *
+ * @param [in] n       The number of elements in the NTRU vector.
+ * @param [in] format  The packing format: NTRU_FORMAT_12BITS or
+ *                     NTRU_FORMAT_11BITS.
+ * @return  The length in bytes.<br>
+ *          0 when the format is not supported.
+ */
+int ntruenc_pack_len(int n, int format)
+{
+    switch (format)
+    {
+    case NTRU_FORMAT_12BITS:
+        return (n*12+7)/8;
+    case NTRU_FORMAT_11BITS:
+        return 1 + (n*11+7)/8;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Pack an NTRU vector into a buffer in the format.
+ * The 12-bit format has no header for compatibility.
+ * Other formats start with a byte holding the format.
+ *
+ * @param [in] a       The NTRU vector.
+ * @param [in] n       The number of elements in the NTRU vector.
+ * @param [in] format  The packing format.
+ * @param [in] data    The buffer to hold packed data.
+ * @param [in] len     The length of the buffer in bytes.
+ * @return  NTRU_ERR_BAD_DATA when the format is not supported.<br>
+ *          NTRU_ERR_BAD_LEN when the buffer is too small.<br>
+ *          0 otherwise.
+ */
+int ntruenc_pack(short *a, int n, int format, unsigned char *data, int len)
+{
+    int ret = 0;
+    int plen = ntruenc_pack_len(n, format);
+
+    if (plen == 0)
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+    if (len < plen)
+    {
+        ret = NTRU_ERR_BAD_LEN;
+        goto end;
+    }
+
+    if (format == NTRU_FORMAT_12BITS)
+        ntruenc_pack_12bits(a, n, data);
+    else
+    {
+        data[0] = format;
+        ntruenc_pack_11bits(a, n, data+1);
+    }
+end:
+    return ret;
+}
+
+/**
+ * Unpack a buffer into an NTRU vector.
+ * The format byte is checked first: 11-bit data must be exactly the 11-bit
+ * length. The 12-bit format has no header so a buffer of exactly the 12-bit
+ * length starting with the 11-bit format byte is 12-bit. Any other buffer
+ * starting with the 11-bit format byte is rejected rather than decoded as
+ * 12-bit.
+ *
+ * @param [in] data  The buffer holding packed data.
+ * @param [in] len   The length of the buffer in bytes.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] a     The NTRU vector.
+ * @return  NTRU_ERR_BAD_LEN when the buffer is the wrong length for the
+ *          format.<br>
+ *          NTRU_ERR_BAD_DATA when the packed data is invalid.<br>
+ *          0 otherwise.
+ */
+int ntruenc_unpack(unsigned char *data, int len, int n, short *a)
+{
+    int ret = 0;
+    int len11 = ntruenc_pack_len(n, NTRU_FORMAT_11BITS);
+    int len12 = ntruenc_pack_len(n, NTRU_FORMAT_12BITS);
+
+    if (len < len11)
+        ret = NTRU_ERR_BAD_LEN;
+    else if ((data[0] == NTRU_FORMAT_11BITS) && (len != len12))
+    {
+        if (len == len11)
+            ret = ntruenc_unpack_11bits(data+1, n, a);
+        else
+            ret = NTRU_ERR_BAD_LEN;
+    }
+    else if (len >= len12)
+        ntruenc_unpack_12bits(data, n, a);
+    else if (len == len11)
+        ret = NTRU_ERR_BAD_DATA;
+    else
+        ret = NTRU_ERR_BAD_LEN;
+
+    return ret;
+}
+
+/**
+ * Retrieves the length of a private key vector packed as trits.
+ *
+ * @param [in] n  The number of elements in the NTRU vector.
+ * @return  The length in bytes including the format byte.
+ */
+int ntruenc_pack_trits_len(int n)
+{
+    return 1 + (n + 4) / 5;
+}
+
+/**
+ * Pack a private key vector, f = 1 + 3F, as the trits of F.
+ * Each element of F is a digit: 0 -> 0, 1 -> 1, -1 -> 2.
+ * Five digits are packed into a byte in base 3 - 1.6 bits per element.
+ * Constant time - no branches depend on the values of the vector.
+ *
+ * @param [in] f     The private key NTRU vector.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] data  The buffer to hold packed data.
+ * @param [in] len   The length of the buffer in bytes.
+ * @return  NTRU_ERR_BAD_LEN when the buffer is too small.<br>
+ *          NTRU_ERR_BAD_DATA when the vector is not of the form 1 + 3F.<br>
+ *          0 otherwise.
+ */
+int ntruenc_pack_trits(short *f, int n, unsigned char *data, int len)
+{
+    int ret = 0;
+    int i, j, k;
+    int r = 0;
+    unsigned int c, d, b, m;
+
+    if (len < ntruenc_pack_trits_len(n))
+    {
+        ret = NTRU_ERR_BAD_LEN;
+        goto end;
+    }
+
+    data[0] = NTRU_FORMAT_TERNARY;
+    for (i=0,j=1; i<n; j++)
+    {
+        b = 0;
+        for (k=0,m=1; k<5; k++,i++,m*=3)
+        {
+            if (i == n)
+                break;
+            c = (f[i] - (i == 0)) & 0x7ff;
+            d = (c == 3) | ((c == 0x7fd) << 1);
+            r |= (c != 0) & (d == 0);
+            b += d * m;
+        }
+        data[j] = b;
+    }
+
+    if (r)
+        ret = NTRU_ERR_BAD_DATA;
+end:
+    return ret;
+}
+
+/**
+ * Unpack the trits of F into a private key vector, f = 1 + 3F.
+ * The vector is ready for decryption.
+ *
+ * @param [in] data  The buffer holding packed data.
+ * @param [in] len   The length of the buffer in bytes.
+ * @param [in] n     The number of elements in the NTRU vector.
+ * @param [in] f     The private key NTRU vector.
+ * @return  NTRU_ERR_BAD_LEN when the buffer is the wrong size.<br>
+ *          NTRU_ERR_BAD_DATA when the packed data is invalid.<br>
+ *          0 otherwise.
+ */
+int ntruenc_unpack_trits(unsigned char *data, int len, int n, short *f)
+{
+    int ret = 0;
+    int i, j, k;
+    int r = 0;
+    unsigned int b, d;
+
+    if (len != ntruenc_pack_trits_len(n))
+    {
+        ret = NTRU_ERR_BAD_LEN;
+        goto end;
+    }
+    if (data[0] != NTRU_FORMAT_TERNARY)
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+
+    for (i=0,j=1; j<len; j++)
+    {
+        b = data[j];
+        r |= b > 242;
+        for (k=0; k<5; k++,i++)
+        {
+            d = b % 3;
+            b /= 3;
+            if (i < n)
+                f[i] = 3 * ((int)d - 3 * (int)(d >> 1));
+            else
+                r |= d;
+        }
+    }
+    f[0] += 1;
+
+    if (r)
+        ret = NTRU_ERR_BAD_DATA;
+end:
+    return ret;
+}
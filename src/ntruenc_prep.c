@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ntruenc_lcl.h"
+#include "ntruenc_key_lcl.h"
+
+/**
+ * Allocate an empty prepared key with one reference.
+ *
+ * @param [out] prep  The new prepared key.
+ * @return  NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          0 otherwise.
+ */
+static int ntruenc_prep_key_alloc(NTRUENC_PREP_KEY **prep)
+{
+    NTRUENC_PREP_KEY *p;
+
+    p = malloc(sizeof(*p));
+    if (p == NULL)
+        return NTRU_ERR_ALLOC;
+    memset(p, 0, sizeof(*p));
+    p->ref = 1;
+
+    *prep = p;
+    return 0;
+}
+
+/**
+ * Creates a prepared key from a private key.
+ * The private value is copied so the private key can be disposed of. The
+ * prepared key is immutable and can be used by any number of operation
+ * objects, in any thread, at the same time.
+ *
+ * @param [in]  key   The private key.
+ * @param [out] prep  The new prepared key with one reference.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_BAD_DATA when the private key has no value.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_PREP_KEY_new_priv(NTRUENC_PRIV_KEY *key, NTRUENC_PREP_KEY **prep)
+{
+    int ret;
+    int n;
+    NTRUENC_PREP_KEY *p = NULL;
+
+    if ((key == NULL) || (prep == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (key->f == NULL)
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+    n = key->params->n;
+
+    ret = ntruenc_prep_key_alloc(&p);
+    if (ret != 0)
+        goto end;
+
+    p->priv.params = key->params;
+    p->priv.f = ntruenc_vec_alloc(n, 1);
+    if (p->priv.f == NULL)
+    {
+        ret = NTRU_ERR_ALLOC;
+        goto end;
+    }
+    memcpy(p->priv.f, key->f, n * sizeof(*key->f));
+
+    *prep = p;
+    p = NULL;
+end:
+    NTRUENC_PREP_KEY_free(p);
+    return ret;
+}
+
+/**
+ * Creates a prepared key from a public key.
+ * The public value is copied, or unpacked when the key references packed
+ * data, so the public key can be disposed of. The prepared key is immutable
+ * and can be used by any number of operation objects, in any thread, at the
+ * same time.
+ *
+ * @param [in]  key   The public key.
+ * @param [out] prep  The new prepared key with one reference.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_BAD_DATA when the public key has no value.<br>
+ *          NTRU_ERR_BAD_LEN when the packed data is too small.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_PREP_KEY_new_pub(NTRUENC_PUB_KEY *key, NTRUENC_PREP_KEY **prep)
+{
+    int ret;
+    int n;
+    NTRUENC_PREP_KEY *p = NULL;
+
+    if ((key == NULL) || (prep == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+    if ((key->h == NULL) && (key->packed == NULL))
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+    n = key->params->n;
+
+    ret = ntruenc_prep_key_alloc(&p);
+    if (ret != 0)
+        goto end;
+
+    p->pub.params = key->params;
+    p->pub.h = ntruenc_vec_alloc(n, 1);
+    if (p->pub.h == NULL)
+    {
+        ret = NTRU_ERR_ALLOC;
+        goto end;
+    }
+    if (key->h != NULL)
+        memcpy(p->pub.h, key->h, n * sizeof(*key->h));
+    else
+    {
+        ret = ntruenc_unpack(key->packed, key->packed_len, n, p->pub.h);
+        if (ret != 0)
+            goto end;
+    }
+
+    *prep = p;
+    p = NULL;
+end:
+    NTRUENC_PREP_KEY_free(p);
+    return ret;
+}
+
+/**
+ * Add a reference to the prepared key.
+ * Each reference is released with NTRUENC_PREP_KEY_free().
+ *
+ * @param [in] prep  The prepared key.
+ * @return  NTRU_ERR_PARAM_NULL when the prepared key is NULL.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_PREP_KEY_up_ref(NTRUENC_PREP_KEY *prep)
+{
+    if (prep == NULL)
+        return NTRU_ERR_PARAM_NULL;
+    NTRU_REF_INC(&prep->ref);
+    return 0;
+}
+
+/**
+ * Release a reference to the prepared key.
+ * The key is freed, and the private value zeroized, when the last reference
+ * is released.
+ *
+ * @param [in] prep  The prepared key.
+ */
+void NTRUENC_PREP_KEY_free(NTRUENC_PREP_KEY *prep)
+{
+    if ((prep != NULL) && (NTRU_REF_DEC(&prep->ref) == 0))
+    {
+        if (prep->priv.f != NULL)
+        {
+            memset(prep->priv.f, 0, NTRU_VEC_LEN(prep->priv.params->n) *
+                sizeof(*prep->priv.f));
+            free(prep->priv.f);
+        }
+        if (prep->pub.h != NULL)
+            free(prep->pub.h);
+        free(prep);
+    }
+}
@@ -20,6 +20,7 @@
  * SOFTWARE.
  */
 
+#include <stdint.h>
 #include "string.h"
 #include "random.h"
 
@@ -27,38 +28,52 @@
 #define NTRUENC_RANDOM_CONSTANT_TIME
 #endif
 
-int NTRUENC_RANDOM(short *a, int df1, int df2, short v)
+/**
+ * Generate a random NTRU vector with df1 elements of v and df2 elements of -v.
+ *
+ * @param [in] a     The NTRU vector.
+ * @param [in] df1   The number of elements with value v.
+ * @param [in] df2   The number of elements with value -v.
+ * @param [in] v     The non-zero value.
+ * @param [in] drbg  The random number generator to sample with.
+ * @return  NTRU_ERR_RANDOM if generating random fails.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_RANDOM(short *a, int df1, int df2, short v, NTRU_DRBG *drbg)
 {
 #ifdef NTRUENC_RANDOM_CONSTANT_TIME
     int ret = 0;
     int i;
-    unsigned short r[NTRU_N];
-    unsigned short j;
-    short t;
+    uint32_t r[NTRU_N];
+    int32_t x[NTRU_N];
+    int32_t c;
 
-    /* Generate a large number of indices. */
-    if (pseudo_random((unsigned char *)r, sizeof(r)) != 0)
+    /* Generate a random sort key for each element. */
+    if (ntru_drbg_generate(drbg, (unsigned char *)r, sizeof(r)) != 0)
     {
         ret = NTRU_ERR_RANDOM;
         goto end;
     }
-    /* Put in the require number values: v and -v */
+    /* Low 2 bits hold the value: 1 for v, 2 for -v and 0 otherwise. */
     for (i=0; i<df1; i++)
-        a[i] = v;
+        x[i] = (int32_t)((r[i] & ~3U) | 1);
     for (; i<df1+df2; i++)
-        a[i] = NTRU_Q - v;
-    /* Zero out the rest of the values. */
-    memset(&a[i], 0, 2*(NTRU_N-df1-df2));
+        x[i] = (int32_t)((r[i] & ~3U) | 2);
+    for (; i<NTRU_N; i++)
+        x[i] = (int32_t)(r[i] & ~3U);
+
+    /* Sorting on the random keys randomly mixes the values. */
+    ntruenc_sort_int32(x, NTRU_N);
 
-    /* Randomly mix the values. */
-    for (i=NTRU_N-1; i>0; i--)
+    /* Extract the values without branching on them. */
+    for (i=0; i<NTRU_N; i++)
     {
-        j = r[i] % (i+1);
-        t = a[i];
-        a[i] = a[j];
-        a[j] = t;
+        c = x[i] & 3;
+        a[i] = (short)((-(c & 1) & v) | (-(c >> 1) & (NTRU_Q - v)));
     }
 
+    memset(r, 0, sizeof(r));
+    memset(x, 0, sizeof(x));
 end:
     return ret;
 #else
@@ -69,7 +84,7 @@ end:
 
     memset(a, 0, sizeof(*a)*NTRU_N);
     /* Generate a large number of indices. */
-    if (pseudo_random((unsigned char *)r, sizeof(r)) != 0)
+    if (ntru_drbg_generate(drbg, (unsigned char *)r, sizeof(r)) != 0)
     {
         ret = NTRU_ERR_RANDOM;
         goto end;
@@ -82,7 +97,8 @@ end:
         if (i == NTRU_DF*3)
         {
             /* Re-mill the buffer. */
-            if (pseudo_random((unsigned char *)r, sizeof(r)) != 0)
+            if (ntru_drbg_generate(drbg, (unsigned char *)r, sizeof(r)) !=
+                0)
             {
                 ret = NTRU_ERR_RANDOM;
                 goto end;
@@ -106,7 +122,8 @@ end:
         if (i == NTRU_DF*3)
         {
             /* Fill the buffer up so that little is wasted. */
-            if (pseudo_random((unsigned char *)r, sizeof(*r)*(df2-j)*3) != 0)
+            if (ntru_drbg_generate(drbg, (unsigned char *)r,
+                sizeof(*r)*(df2-j)*3) != 0)
             {
                 ret = NTRU_ERR_RANDOM;
                 goto end;
@@ -29,6 +29,8 @@
 #define NTRU_Q_BITS		NTRU_S112_Q_BITS
 #define NTRUENC_KEYGEN		ntruenc_s112_keygen
 #define NTRUENC_ENCRYPT		ntruenc_s112_encrypt
+#define NTRUENC_BLIND		ntruenc_s112_blind
+#define NTRUENC_ENCRYPT_BLINDED	ntruenc_s112_encrypt_blinded
 #define NTRUENC_DECRYPT		ntruenc_s112_decrypt
 #define NTRUENC_MOD_INV_2	ntruenc_s112_mod_inv_2
 #define NTRUENC_MOD_INV_Q	ntruenc_s112_mod_inv_q
@@ -29,6 +29,8 @@
 #define NTRU_Q_BITS		NTRU_S128_Q_BITS
 #define NTRUENC_KEYGEN		ntruenc_s128_keygen
 #define NTRUENC_ENCRYPT		ntruenc_s128_encrypt
+#define NTRUENC_BLIND		ntruenc_s128_blind
+#define NTRUENC_ENCRYPT_BLINDED	ntruenc_s128_encrypt_blinded
 #define NTRUENC_DECRYPT		ntruenc_s128_decrypt
 #define NTRUENC_MOD_INV_2	ntruenc_s128_mod_inv_2
 #define NTRUENC_MOD_INV_Q	ntruenc_s128_mod_inv_q
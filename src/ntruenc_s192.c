@@ -29,6 +29,8 @@
 #define NTRU_Q_BITS		NTRU_S192_Q_BITS
 #define NTRUENC_KEYGEN		ntruenc_s192_keygen
 #define NTRUENC_ENCRYPT		ntruenc_s192_encrypt
+#define NTRUENC_BLIND		ntruenc_s192_blind
+#define NTRUENC_ENCRYPT_BLINDED	ntruenc_s192_encrypt_blinded
 #define NTRUENC_DECRYPT		ntruenc_s192_decrypt
 #define NTRUENC_MOD_INV_2	ntruenc_s192_mod_inv_2
 #define NTRUENC_MOD_INV_Q	ntruenc_s192_mod_inv_q
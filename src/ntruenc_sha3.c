@@ -207,17 +207,19 @@ while (0)
 #endif
 
 /**
- * The block operation performed on the state.
+ * The block operation performed on the state using loops.
+ * This is the reference the unrolled implementations are checked against.
  *
- * @param [in] s  The state.
+ * @param [in] s   The state.
+ * @param [in] nr  The number of rounds to perform.
  */
-static void ntru_keccak_block(uint64_t *s)
+static void ntru_keccak_block_ref(uint64_t *s, int nr)
 {
     uint8_t i, x, y;
     uint64_t t0, t1;
     uint64_t b[5];
 
-    for (i=0; i<24; i++)
+    for (i=24-nr; i<24; i++)
     {
         COL_MIX(s, b, x, t0);
 
@@ -253,9 +255,340 @@ static void ntru_keccak_block(uint64_t *s)
     }
 }
 
+#ifdef NTRUENC_SMALL_CODE
+/**
+ * The block operation performed on the state.
+ *
+ * @param [in] s   The state.
+ * @param [in] nr  The number of rounds to perform.
+ */
+static void ntru_keccak_block(uint64_t *s, int nr)
+{
+    ntru_keccak_block_ref(s, nr);
+}
+#else
+/**
+ * Complement the lanes of the state that are kept inverted through the
+ * unrolled block operation.
+ * With these lanes complemented, each row of the chi step needs only one NOT.
+ *
+ * @param [in] s  The state.
+ */
+#define KECCAK_COMPLEMENT(s)                                            \
+do                                                                      \
+{                                                                       \
+    s[ 1] = ~s[ 1]; s[ 2] = ~s[ 2]; s[ 8] = ~s[ 8];                     \
+    s[12] = ~s[12]; s[17] = ~s[17]; s[20] = ~s[20];                     \
+}                                                                       \
+while (0)
+
+/**
+ * One round of the block operation on lanes in local variables.
+ * The input lanes have lanes 1, 2, 8, 12, 17 and 20 complemented and so do
+ * the output lanes.
+ *
+ * @param [in] A   The prefix of the input lane variables.
+ * @param [in] E   The prefix of the output lane variables.
+ * @param [in] rc  The round constant.
+ */
+#define KECCAK_ROUND_LC(A, E, rc)                                       \
+do                                                                      \
+{                                                                       \
+    C0 = A##00 ^ A##05 ^ A##10 ^ A##15 ^ A##20;                         \
+    C1 = A##01 ^ A##06 ^ A##11 ^ A##16 ^ A##21;                         \
+    C2 = A##02 ^ A##07 ^ A##12 ^ A##17 ^ A##22;                         \
+    C3 = A##03 ^ A##08 ^ A##13 ^ A##18 ^ A##23;                         \
+    C4 = A##04 ^ A##09 ^ A##14 ^ A##19 ^ A##24;                         \
+    D0 = C4 ^ ROL(C1, 1);                                               \
+    D1 = C0 ^ ROL(C2, 1);                                               \
+    D2 = C1 ^ ROL(C3, 1);                                               \
+    D3 = C2 ^ ROL(C4, 1);                                               \
+    D4 = C3 ^ ROL(C0, 1);                                               \
+    B0 = A##00 ^ D0;                                                    \
+    B1 = ROL(A##06 ^ D1, 44);                                           \
+    B2 = ROL(A##12 ^ D2, 43);                                           \
+    B3 = ROL(A##18 ^ D3, 21);                                           \
+    B4 = ROL(A##24 ^ D4, 14);                                           \
+    E##00 = B0 ^ (B1 | B2);                                             \
+    E##01 = B1 ^ (~B2 | B3);                                            \
+    E##02 = B2 ^ (B3 & B4);                                             \
+    E##03 = B3 ^ (B4 | B0);                                             \
+    E##04 = B4 ^ (B0 & B1);                                             \
+    B0 = ROL(A##03 ^ D3, 28);                                           \
+    B1 = ROL(A##09 ^ D4, 20);                                           \
+    B2 = ROL(A##10 ^ D0, 3);                                            \
+    B3 = ROL(A##16 ^ D1, 45);                                           \
+    B4 = ROL(A##22 ^ D2, 61);                                           \
+    E##05 = B0 ^ (B1 | B2);                                             \
+    E##06 = B1 ^ (B2 & B3);                                             \
+    E##07 = B2 ^ (B3 | ~B4);                                            \
+    E##08 = B3 ^ (B4 | B0);                                             \
+    E##09 = B4 ^ (B0 & B1);                                             \
+    B0 = ROL(A##01 ^ D1, 1);                                            \
+    B1 = ROL(A##07 ^ D2, 6);                                            \
+    B2 = ROL(A##13 ^ D3, 25);                                           \
+    B3 = ROL(A##19 ^ D4, 8);                                            \
+    B4 = ROL(A##20 ^ D0, 18);                                           \
+    E##10 = B0 ^ (B1 | B2);                                             \
+    E##11 = B1 ^ (B2 & B3);                                             \
+    E##12 = B2 ^ (~B3 & B4);                                            \
+    E##13 = ~B3 ^ (B4 | B0);                                            \
+    E##14 = B4 ^ (B0 & B1);                                             \
+    B0 = ROL(A##04 ^ D4, 27);                                           \
+    B1 = ROL(A##05 ^ D0, 36);                                           \
+    B2 = ROL(A##11 ^ D1, 10);                                           \
+    B3 = ROL(A##17 ^ D2, 15);                                           \
+    B4 = ROL(A##23 ^ D3, 56);                                           \
+    E##15 = B0 ^ (B1 & B2);                                             \
+    E##16 = B1 ^ (B2 | B3);                                             \
+    E##17 = B2 ^ (~B3 | B4);                                            \
+    E##18 = ~B3 ^ (B4 & B0);                                            \
+    E##19 = B4 ^ (B0 | B1);                                             \
+    B0 = ROL(A##02 ^ D2, 62);                                           \
+    B1 = ROL(A##08 ^ D3, 55);                                           \
+    B2 = ROL(A##14 ^ D4, 39);                                           \
+    B3 = ROL(A##15 ^ D0, 41);                                           \
+    B4 = ROL(A##21 ^ D1, 2);                                            \
+    E##20 = B0 ^ (~B1 & B2);                                            \
+    E##21 = ~B1 ^ (B2 | B3);                                            \
+    E##22 = B2 ^ (B3 & B4);                                             \
+    E##23 = B3 ^ (B4 | B0);                                             \
+    E##24 = B4 ^ (B0 & B1);                                             \
+    E##00 ^= (rc);                                                      \
+}                                                                       \
+while (0)
+
+/**
+ * One round of the block operation on lanes in local variables.
+ * The chi step is written as a ^ (~b & c) which is one ANDN with BMI1.
+ *
+ * @param [in] A   The prefix of the input lane variables.
+ * @param [in] E   The prefix of the output lane variables.
+ * @param [in] rc  The round constant.
+ */
+#define KECCAK_ROUND(A, E, rc)                                          \
+do                                                                      \
+{                                                                       \
+    C0 = A##00 ^ A##05 ^ A##10 ^ A##15 ^ A##20;                         \
+    C1 = A##01 ^ A##06 ^ A##11 ^ A##16 ^ A##21;                         \
+    C2 = A##02 ^ A##07 ^ A##12 ^ A##17 ^ A##22;                         \
+    C3 = A##03 ^ A##08 ^ A##13 ^ A##18 ^ A##23;                         \
+    C4 = A##04 ^ A##09 ^ A##14 ^ A##19 ^ A##24;                         \
+    D0 = C4 ^ ROL(C1, 1);                                               \
+    D1 = C0 ^ ROL(C2, 1);                                               \
+    D2 = C1 ^ ROL(C3, 1);                                               \
+    D3 = C2 ^ ROL(C4, 1);                                               \
+    D4 = C3 ^ ROL(C0, 1);                                               \
+    B0 = A##00 ^ D0;                                                    \
+    B1 = ROL(A##06 ^ D1, 44);                                           \
+    B2 = ROL(A##12 ^ D2, 43);                                           \
+    B3 = ROL(A##18 ^ D3, 21);                                           \
+    B4 = ROL(A##24 ^ D4, 14);                                           \
+    E##00 = B0 ^ (~B1 & B2);                                            \
+    E##01 = B1 ^ (~B2 & B3);                                            \
+    E##02 = B2 ^ (~B3 & B4);                                            \
+    E##03 = B3 ^ (~B4 & B0);                                            \
+    E##04 = B4 ^ (~B0 & B1);                                            \
+    B0 = ROL(A##03 ^ D3, 28);                                           \
+    B1 = ROL(A##09 ^ D4, 20);                                           \
+    B2 = ROL(A##10 ^ D0, 3);                                            \
+    B3 = ROL(A##16 ^ D1, 45);                                           \
+    B4 = ROL(A##22 ^ D2, 61);                                           \
+    E##05 = B0 ^ (~B1 & B2);                                            \
+    E##06 = B1 ^ (~B2 & B3);                                            \
+    E##07 = B2 ^ (~B3 & B4);                                            \
+    E##08 = B3 ^ (~B4 & B0);                                            \
+    E##09 = B4 ^ (~B0 & B1);                                            \
+    B0 = ROL(A##01 ^ D1, 1);                                            \
+    B1 = ROL(A##07 ^ D2, 6);                                            \
+    B2 = ROL(A##13 ^ D3, 25);                                           \
+    B3 = ROL(A##19 ^ D4, 8);                                            \
+    B4 = ROL(A##20 ^ D0, 18);                                           \
+    E##10 = B0 ^ (~B1 & B2);                                            \
+    E##11 = B1 ^ (~B2 & B3);                                            \
+    E##12 = B2 ^ (~B3 & B4);                                            \
+    E##13 = B3 ^ (~B4 & B0);                                            \
+    E##14 = B4 ^ (~B0 & B1);                                            \
+    B0 = ROL(A##04 ^ D4, 27);                                           \
+    B1 = ROL(A##05 ^ D0, 36);                                           \
+    B2 = ROL(A##11 ^ D1, 10);                                           \
+    B3 = ROL(A##17 ^ D2, 15);                                           \
+    B4 = ROL(A##23 ^ D3, 56);                                           \
+    E##15 = B0 ^ (~B1 & B2);                                            \
+    E##16 = B1 ^ (~B2 & B3);                                            \
+    E##17 = B2 ^ (~B3 & B4);                                            \
+    E##18 = B3 ^ (~B4 & B0);                                            \
+    E##19 = B4 ^ (~B0 & B1);                                            \
+    B0 = ROL(A##02 ^ D2, 62);                                           \
+    B1 = ROL(A##08 ^ D3, 55);                                           \
+    B2 = ROL(A##14 ^ D4, 39);                                           \
+    B3 = ROL(A##15 ^ D0, 41);                                           \
+    B4 = ROL(A##21 ^ D1, 2);                                            \
+    E##20 = B0 ^ (~B1 & B2);                                            \
+    E##21 = B1 ^ (~B2 & B3);                                            \
+    E##22 = B2 ^ (~B3 & B4);                                            \
+    E##23 = B3 ^ (~B4 & B0);                                            \
+    E##24 = B4 ^ (~B0 & B1);                                            \
+    E##00 ^= (rc);                                                      \
+}                                                                       \
+while (0)
+
+/**
+ * Fully unrolled block operation.
+ * The state is held in local variables and two rounds are performed in
+ * each iteration so that the lanes alternate between the A and E variables.
+ *
+ * @param [in] s      The state.
+ * @param [in] nr     The number of rounds to perform - even.
+ * @param [in] ROUND  The round macro to use.
+ */
+#define KECCAK_BLOCK(s, nr, ROUND)                                      \
+do                                                                      \
+{                                                                       \
+    uint64_t A00, A01, A02, A03, A04, A05, A06;                         \
+    uint64_t A07, A08, A09, A10, A11, A12, A13;                         \
+    uint64_t A14, A15, A16, A17, A18, A19, A20;                         \
+    uint64_t A21, A22, A23, A24;                                        \
+    uint64_t E00, E01, E02, E03, E04, E05, E06;                         \
+    uint64_t E07, E08, E09, E10, E11, E12, E13;                         \
+    uint64_t E14, E15, E16, E17, E18, E19, E20;                         \
+    uint64_t E21, E22, E23, E24;                                        \
+    uint64_t B0, B1, B2, B3, B4;                                        \
+    uint64_t C0, C1, C2, C3, C4;                                        \
+    uint64_t D0, D1, D2, D3, D4;                                        \
+    int i;                                                              \
+                                                                        \
+    A00 = s[ 0]; A01 = s[ 1]; A02 = s[ 2]; A03 = s[ 3]; A04 = s[ 4];    \
+    A05 = s[ 5]; A06 = s[ 6]; A07 = s[ 7]; A08 = s[ 8]; A09 = s[ 9];    \
+    A10 = s[10]; A11 = s[11]; A12 = s[12]; A13 = s[13]; A14 = s[14];    \
+    A15 = s[15]; A16 = s[16]; A17 = s[17]; A18 = s[18]; A19 = s[19];    \
+    A20 = s[20]; A21 = s[21]; A22 = s[22]; A23 = s[23]; A24 = s[24];    \
+                                                                        \
+    for (i=24-nr; i<24; i+=2)                                           \
+    {                                                                   \
+        ROUND(A, E, ntru_keccak_r[i+0]);                                \
+        ROUND(E, A, ntru_keccak_r[i+1]);                                \
+    }                                                                   \
+                                                                        \
+    s[ 0] = A00; s[ 1] = A01; s[ 2] = A02; s[ 3] = A03; s[ 4] = A04;    \
+    s[ 5] = A05; s[ 6] = A06; s[ 7] = A07; s[ 8] = A08; s[ 9] = A09;    \
+    s[10] = A10; s[11] = A11; s[12] = A12; s[13] = A13; s[14] = A14;    \
+    s[15] = A15; s[16] = A16; s[17] = A17; s[18] = A18; s[19] = A19;    \
+    s[20] = A20; s[21] = A21; s[22] = A22; s[23] = A23; s[24] = A24;    \
+}                                                                       \
+while (0)
+
+/**
+ * The block operation performed on the state using lane complementing.
+ *
+ * @param [in] s   The state.
+ * @param [in] nr  The number of rounds to perform.
+ */
+static void ntru_keccak_block_lc(uint64_t *s, int nr)
+{
+    KECCAK_COMPLEMENT(s);
+    KECCAK_BLOCK(s, nr, KECCAK_ROUND_LC);
+    KECCAK_COMPLEMENT(s);
+}
+
+#if defined(CPU_X86_64) && (defined(CC_GCC) || defined(CC_CLANG))
+/**
+ * The block operation performed on the state using the ANDN instruction.
+ *
+ * @param [in] s   The state.
+ * @param [in] nr  The number of rounds to perform.
+ */
+__attribute__((target("bmi")))
+static void ntru_keccak_block_andn(uint64_t *s, int nr)
+{
+    KECCAK_BLOCK(s, nr, KECCAK_ROUND);
+}
+
+/** Check whether the CPU supports the BMI1 instructions. */
+#define NTRU_HAVE_BMI1()	__builtin_cpu_supports("bmi")
+
+#ifdef NTRU_KECCAK_ASM
+/* Generated by src/sha3/ntruenc_keccak.rb. */
+void ntru_keccak_block_asm(uint64_t *s, int nr);
+
+/** Check whether the CPU supports the BMI2 instructions. */
+#define NTRU_HAVE_BMI2()	__builtin_cpu_supports("bmi2")
+#endif
+#endif
+
+/**
+ * The block operation performed on the state.
+ * Uses the assembly code or ANDN when the CPU supports it and lane
+ * complementing otherwise.
+ *
+ * @param [in] s   The state.
+ * @param [in] nr  The number of rounds to perform.
+ */
+static void ntru_keccak_block(uint64_t *s, int nr)
+{
+#ifdef NTRU_HAVE_BMI2
+    if (NTRU_HAVE_BMI1() && NTRU_HAVE_BMI2())
+    {
+        ntru_keccak_block_asm(s, nr);
+        return;
+    }
+#endif
+#ifdef NTRU_HAVE_BMI1
+    if (NTRU_HAVE_BMI1())
+    {
+        ntru_keccak_block_andn(s, nr);
+        return;
+    }
+#endif
+    ntru_keccak_block_lc(s, nr);
+}
+#endif
+
+/**
+ * Perform the block operation with a specific implementation.
+ * Only one implementation is chosen at runtime so this is used to check each
+ * against the reference.
+ *
+ * @param [in] impl  The implementation: NTRU_KECCAK_IMPL_*.
+ * @param [in] s     The state.
+ * @param [in] nr    The number of rounds to perform.
+ * @return  1 on success.<br>
+ *          0 when the implementation is not available.
+ */
+int ntru_keccak_block_impl(int impl, uint64_t *s, int nr)
+{
+    switch (impl)
+    {
+    case NTRU_KECCAK_IMPL_REF:
+        ntru_keccak_block_ref(s, nr);
+        return 1;
+#ifndef NTRUENC_SMALL_CODE
+    case NTRU_KECCAK_IMPL_LC:
+        ntru_keccak_block_lc(s, nr);
+        return 1;
+#ifdef NTRU_HAVE_BMI1
+    case NTRU_KECCAK_IMPL_ANDN:
+        if (!NTRU_HAVE_BMI1())
+            return 0;
+        ntru_keccak_block_andn(s, nr);
+        return 1;
+#endif
+#ifdef NTRU_HAVE_BMI2
+    case NTRU_KECCAK_IMPL_ASM:
+        if (!NTRU_HAVE_BMI1() || !NTRU_HAVE_BMI2())
+            return 0;
+        ntru_keccak_block_asm(s, nr);
+        return 1;
+#endif
+#endif
+    }
+    return 0;
+}
+
 /**
  * Single shot hash operation.
  *
+ * @param [in] nr The number of rounds in the block operation.
  * @param [in] r  The number of bytes of message to put in.
  * @param [in] m  The message data to hash.
  * @param [in] n  The length of the message data.
@@ -264,8 +597,8 @@ static void ntru_keccak_block(uint64_t *s)
  * @param [in] b  The maximum length of output for one block.
  * @param [in] d  The number of bytes to output.
  */
-static void ntru_keccak(uint8_t r, const uint8_t *m, uint64_t n, uint8_t p,
-    uint8_t *h, uint64_t b, uint64_t d)
+static void ntru_keccak(int nr, uint8_t r, const uint8_t *m, uint64_t n,
+    uint8_t p, uint8_t *h, uint64_t b, uint64_t d)
 {
     uint64_t i, j;
     uint64_t s[25];
@@ -278,7 +611,7 @@ static void ntru_keccak(uint8_t r, const uint8_t *m, uint64_t n, uint8_t p,
     {
         for (i=0; i<r/8; i++)
             s[i] ^= ntru_keccak_le64(m+8*i);
-        ntru_keccak_block(s);
+        ntru_keccak_block(s, nr);
         n -= r;
         m += r;
     }
@@ -290,13 +623,13 @@ static void ntru_keccak(uint8_t r, const uint8_t *m, uint64_t n, uint8_t p,
     t[r-1] |= 0x80;
     for (i=0; i<r/8; i++)
         s[i] ^= ntru_keccak_le64(t+8*i);
-    ntru_keccak_block(s);
+    ntru_keccak_block(s, nr);
     for (i=0,j=0; i<d; i++,j++)
     {
         if (j == b)
         {
             j = 0;
-            ntru_keccak_block(s);
+            ntru_keccak_block(s, nr);
         }
         h[i] = s8[j];
     }
@@ -313,7 +646,733 @@ static void ntru_keccak(uint8_t r, const uint8_t *m, uint64_t n, uint8_t p,
  */
 int ntru_shake256(uint8_t *h, uint64_t l, const uint8_t *m, uint64_t n)
 {
-    ntru_keccak(17*8, m, n, 0x1f, h, 136, l);
+    ntru_keccak(24, 17*8, m, n, 0x1f, h, 136, l);
+    return 1;
+}
+
+/**
+ * Single shot TurboSHAKE128 operation.
+ *
+ * @param [in] h  The output data.
+ * @param [in] l  The number of bytes to output.
+ * @param [in] m  The message data to hash.
+ * @param [in] n  The length of the message data.
+ * @param [in] d  The domain separation byte: 0x01-0x7f.
+ * @return  1 on success.
+ */
+int ntru_turboshake128(uint8_t *h, uint64_t l, const uint8_t *m, uint64_t n,
+    uint8_t d)
+{
+    ntru_keccak(12, 21*8, m, n, d, h, 168, l);
     return 1;
 }
 
+/**
+ * Initialize the SHAKE context.
+ *
+ * @param [in] ctx  The SHAKE context.
+ * @param [in] r    The number of bytes in a block.
+ * @param [in] p    The padding byte at the end of the message.
+ * @param [in] nr   The number of rounds in the block operation.
+ */
+static void ntru_shake_init(NTRU_SHAKE *ctx, uint8_t r, uint8_t p, uint8_t nr)
+{
+    int i;
+
+    for (i=0; i<25; i++)
+        ctx->s[i] = 0;
+    ctx->r = r;
+    ctx->p = p;
+    ctx->nr = nr;
+    ctx->i = 0;
+    ctx->sq = 0;
+}
+
+/**
+ * Initialize the context for SHAKE-128.
+ *
+ * @param [in] ctx  The SHAKE context.
+ * @return  1 on success.
+ */
+int ntru_shake128_init(NTRU_SHAKE *ctx)
+{
+    ntru_shake_init(ctx, 168, 0x1f, 24);
+    return 1;
+}
+
+/**
+ * Initialize the context for SHAKE-256.
+ *
+ * @param [in] ctx  The SHAKE context.
+ * @return  1 on success.
+ */
+int ntru_shake256_init(NTRU_SHAKE *ctx)
+{
+    ntru_shake_init(ctx, 136, 0x1f, 24);
+    return 1;
+}
+
+/**
+ * Initialize the context for TurboSHAKE128.
+ * TurboSHAKE128 is SHAKE-128 with 12 rounds and a domain separation byte.
+ *
+ * @param [in] ctx  The SHAKE context.
+ * @param [in] d    The domain separation byte: 0x01-0x7f.
+ * @return  1 on success.<br>
+ *          0 when the domain separation byte is invalid.
+ */
+int ntru_turboshake128_init(NTRU_SHAKE *ctx, uint8_t d)
+{
+    if (d < 0x01 || d > 0x7f)
+        return 0;
+    ntru_shake_init(ctx, 168, d, 12);
+    return 1;
+}
+
+/**
+ * Absorb more message data into the SHAKE context.
+ * Can be called any number of times before output is squeezed.
+ *
+ * @param [in] ctx   The SHAKE context.
+ * @param [in] data  The message data.
+ * @param [in] len   The length of the message data.
+ * @return  1 on success.<br>
+ *          0 when output has already been squeezed.
+ */
+int ntru_shake_absorb(NTRU_SHAKE *ctx, const uint8_t *data, size_t len)
+{
+    uint8_t *s8 = (uint8_t *)ctx->s;
+    size_t i;
+
+    if (ctx->sq)
+        return 0;
+
+    /* Complete a partial block. */
+    while ((ctx->i != 0) && (len > 0))
+    {
+        s8[ctx->i++] ^= *(data++);
+        len--;
+        if (ctx->i == ctx->r)
+        {
+            ntru_keccak_block(ctx->s, ctx->nr);
+            ctx->i = 0;
+        }
+    }
+    /* Whole blocks. */
+    while (len >= ctx->r)
+    {
+        for (i=0; i<ctx->r/8u; i++)
+            ctx->s[i] ^= ntru_keccak_le64(data+8*i);
+        ntru_keccak_block(ctx->s, ctx->nr);
+        data += ctx->r;
+        len -= ctx->r;
+    }
+    /* Start of the next block. */
+    for (i=0; i<len; i++)
+        s8[ctx->i+i] ^= data[i];
+    ctx->i += len;
+
+    return 1;
+}
+
+/**
+ * Finish absorbing message data - pad and process the last block.
+ * Called implicitly by the first squeeze.
+ *
+ * @param [in] ctx  The SHAKE context.
+ * @return  1 on success.
+ */
+int ntru_shake_final(NTRU_SHAKE *ctx)
+{
+    uint8_t *s8 = (uint8_t *)ctx->s;
+
+    if (!ctx->sq)
+    {
+        s8[ctx->i] ^= ctx->p;
+        s8[ctx->r-1] ^= 0x80;
+        ntru_keccak_block(ctx->s, ctx->nr);
+        ctx->i = 0;
+        ctx->sq = 1;
+    }
+
+    return 1;
+}
+
+/**
+ * Squeeze output from the SHAKE context.
+ * Can be called any number of times to get more output.
+ *
+ * @param [in] ctx  The SHAKE context.
+ * @param [in] out  The buffer to hold the output.
+ * @param [in] len  The number of bytes to output.
+ * @return  1 on success.
+ */
+int ntru_shake_squeeze(NTRU_SHAKE *ctx, uint8_t *out, size_t len)
+{
+    uint8_t *s8 = (uint8_t *)ctx->s;
+    size_t i;
+
+    ntru_shake_final(ctx);
+
+    for (i=0; i<len; i++)
+    {
+        if (ctx->i == ctx->r)
+        {
+            ntru_keccak_block(ctx->s, ctx->nr);
+            ctx->i = 0;
+        }
+        out[i] = s8[ctx->i++];
+    }
+
+    return 1;
+}
+
+/**
+ * Initialize the SHA-3 hash context.
+ *
+ * @param [in] ctx  The SHA-3 context.
+ * @return  1 on success.
+ */
+int ntru_sha3_init(NTRU_SHA3 *ctx)
+{
+    int i;
+
+    for (i=0; i<25; i++)
+        ctx->s[i] = 0;
+    ctx->i = 0;
+    return 1;
+}
+
+/**
+ * Add message data to the SHA-3 hash context.
+ *
+ * @param [in] ctx   The SHA-3 context.
+ * @param [in] r     The number of bytes in a block.
+ * @param [in] data  The message data.
+ * @param [in] len   The length of the message data.
+ */
+static void ntru_sha3_update(NTRU_SHA3 *ctx, uint8_t r, const uint8_t *data,
+    size_t len)
+{
+    size_t i;
+
+    while (len > 0)
+    {
+        ctx->t[ctx->i++] = *(data++);
+        len--;
+        if (ctx->i == r)
+        {
+            for (i=0; i<r/8u; i++)
+                ctx->s[i] ^= ntru_keccak_le64(ctx->t+8*i);
+            ntru_keccak_block(ctx->s, 24);
+            ctx->i = 0;
+        }
+    }
+}
+
+/**
+ * Pad the message and output the SHA-3 digest.
+ *
+ * @param [in] md   The message digest.
+ * @param [in] ctx  The SHA-3 context.
+ * @param [in] r    The number of bytes in a block.
+ * @param [in] d    The number of bytes in the digest.
+ */
+static void ntru_sha3_final(unsigned char *md, NTRU_SHA3 *ctx, uint8_t r,
+    uint8_t d)
+{
+    int i;
+    uint8_t *s8 = (uint8_t *)ctx->s;
+
+    for (i=ctx->i; i<r; i++)
+        ctx->t[i] = 0;
+    ctx->t[ctx->i] = 0x06;
+    ctx->t[r-1] |= 0x80;
+    for (i=0; i<r/8; i++)
+        ctx->s[i] ^= ntru_keccak_le64(ctx->t+8*i);
+    ntru_keccak_block(ctx->s, 24);
+    for (i=0; i<d; i++)
+        md[i] = s8[i];
+}
+
+/**
+ * Add message data to the SHA3-224 hash.
+ *
+ * @param [in] ctx   The SHA-3 context.
+ * @param [in] data  The message data.
+ * @param [in] len   The length of the message data.
+ * @return  1 on success.
+ */
+int ntru_sha3_224_update(NTRU_SHA3 *ctx, const uint8_t *data, size_t len)
+{
+    ntru_sha3_update(ctx, 144, data, len);
+    return 1;
+}
+
+/**
+ * Output the SHA3-224 digest.
+ *
+ * @param [in] md   The message digest.
+ * @param [in] ctx  The SHA-3 context.
+ * @return  1 on success.
+ */
+int ntru_sha3_224_final(unsigned char *md, NTRU_SHA3 *ctx)
+{
+    ntru_sha3_final(md, ctx, 144, 28);
+    return 1;
+}
+
+/**
+ * Add message data to the SHA3-256 hash.
+ *
+ * @param [in] ctx   The SHA-3 context.
+ * @param [in] data  The message data.
+ * @param [in] len   The length of the message data.
+ * @return  1 on success.
+ */
+int ntru_sha3_256_update(NTRU_SHA3 *ctx, const uint8_t *data, size_t len)
+{
+    ntru_sha3_update(ctx, 136, data, len);
+    return 1;
+}
+
+/**
+ * Output the SHA3-256 digest.
+ *
+ * @param [in] md   The message digest.
+ * @param [in] ctx  The SHA-3 context.
+ * @return  1 on success.
+ */
+int ntru_sha3_256_final(unsigned char *md, NTRU_SHA3 *ctx)
+{
+    ntru_sha3_final(md, ctx, 136, 32);
+    return 1;
+}
+
+/**
+ * Add message data to the SHA3-384 hash.
+ *
+ * @param [in] ctx   The SHA-3 context.
+ * @param [in] data  The message data.
+ * @param [in] len   The length of the message data.
+ * @return  1 on success.
+ */
+int ntru_sha3_384_update(NTRU_SHA3 *ctx, const uint8_t *data, size_t len)
+{
+    ntru_sha3_update(ctx, 104, data, len);
+    return 1;
+}
+
+/**
+ * Output the SHA3-384 digest.
+ *
+ * @param [in] md   The message digest.
+ * @param [in] ctx  The SHA-3 context.
+ * @return  1 on success.
+ */
+int ntru_sha3_384_final(unsigned char *md, NTRU_SHA3 *ctx)
+{
+    ntru_sha3_final(md, ctx, 104, 48);
+    return 1;
+}
+
+/**
+ * Add message data to the SHA3-512 hash.
+ *
+ * @param [in] ctx   The SHA-3 context.
+ * @param [in] data  The message data.
+ * @param [in] len   The length of the message data.
+ * @return  1 on success.
+ */
+int ntru_sha3_512_update(NTRU_SHA3 *ctx, const uint8_t *data, size_t len)
+{
+    ntru_sha3_update(ctx, 72, data, len);
+    return 1;
+}
+
+/**
+ * Output the SHA3-512 digest.
+ *
+ * @param [in] md   The message digest.
+ * @param [in] ctx  The SHA-3 context.
+ * @return  1 on success.
+ */
+int ntru_sha3_512_final(unsigned char *md, NTRU_SHA3 *ctx)
+{
+    ntru_sha3_final(md, ctx, 72, 64);
+    return 1;
+}
+
+
+/**
+ * Single shot hash operation of SHA3-256.
+ *
+ * @param [in] h  The message digest data.
+ * @param [in] m  The message data to hash.
+ * @param [in] n  The length of the message data.
+ * @return  1 on success.
+ */
+int ntru_sha3_256(uint8_t *h, const uint8_t *m, uint64_t n)
+{
+    ntru_keccak(24, 17*8, m, n, 0x06, h, 136, 32);
+    return 1;
+}
+
+#if defined(CPU_X86_64) && (defined(CC_GCC) || defined(CC_CLANG))
+#include <immintrin.h>
+
+/** Rotate the 64-bit lanes of an AVX2 register left. */
+#define ROL_X4(a, n)                                                    \
+    _mm256_or_si256(_mm256_slli_epi64(a, n), _mm256_srli_epi64(a, 64-(n)))
+
+/**
+ * Swap operation on 4 interleaved states.
+ *
+ * @param [in] s   The states.
+ * @param [in] t1  Temporary value.
+ * @param [in] t2  Second temporary value.
+ * @param [in] i   The index of the loop.
+ */
+#define SWAP_X4(s, t1, t2, i)                                           \
+do                                                                      \
+{                                                                       \
+    t2 = s[K_I_##i]; s[K_I_##i] = ROL_X4(t1, K_R_##i);                  \
+}                                                                       \
+while (0)
+
+/**
+ * The block operation performed on 4 states at once using AVX2.
+ * Lane i of state k is at index i*4+k.
+ *
+ * @param [in] st  The interleaved states.
+ * @param [in] nr  The number of rounds to perform.
+ */
+__attribute__((target("avx2")))
+static void ntru_keccak_block_x4(uint64_t *st, int nr)
+{
+    int i, x, y;
+    __m256i s[25];
+    __m256i b[5];
+    __m256i t0, t1;
+
+    for (i=0; i<25; i++)
+        s[i] = _mm256_loadu_si256((__m256i *)(st + i*4));
+
+    for (i=24-nr; i<24; i++)
+    {
+        for (x=0; x<5; x++)
+        {
+            b[x] = _mm256_xor_si256(_mm256_xor_si256(s[x+0], s[x+5]),
+                _mm256_xor_si256(s[x+10], s[x+15]));
+            b[x] = _mm256_xor_si256(b[x], s[x+20]);
+        }
+        for (x=0; x<5; x++)
+        {
+            t0 = _mm256_xor_si256(b[(x+4)%5], ROL_X4(b[(x+1)%5], 1));
+            for (y=0; y<25; y+=5)
+                s[x+y] = _mm256_xor_si256(s[x+y], t0);
+        }
+
+        t0 = s[1];
+        SWAP_X4(s, t0, t1,  0);
+        SWAP_X4(s, t1, t0,  1);
+        SWAP_X4(s, t0, t1,  2);
+        SWAP_X4(s, t1, t0,  3);
+        SWAP_X4(s, t0, t1,  4);
+        SWAP_X4(s, t1, t0,  5);
+        SWAP_X4(s, t0, t1,  6);
+        SWAP_X4(s, t1, t0,  7);
+        SWAP_X4(s, t0, t1,  8);
+        SWAP_X4(s, t1, t0,  9);
+        SWAP_X4(s, t0, t1, 10);
+        SWAP_X4(s, t1, t0, 11);
+        SWAP_X4(s, t0, t1, 12);
+        SWAP_X4(s, t1, t0, 13);
+        SWAP_X4(s, t0, t1, 14);
+        SWAP_X4(s, t1, t0, 15);
+        SWAP_X4(s, t0, t1, 16);
+        SWAP_X4(s, t1, t0, 17);
+        SWAP_X4(s, t0, t1, 18);
+        SWAP_X4(s, t1, t0, 19);
+        SWAP_X4(s, t0, t1, 20);
+        SWAP_X4(s, t1, t0, 21);
+        SWAP_X4(s, t0, t1, 22);
+        SWAP_X4(s, t1, t0, 23);
+
+        for (y=0; y<25; y+=5)
+        {
+            for (x=0; x<5; x++)
+                b[x] = s[y+x];
+            for (x=0; x<5; x++)
+            {
+                s[y+x] = _mm256_xor_si256(b[x],
+                    _mm256_andnot_si256(b[(x+1)%5], b[(x+2)%5]));
+            }
+        }
+
+        s[0] = _mm256_xor_si256(s[0],
+            _mm256_set1_epi64x((long long)ntru_keccak_r[i]));
+    }
+
+    for (i=0; i<25; i++)
+        _mm256_storeu_si256((__m256i *)(st + i*4), s[i]);
+}
+
+/**
+ * Swap operation on 8 interleaved states.
+ *
+ * @param [in] s   The states.
+ * @param [in] t1  Temporary value.
+ * @param [in] t2  Second temporary value.
+ * @param [in] i   The index of the loop.
+ */
+#define SWAP_X8(s, t1, t2, i)                                           \
+do                                                                      \
+{                                                                       \
+    t2 = s[K_I_##i]; s[K_I_##i] = _mm512_rol_epi64(t1, K_R_##i);        \
+}                                                                       \
+while (0)
+
+/**
+ * The block operation performed on 8 states at once using AVX-512.
+ * Lane i of state k is at index i*8+k.
+ * Ternary logic: 0x96 is a^b^c and 0xd2 is a^(~b&c).
+ *
+ * @param [in] st  The interleaved states.
+ * @param [in] nr  The number of rounds to perform.
+ */
+__attribute__((target("avx512f")))
+static void ntru_keccak_block_x8(uint64_t *st, int nr)
+{
+    int i, x, y;
+    __m512i s[25];
+    __m512i b[5];
+    __m512i t0, t1;
+
+    for (i=0; i<25; i++)
+        s[i] = _mm512_loadu_si512((__m512i *)(st + i*8));
+
+    for (i=24-nr; i<24; i++)
+    {
+        for (x=0; x<5; x++)
+        {
+            b[x] = _mm512_ternarylogic_epi64(s[x+0], s[x+5], s[x+10], 0x96);
+            b[x] = _mm512_ternarylogic_epi64(b[x], s[x+15], s[x+20], 0x96);
+        }
+        for (x=0; x<5; x++)
+        {
+            t0 = _mm512_rol_epi64(b[(x+1)%5], 1);
+            for (y=0; y<25; y+=5)
+                s[x+y] = _mm512_ternarylogic_epi64(s[x+y], b[(x+4)%5], t0,
+                    0x96);
+        }
+
+        t0 = s[1];
+        SWAP_X8(s, t0, t1,  0);
+        SWAP_X8(s, t1, t0,  1);
+        SWAP_X8(s, t0, t1,  2);
+        SWAP_X8(s, t1, t0,  3);
+        SWAP_X8(s, t0, t1,  4);
+        SWAP_X8(s, t1, t0,  5);
+        SWAP_X8(s, t0, t1,  6);
+        SWAP_X8(s, t1, t0,  7);
+        SWAP_X8(s, t0, t1,  8);
+        SWAP_X8(s, t1, t0,  9);
+        SWAP_X8(s, t0, t1, 10);
+        SWAP_X8(s, t1, t0, 11);
+        SWAP_X8(s, t0, t1, 12);
+        SWAP_X8(s, t1, t0, 13);
+        SWAP_X8(s, t0, t1, 14);
+        SWAP_X8(s, t1, t0, 15);
+        SWAP_X8(s, t0, t1, 16);
+        SWAP_X8(s, t1, t0, 17);
+        SWAP_X8(s, t0, t1, 18);
+        SWAP_X8(s, t1, t0, 19);
+        SWAP_X8(s, t0, t1, 20);
+        SWAP_X8(s, t1, t0, 21);
+        SWAP_X8(s, t0, t1, 22);
+        SWAP_X8(s, t1, t0, 23);
+
+        for (y=0; y<25; y+=5)
+        {
+            for (x=0; x<5; x++)
+                b[x] = s[y+x];
+            for (x=0; x<5; x++)
+                s[y+x] = _mm512_ternarylogic_epi64(b[x], b[(x+1)%5],
+                    b[(x+2)%5], 0xd2);
+        }
+
+        s[0] = _mm512_xor_si512(s[0],
+            _mm512_set1_epi64((long long)ntru_keccak_r[i]));
+    }
+
+    for (i=0; i<25; i++)
+        _mm512_storeu_si512((__m512i *)(st + i*8), s[i]);
+}
+
+/**
+ * Single shot hash operation on w messages of the same length at once.
+ * The states are interleaved: lane i of state k is at index i*w+k.
+ *
+ * @param [in] w      The number of states.
+ * @param [in] block  The block operation on w interleaved states.
+ * @param [in] nr     The number of rounds in the block operation.
+ * @param [in] r      The number of bytes of message to put in.
+ * @param [in] m      The message data to hash - w pointers.
+ * @param [in] n      The length of each message.
+ * @param [in] p      The padding byte at the end of the message.
+ * @param [in] h      The message digest data - w pointers.
+ * @param [in] b      The maximum length of output for one block.
+ * @param [in] d      The number of bytes to output for each message.
+ */
+static void ntru_keccak_xn(int w, void (*block)(uint64_t *s, int nr),
+    int nr, uint8_t r, const uint8_t **m, uint64_t n, uint8_t p, uint8_t **h,
+    uint64_t b, uint64_t d)
+{
+    uint64_t i, j, o;
+    int k;
+    uint64_t s[25*8];
+    uint8_t t[200];
+
+    for (i=0; i<(uint64_t)25*w; i++)
+        s[i] = 0;
+    for (o=0; n-o >= r; o+=r)
+    {
+        for (k=0; k<w; k++)
+        {
+            for (i=0; i<r/8; i++)
+                s[i*w+k] ^= ntru_keccak_le64(m[k]+o+8*i);
+        }
+        block(s, nr);
+    }
+    for (k=0; k<w; k++)
+    {
+        for (i=0; i<n-o; i++)
+            t[i] = m[k][o+i];
+        for (; i<r; i++)
+            t[i] = 0;
+        t[n-o] = p;
+        t[r-1] |= 0x80;
+        for (i=0; i<r/8; i++)
+            s[i*w+k] ^= ntru_keccak_le64(t+8*i);
+    }
+    block(s, nr);
+    for (i=0,j=0; i<d; i++,j++)
+    {
+        if (j == b)
+        {
+            j = 0;
+            block(s, nr);
+        }
+        for (k=0; k<w; k++)
+            h[k][i] = (uint8_t)(s[(j/8)*w+k] >> (8*(j&7)));
+    }
+}
+
+/** Indicates the AVX2 implementation is usable. */
+#define NTRU_HAVE_AVX2()	__builtin_cpu_supports("avx2")
+/** Indicates the AVX-512 implementation is usable. */
+#define NTRU_HAVE_AVX512()	__builtin_cpu_supports("avx512f")
+#endif
+
+/**
+ * Single shot hash operation of SHAKE-256 on 4 messages of the same length.
+ *
+ * @param [in] h  The message digest data - 4 pointers.
+ * @param [in] l  The number of bytes to output for each message.
+ * @param [in] m  The message data to hash - 4 pointers.
+ * @param [in] n  The length of each message.
+ * @return  1 on success.
+ */
+int ntru_shake256_x4(uint8_t **h, uint64_t l, const uint8_t **m, uint64_t n)
+{
+    int k;
+
+#ifdef NTRU_HAVE_AVX2
+    if (NTRU_HAVE_AVX2())
+    {
+        ntru_keccak_xn(4, ntru_keccak_block_x4, 24,
+            17*8, m, n, 0x1f, h, 136, l);
+        return 1;
+    }
+#endif
+    for (k=0; k<4; k++)
+        ntru_keccak(24, 17*8, m[k], n, 0x1f, h[k], 136, l);
+    return 1;
+}
+
+/**
+ * Single shot hash operation of SHAKE-256 on 8 messages of the same length.
+ *
+ * @param [in] h  The message digest data - 8 pointers.
+ * @param [in] l  The number of bytes to output for each message.
+ * @param [in] m  The message data to hash - 8 pointers.
+ * @param [in] n  The length of each message.
+ * @return  1 on success.
+ */
+int ntru_shake256_x8(uint8_t **h, uint64_t l, const uint8_t **m, uint64_t n)
+{
+#ifdef NTRU_HAVE_AVX512
+    if (NTRU_HAVE_AVX512())
+    {
+        ntru_keccak_xn(8, ntru_keccak_block_x8, 24,
+            17*8, m, n, 0x1f, h, 136, l);
+        return 1;
+    }
+#endif
+    ntru_shake256_x4(h, l, m, n);
+    ntru_shake256_x4(h+4, l, m+4, n);
+    return 1;
+}
+
+/**
+ * Single shot TurboSHAKE128 operation on 4 messages of the same length.
+ *
+ * @param [in] h  The output data - 4 pointers.
+ * @param [in] l  The number of bytes to output for each message.
+ * @param [in] m  The message data to hash - 4 pointers.
+ * @param [in] n  The length of each message.
+ * @param [in] d  The domain separation byte: 0x01-0x7f.
+ * @return  1 on success.
+ */
+int ntru_turboshake128_x4(uint8_t **h, uint64_t l, const uint8_t **m,
+    uint64_t n, uint8_t d)
+{
+    int k;
+
+#ifdef NTRU_HAVE_AVX2
+    if (NTRU_HAVE_AVX2())
+    {
+        ntru_keccak_xn(4, ntru_keccak_block_x4, 12, 21*8, m, n, d, h, 168, l);
+        return 1;
+    }
+#endif
+    for (k=0; k<4; k++)
+        ntru_keccak(12, 21*8, m[k], n, d, h[k], 168, l);
+    return 1;
+}
+
+/**
+ * Single shot TurboSHAKE128 operation on 8 messages of the same length.
+ *
+ * @param [in] h  The output data - 8 pointers.
+ * @param [in] l  The number of bytes to output for each message.
+ * @param [in] m  The message data to hash - 8 pointers.
+ * @param [in] n  The length of each message.
+ * @param [in] d  The domain separation byte: 0x01-0x7f.
+ * @return  1 on success.
+ */
+int ntru_turboshake128_x8(uint8_t **h, uint64_t l, const uint8_t **m,
+    uint64_t n, uint8_t d)
+{
+#ifdef NTRU_HAVE_AVX512
+    if (NTRU_HAVE_AVX512())
+    {
+        ntru_keccak_xn(8, ntru_keccak_block_x8, 12, 21*8, m, n, d, h, 168, l);
+        return 1;
+    }
+#endif
+    ntru_turboshake128_x4(h, l, m, n, d);
+    ntru_turboshake128_x4(h+4, l, m+4, n, d);
+    return 1;
+}
@@ -20,6 +20,9 @@
  * SOFTWARE.
  */
 
+#ifndef NTRUENC_SHA3_H
+#define NTRUENC_SHA3_H
+
 #include <stdlib.h>
 #include <stdint.h>
 
@@ -34,6 +37,36 @@ typedef struct ntru_sha3_t
     uint8_t i;
 } NTRU_SHA3;
 
+/** The SHAKE extendable output function data. */
+typedef struct ntru_shake_t
+{
+    /** State data that is processed for each block. */
+    uint64_t s[25];
+    /** The number of bytes in a block. */
+    uint8_t r;
+    /** The padding byte at the end of the message. */
+    uint8_t p;
+    /** The number of rounds in the block operation. */
+    uint8_t nr;
+    /** Index into block to absorb or squeeze next byte. */
+    uint8_t i;
+    /** Indicates absorbing is finished and output is being squeezed. */
+    uint8_t sq;
+} NTRU_SHAKE;
+
+/** The portable Keccak block operation that uses loops. */
+#define NTRU_KECCAK_IMPL_REF	0
+/** The unrolled Keccak block operation using lane complementing. */
+#define NTRU_KECCAK_IMPL_LC	1
+/** The unrolled Keccak block operation using the BMI1 ANDN instruction. */
+#define NTRU_KECCAK_IMPL_ANDN	2
+/** The generated assembly Keccak block operation using BMI1 and BMI2. */
+#define NTRU_KECCAK_IMPL_ASM	3
+/** The number of implementations of the Keccak block operation. */
+#define NTRU_KECCAK_IMPL_NUM	4
+
+int ntru_keccak_block_impl(int impl, uint64_t *s, int nr);
+
 int ntru_sha3_init(NTRU_SHA3 *ctx);
 int ntru_sha3_224_update(NTRU_SHA3 *ctx, const uint8_t *data, size_t len);
 int ntru_sha3_224_final(unsigned char *md, NTRU_SHA3 *ctx);
@@ -44,10 +77,28 @@ int ntru_sha3_384_final(unsigned char *md, NTRU_SHA3 *ctx);
 int ntru_sha3_512_update(NTRU_SHA3 *ctx, const uint8_t *data, size_t len);
 int ntru_sha3_512_final(unsigned char *md, NTRU_SHA3 *ctx);
 
+int ntru_shake128_init(NTRU_SHAKE *ctx);
+int ntru_shake256_init(NTRU_SHAKE *ctx);
+int ntru_turboshake128_init(NTRU_SHAKE *ctx, uint8_t d);
+int ntru_shake_absorb(NTRU_SHAKE *ctx, const uint8_t *data, size_t len);
+int ntru_shake_final(NTRU_SHAKE *ctx);
+int ntru_shake_squeeze(NTRU_SHAKE *ctx, uint8_t *out, size_t len);
+
 int ntru_shake128(uint8_t *h, uint64_t l, const uint8_t *m, uint64_t n);
 int ntru_shake256(uint8_t *h, uint64_t l, const uint8_t *m, uint64_t n);
+int ntru_turboshake128(uint8_t *h, uint64_t l, const uint8_t *m, uint64_t n,
+    uint8_t d);
 int ntru_sha3_224(uint8_t *h, const uint8_t *m, uint64_t n);
 int ntru_sha3_256(uint8_t *h, const uint8_t *m, uint64_t n);
 int ntru_sha3_384(uint8_t *h, const uint8_t *m, uint64_t n);
 int ntru_sha3_512(uint8_t *h, const uint8_t *m, uint64_t n);
 
+int ntru_shake256_x4(uint8_t **h, uint64_t l, const uint8_t **m, uint64_t n);
+int ntru_shake256_x8(uint8_t **h, uint64_t l, const uint8_t **m, uint64_t n);
+int ntru_turboshake128_x4(uint8_t **h, uint64_t l, const uint8_t **m,
+    uint64_t n, uint8_t d);
+int ntru_turboshake128_x8(uint8_t **h, uint64_t l, const uint8_t **m,
+    uint64_t n, uint8_t d);
+
+#endif /* NTRUENC_SHA3_H */
+
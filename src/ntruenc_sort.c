@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "ntruenc_lcl.h"
+
+/**
+ * Put the smaller of the two values into a and the larger into b.
+ * Constant time - no branches or memory accesses depend on the values.
+ *
+ * @param [in] a  The first value.
+ * @param [in] b  The second value.
+ */
+#define INT32_MINMAX(a, b)                                              \
+do                                                                      \
+{                                                                       \
+    int32_t ab = (b) ^ (a);                                             \
+    int32_t c = (int32_t)((int64_t)(b) - (int64_t)(a));                 \
+    c ^= ab & (c ^ (b));                                                \
+    c >>= 31;                                                           \
+    c &= ab;                                                            \
+    (a) ^= c;                                                           \
+    (b) ^= c;                                                           \
+}                                                                       \
+while (0)
+
+/**
+ * Sort the array of signed 32-bit values in constant time.
+ * Batcher odd-even merge sorting network from the public domain djbsort.
+ *
+ * @param [in] x  The array to sort.
+ * @param [in] n  The number of elements in the array.
+ */
+static void ntruenc_sort_int32_c(int32_t *x, int n)
+{
+    int top, p, q, r, i;
+    int32_t a;
+
+    if (n < 2)
+        return;
+    top = 1;
+    while (top < n - top)
+        top += top;
+
+    for (p=top; p>0; p>>=1)
+    {
+        for (i=0; i<n-p; i++)
+        {
+            if ((i & p) == 0)
+                INT32_MINMAX(x[i], x[i+p]);
+        }
+        i = 0;
+        for (q=top; q>p; q>>=1)
+        {
+            for (; i<n-q; i++)
+            {
+                if ((i & p) == 0)
+                {
+                    a = x[i+p];
+                    for (r=q; r>p; r>>=1)
+                        INT32_MINMAX(a, x[i+r]);
+                    x[i+p] = a;
+                }
+            }
+        }
+    }
+}
+
+#if defined(CPU_X86_64) && (defined(CC_GCC) || defined(CC_CLANG))
+#include <immintrin.h>
+
+/** The maximum number of elements sorted by the AVX2 implementation. */
+#define NTRU_SORT_AVX2_MAX	1024
+
+/**
+ * Sort the array of signed 32-bit values in constant time using AVX2.
+ * Bitonic sorting network on the array padded to a power of 2.
+ * Compare distances of 8 or more exchange whole vectors.
+ * Shorter distances permute within a vector and blend with a lane mask.
+ *
+ * @param [in] x  The array to sort.
+ * @param [in] n  The number of elements in the array.
+ */
+__attribute__((target("avx2")))
+static void ntruenc_sort_int32_avx2(int32_t *x, int n)
+{
+    int n2, i, j, k;
+    int32_t t[NTRU_SORT_AVX2_MAX] __attribute__((aligned(32)));
+    __m256i a, b, mn, mx, iv, m, d;
+    __m256i idx[5], lo[5];
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i zero = _mm256_setzero_si256();
+
+    /* Permutation to partner lane and mask of lower lanes of pairs. */
+    for (j=1; j<8; j<<=1)
+    {
+        idx[j] = _mm256_xor_si256(lane, _mm256_set1_epi32(j));
+        lo[j] = _mm256_cmpeq_epi32(_mm256_and_si256(lane,
+            _mm256_set1_epi32(j)), zero);
+    }
+
+    for (n2=8; n2<n; n2<<=1)
+        ;
+    memcpy(t, x, n * sizeof(*x));
+    /* Padding sorts to the end. */
+    for (i=n; i<n2; i++)
+        t[i] = INT32_MAX;
+
+    for (k=2; k<=n2; k<<=1)
+    {
+        for (j=k>>1; j>=8; j>>=1)
+        {
+            for (i=0; i<n2; i+=8)
+            {
+                if ((i & j) != 0)
+                    continue;
+                a = _mm256_load_si256((__m256i *)(t + i));
+                b = _mm256_load_si256((__m256i *)(t + i + j));
+                mn = _mm256_min_epi32(a, b);
+                mx = _mm256_max_epi32(a, b);
+                /* Direction depends on index only - not on data. */
+                if ((i & k) == 0)
+                {
+                    _mm256_store_si256((__m256i *)(t + i), mn);
+                    _mm256_store_si256((__m256i *)(t + i + j), mx);
+                }
+                else
+                {
+                    _mm256_store_si256((__m256i *)(t + i), mx);
+                    _mm256_store_si256((__m256i *)(t + i + j), mn);
+                }
+            }
+        }
+        /* Distances 4, 2 and 1 are all done within each vector. */
+        for (i=0; i<n2; i+=8)
+        {
+            a = _mm256_load_si256((__m256i *)(t + i));
+            iv = _mm256_add_epi32(_mm256_set1_epi32(i), lane);
+            /* All ones in lanes sorted ascending. */
+            d = _mm256_cmpeq_epi32(_mm256_and_si256(iv,
+                _mm256_set1_epi32(k)), zero);
+            for (j=(k < 8) ? k>>1 : 4; j>0; j>>=1)
+            {
+                b = _mm256_permutevar8x32_epi32(a, idx[j]);
+                mn = _mm256_min_epi32(a, b);
+                mx = _mm256_max_epi32(a, b);
+                /* Take min when lower of pair and ascending or neither. */
+                m = _mm256_xor_si256(lo[j], d);
+                a = _mm256_blendv_epi8(mn, mx, m);
+            }
+            _mm256_store_si256((__m256i *)(t + i), a);
+        }
+    }
+
+    memcpy(x, t, n * sizeof(*x));
+    memset(t, 0, n2 * sizeof(*t));
+}
+
+/** Indicates the AVX2 implementation is usable and to be used. */
+#define NTRU_HAVE_AVX2()						\
+    (((ntruenc_simd_off & NTRU_SIMD_AVX2) == 0) &&			\
+     __builtin_cpu_supports("avx2"))
+#endif
+
+/**
+ * Sort the array of signed 32-bit values in constant time.
+ * No branches or memory accesses depend on the values.
+ *
+ * @param [in] x  The array to sort.
+ * @param [in] n  The number of elements in the array.
+ */
+void ntruenc_sort_int32(int32_t *x, int n)
+{
+#ifdef NTRU_HAVE_AVX2
+    if ((n <= NTRU_SORT_AVX2_MAX) && NTRU_HAVE_AVX2())
+    {
+        ntruenc_sort_int32_avx2(x, n);
+        return;
+    }
+#endif
+    ntruenc_sort_int32_c(x, n);
+}
@@ -0,0 +1,573 @@
+/*
+ * Copyright (c) 2016 Sean Parkinson (sparkinson@iprimus.com.au)
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ntruenc_lcl.h"
+#include "ntruenc_key_lcl.h"
+#include "ntruenc_sha3.h"
+#include "ntruenc_store.h"
+
+/** The magic bytes at the start of a key store file. */
+#define NTRU_STORE_MAGIC	"NTRUKEYS"
+/** The version of the key store file format. */
+#define NTRU_STORE_VERSION	1
+/** Written in native byte order to detect a store of another byte order. */
+#define NTRU_STORE_ENDIAN	0x01020304
+/** The alignment of the sections and keys in a store. */
+#define NTRU_STORE_ALIGN	64
+/** Round the offset up to the alignment of the store. */
+#define NTRU_STORE_ALIGN_UP(o)	\
+    (((o) + NTRU_STORE_ALIGN - 1) & ~(uint64_t)(NTRU_STORE_ALIGN - 1))
+
+/**
+ * The header of a key store file.
+ * Values are in the native byte order of the machine that wrote the store.
+ */
+typedef struct ntruenc_store_hdr_st
+{
+    /** Magic bytes: NTRU_STORE_MAGIC. */
+    char magic[8];
+    /** The version of the file format. */
+    uint32_t version;
+    /** Byte order check: NTRU_STORE_ENDIAN. */
+    uint32_t endian;
+    /** The security strength of the parameters of all keys. */
+    uint16_t strength;
+    /** The number of elements in each key. */
+    uint16_t n;
+    /** The number of keys in the store. */
+    uint32_t cnt;
+    /** The number of entries in the hash index - a power of 2. */
+    uint32_t buckets;
+    /** The number of bytes from the start of one key to the next. */
+    uint32_t stride;
+    /** The offset of the hash index from the start of the file. */
+    uint64_t index_off;
+    /** The offset of the first key from the start of the file. */
+    uint64_t keys_off;
+    /** Reserved - zero. */
+    unsigned char pad[16];
+} NTRUENC_STORE_HDR;
+
+/**
+ * An entry in the hash index of a key store.
+ */
+typedef struct ntruenc_store_entry_st
+{
+    /** The key identifier. */
+    unsigned char id[NTRU_KEY_ID_LEN];
+    /** The index of the key plus one - 0 indicates an empty entry. */
+    uint32_t idx;
+    /** Reserved - zero. */
+    uint32_t pad;
+} NTRUENC_STORE_ENTRY;
+
+/**
+ * An open key store - the file is mapped into memory.
+ */
+struct ntruenc_store_st
+{
+    /** The mapped file. */
+    unsigned char *map;
+    /** The length of the mapped file. */
+    size_t len;
+    /** The parameters of all keys in the store. */
+    NTRUENC_PARAMS *params;
+    /** The number of keys in the store. */
+    uint32_t cnt;
+    /** The number of entries in the hash index. */
+    uint32_t buckets;
+    /** The number of bytes from the start of one key to the next. */
+    uint32_t stride;
+    /** The hash index. */
+    NTRUENC_STORE_ENTRY *index;
+    /** The first key. */
+    unsigned char *keys;
+};
+
+/** Zeros to pad sections and keys to the alignment. */
+static unsigned char ntruenc_store_zero[NTRU_STORE_ALIGN];
+
+/**
+ * Calculate the hash index bucket of the key identifier.
+ * FNV-1a so that identifiers that are not hash outputs spread well.
+ *
+ * @param [in] id    The key identifier.
+ * @param [in] mask  The number of buckets less one.
+ * @return  The bucket to start searching from.
+ */
+static uint32_t ntruenc_store_bucket(unsigned char *id, uint32_t mask)
+{
+    int i;
+    uint32_t h = 0x811c9dc5;
+
+    for (i=0; i<NTRU_KEY_ID_LEN; i++)
+        h = (h ^ id[i]) * 0x01000193;
+
+    return h & mask;
+}
+
+/**
+ * Calculate the identifier of a public key.
+ * The identifier is the SHAKE-256 hash of the key packed with 11 bits per
+ * element so that it doesn't depend on how the key was decoded.
+ *
+ * @param [in] key  The public key.
+ * @param [in] id   The buffer to hold the identifier.
+ * @param [in] len  The length of the identifier in bytes. Stores use
+ *                  NTRU_KEY_ID_LEN.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_BAD_DATA when the key has no value.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate memory.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_PUB_KEY_get_id(NTRUENC_PUB_KEY *key, unsigned char *id, int len)
+{
+    int ret = 0;
+    unsigned char *data = NULL;
+    int dlen;
+
+    if ((key == NULL) || (id == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (key->h == NULL)
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+
+    dlen = ntruenc_pack_len(key->params->n, NTRU_FORMAT_11BITS);
+    data = malloc(dlen);
+    if (data == NULL)
+    {
+        ret = NTRU_ERR_ALLOC;
+        goto end;
+    }
+
+    ret = ntruenc_pack(key->h, key->params->n, NTRU_FORMAT_11BITS, data,
+        dlen);
+    if (ret != 0)
+        goto end;
+    ntru_shake256(id, len, data, dlen);
+end:
+    if (data != NULL) free(data);
+    return ret;
+}
+
+/**
+ * Write the public keys to a key store file.
+ * All keys must have the same parameters. Keys are stored unpacked and
+ * aligned to 64 bytes so that they can be used in place once mapped.
+ *
+ * @param [in] filename  The name of the file to write.
+ * @param [in] keys      The public keys.
+ * @param [in] ids       The identifiers of the keys: NTRU_KEY_ID_LEN bytes
+ *                       for each key. NULL to calculate them with
+ *                       NTRUENC_PUB_KEY_get_id().
+ * @param [in] cnt       The number of keys.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_BAD_LEN when there are no keys.<br>
+ *          NTRU_ERR_BAD_DATA when the keys have different parameters, a
+ *          key is NULL or has no value or identifiers are repeated.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate memory.<br>
+ *          NTRU_ERR_IO when the file cannot be written.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_STORE_write(const char *filename, NTRUENC_PUB_KEY **keys,
+    unsigned char *ids, int cnt)
+{
+    int ret = 0;
+    int i;
+    FILE *f = NULL;
+    NTRUENC_STORE_HDR hdr;
+    NTRUENC_STORE_ENTRY *index = NULL;
+    NTRUENC_STORE_ENTRY *e;
+    NTRUENC_PARAMS *params;
+    unsigned char id[NTRU_KEY_ID_LEN];
+    uint32_t mask, b;
+    size_t klen, pad;
+
+    if ((filename == NULL) || (keys == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (cnt <= 0)
+    {
+        ret = NTRU_ERR_BAD_LEN;
+        goto end;
+    }
+    if (keys[0] == NULL)
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+    params = keys[0]->params;
+    klen = params->n * sizeof(short);
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, NTRU_STORE_MAGIC, sizeof(hdr.magic));
+    hdr.version = NTRU_STORE_VERSION;
+    hdr.endian = NTRU_STORE_ENDIAN;
+    hdr.strength = params->strength;
+    hdr.n = params->n;
+    hdr.cnt = cnt;
+    /* At most half full so that searches are short and always end. */
+    for (hdr.buckets=1; hdr.buckets<2*(uint32_t)cnt; hdr.buckets<<=1)
+        ;
+    hdr.stride = NTRU_STORE_ALIGN_UP(klen);
+    hdr.index_off = NTRU_STORE_ALIGN_UP(sizeof(hdr));
+    hdr.keys_off = NTRU_STORE_ALIGN_UP(hdr.index_off +
+        hdr.buckets * sizeof(*index));
+
+    index = calloc(hdr.buckets, sizeof(*index));
+    if (index == NULL)
+    {
+        ret = NTRU_ERR_ALLOC;
+        goto end;
+    }
+
+    mask = hdr.buckets - 1;
+    for (i=0; i<cnt; i++)
+    {
+        if ((keys[i] == NULL) || (keys[i]->params != params) ||
+            (keys[i]->h == NULL))
+        {
+            ret = NTRU_ERR_BAD_DATA;
+            goto end;
+        }
+        if (ids != NULL)
+            memcpy(id, ids + i * NTRU_KEY_ID_LEN, sizeof(id));
+        else
+        {
+            ret = NTRUENC_PUB_KEY_get_id(keys[i], id, sizeof(id));
+            if (ret != 0)
+                goto end;
+        }
+
+        for (b=ntruenc_store_bucket(id, mask); index[b].idx!=0; b=(b+1)&mask)
+        {
+            if (memcmp(index[b].id, id, sizeof(id)) == 0)
+            {
+                ret = NTRU_ERR_BAD_DATA;
+                goto end;
+            }
+        }
+        e = &index[b];
+        memcpy(e->id, id, sizeof(id));
+        e->idx = i + 1;
+    }
+
+    f = fopen(filename, "wb");
+    if (f == NULL)
+    {
+        ret = NTRU_ERR_IO;
+        goto end;
+    }
+    pad = hdr.keys_off - hdr.index_off - hdr.buckets * sizeof(*index);
+    if ((fwrite(&hdr, sizeof(hdr), 1, f) != 1) ||
+        (fwrite(ntruenc_store_zero, 1, hdr.index_off - sizeof(hdr), f) !=
+         hdr.index_off - sizeof(hdr)) ||
+        (fwrite(index, sizeof(*index), hdr.buckets, f) != hdr.buckets) ||
+        (fwrite(ntruenc_store_zero, 1, pad, f) != pad))
+    {
+        ret = NTRU_ERR_IO;
+        goto end;
+    }
+    pad = hdr.stride - klen;
+    for (i=0; i<cnt; i++)
+    {
+        if ((fwrite(keys[i]->h, 1, klen, f) != klen) ||
+            (fwrite(ntruenc_store_zero, 1, pad, f) != pad))
+        {
+            ret = NTRU_ERR_IO;
+            goto end;
+        }
+    }
+end:
+    if ((f != NULL) && (fclose(f) != 0) && (ret == 0))
+        ret = NTRU_ERR_IO;
+    if (index != NULL) free(index);
+    return ret;
+}
+
+/**
+ * Check the header of a key store against the length of the file.
+ *
+ * @param [in] hdr  The header of the key store.
+ * @param [in] len  The length of the file in bytes.
+ * @return  1 when the header is valid.<br>
+ *          0 otherwise.
+ */
+static int ntruenc_store_hdr_valid(NTRUENC_STORE_HDR *hdr, size_t len)
+{
+    return (memcmp(hdr->magic, NTRU_STORE_MAGIC, sizeof(hdr->magic)) == 0) &&
+           (hdr->version == NTRU_STORE_VERSION) &&
+           (hdr->endian == NTRU_STORE_ENDIAN) &&
+           (hdr->buckets > hdr->cnt) &&
+           ((hdr->buckets & (hdr->buckets - 1)) == 0) &&
+           (hdr->stride >= hdr->n * sizeof(short)) &&
+           (hdr->stride % NTRU_STORE_ALIGN == 0) &&
+           (hdr->index_off % NTRU_STORE_ALIGN == 0) &&
+           (hdr->keys_off % NTRU_STORE_ALIGN == 0) &&
+           (hdr->index_off >= sizeof(*hdr)) &&
+           (hdr->index_off <= len) &&
+           (hdr->keys_off <= len) &&
+           (hdr->buckets <= (len - hdr->index_off) /
+                sizeof(NTRUENC_STORE_ENTRY)) &&
+           ((uint64_t)hdr->cnt * hdr->stride <= len - hdr->keys_off);
+}
+
+/**
+ * Open a key store file.
+ * The file is mapped into memory and the keys are not decoded.
+ *
+ * @param [in]  filename  The name of the key store file.
+ * @param [out] store     The open key store.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_IO when the file cannot be opened or mapped.<br>
+ *          NTRU_ERR_BAD_DATA when the file is not a valid key store.<br>
+ *          NTRU_ERR_NOT_FOUND when the parameters are not supported.<br>
+ *          NTRU_ERR_ALLOC on failure to allocate memory.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_STORE_open(const char *filename, NTRUENC_STORE **store)
+{
+    int ret = 0;
+    int fd = -1;
+    struct stat st;
+    unsigned char *map = MAP_FAILED;
+    size_t len = 0;
+    NTRUENC_STORE_HDR *hdr;
+    NTRUENC_PARAMS *params;
+    NTRUENC_STORE *s;
+
+    if ((filename == NULL) || (store == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    fd = open(filename, O_RDONLY);
+    if ((fd < 0) || (fstat(fd, &st) != 0))
+    {
+        ret = NTRU_ERR_IO;
+        goto end;
+    }
+    len = st.st_size;
+    if (len < sizeof(*hdr))
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+    map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        ret = NTRU_ERR_IO;
+        goto end;
+    }
+
+    hdr = (NTRUENC_STORE_HDR *)map;
+    if (!ntruenc_store_hdr_valid(hdr, len))
+    {
+        ret = NTRU_ERR_BAD_DATA;
+        goto end;
+    }
+    ret = NTRUENC_PARAMS_get(hdr->strength, &params);
+    if (ret != 0)
+        goto end;
+    if ((params->strength != hdr->strength) || (params->n != hdr->n))
+    {
+        ret = NTRU_ERR_NOT_FOUND;
+        goto end;
+    }
+
+    s = malloc(sizeof(*s));
+    if (s == NULL)
+    {
+        ret = NTRU_ERR_ALLOC;
+        goto end;
+    }
+    s->map = map;
+    s->len = len;
+    s->params = params;
+    s->cnt = hdr->cnt;
+    s->buckets = hdr->buckets;
+    s->stride = hdr->stride;
+    s->index = (NTRUENC_STORE_ENTRY *)(map + hdr->index_off);
+    s->keys = map + hdr->keys_off;
+
+    *store = s;
+    map = MAP_FAILED;
+end:
+    if (map != MAP_FAILED) munmap(map, len);
+    if (fd >= 0) close(fd);
+    return ret;
+}
+
+/**
+ * Close the key store.
+ * Public keys that are views of the store must not be used after closing.
+ *
+ * @param [in] store  The key store.
+ */
+void NTRUENC_STORE_close(NTRUENC_STORE *store)
+{
+    if (store != NULL)
+    {
+        munmap(store->map, store->len);
+        free(store);
+    }
+}
+
+/**
+ * Retrieves the parameters of the keys in the store.
+ *
+ * @param [in]  store   The key store.
+ * @param [out] params  The parameters of the keys.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_STORE_get_params(NTRUENC_STORE *store, NTRUENC_PARAMS **params)
+{
+    int ret = 0;
+
+    if ((store == NULL) || (params == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    *params = store->params;
+end:
+    return ret;
+}
+
+/**
+ * Retrieves the number of keys in the store.
+ *
+ * @param [in]  store  The key store.
+ * @param [out] cnt    The number of keys.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_STORE_num_keys(NTRUENC_STORE *store, int *cnt)
+{
+    int ret = 0;
+
+    if ((store == NULL) || (cnt == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+
+    *cnt = store->cnt;
+end:
+    return ret;
+}
+
+/**
+ * Look up a key in the store by identifier.
+ * The public key object becomes a view of the key in the mapped store - no
+ * memory is allocated and nothing is decoded. The key object can be reused
+ * for each look up.
+ * The padding after the key in the store must be zero as whole lanes are
+ * used in place.
+ *
+ * @param [in] store  The key store.
+ * @param [in] id     The key identifier.
+ * @param [in] len    The length of the identifier: NTRU_KEY_ID_LEN.
+ * @param [in] key    The public key object to set.
+ * @return  NTRU_ERR_PARAM_NULL when a parameter is NULL.<br>
+ *          NTRU_ERR_BAD_LEN when the identifier is the wrong length.<br>
+ *          NTRU_ERR_NOT_FOUND when no key has the identifier.<br>
+ *          NTRU_ERR_BAD_DATA when the index or key padding is corrupt.<br>
+ *          0 otherwise.
+ */
+int NTRUENC_STORE_get_key(NTRUENC_STORE *store, unsigned char *id, int len,
+    NTRUENC_PUB_KEY *key)
+{
+    int ret = NTRU_ERR_NOT_FOUND;
+    uint32_t i, b, mask;
+    NTRUENC_STORE_ENTRY *e;
+    unsigned char *k;
+    unsigned char z;
+    size_t j;
+
+    if ((store == NULL) || (id == NULL) || (key == NULL))
+    {
+        ret = NTRU_ERR_PARAM_NULL;
+        goto end;
+    }
+    if (len != NTRU_KEY_ID_LEN)
+    {
+        ret = NTRU_ERR_BAD_LEN;
+        goto end;
+    }
+
+    mask = store->buckets - 1;
+    b = ntruenc_store_bucket(id, mask);
+    for (i=0; i<store->buckets; i++,b=(b+1)&mask)
+    {
+        e = &store->index[b];
+        if (e->idx == 0)
+            break;
+        if (memcmp(e->id, id, NTRU_KEY_ID_LEN) != 0)
+            continue;
+
+        if (e->idx > store->cnt)
+        {
+            ret = NTRU_ERR_BAD_DATA;
+            goto end;
+        }
+        k = store->keys + (size_t)(e->idx - 1) * store->stride;
+        z = 0;
+        for (j=store->params->n*sizeof(short); j<store->stride; j++)
+            z |= k[j];
+        if (z != 0)
+        {
+            ret = NTRU_ERR_BAD_DATA;
+            goto end;
+        }
+        if ((!key->view) && (key->h != NULL))
+            free(key->h);
+        key->params = store->params;
+        key->h = (short *)k;
+        key->view = 1;
+        key->packed = NULL;
+        key->packed_len = 0;
+        ret = 0;
+        break;
+    }
+end:
+    return ret;
+}
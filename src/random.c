@@ -23,43 +23,332 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "random.h"
+#include "ntruenc_sha3.h"
+#include "ntruenc_aes.h"
 
 #ifdef OPT_NTRU_OPENSSL_RAND
 #include "openssl/rand.h"
-#else
-#include "ntruenc_sha3.h"
+#elif defined(OPT_NTRU_RDRAND)
+#include <immintrin.h>
+
+/** The number of times to retry RDRAND before giving up. */
+#define NTRU_RDRAND_RETRY	10
 #endif
 
+/** Incremented in the child process on each fork. */
+static volatile unsigned int ntru_fork_gen = 0;
+/** Ensures the fork handler is only registered once. */
+static pthread_once_t ntru_fork_once = PTHREAD_ONCE_INIT;
+
 /**
- * Fill the buffer with random bytes.
+ * Called in the child after a fork - forces all DRBGs to reseed.
+ */
+static void ntru_fork_child(void)
+{
+    ntru_fork_gen++;
+}
+
+/**
+ * Register the fork handler.
+ */
+static void ntru_fork_register(void)
+{
+    pthread_atfork(NULL, NULL, ntru_fork_child);
+}
+
+#if !defined(OPT_NTRU_OPENSSL_RAND) && defined(OPT_NTRU_RDRAND)
+/**
+ * Get 64 bits of entropy with RDRAND.
+ * RDRAND reports failure with the carry flag when no random value is ready
+ * and is retried a bounded number of times.
+ *
+ * @param [out] rd  The random value.
+ * @return  1 on success.<br>
+ *          0 when RDRAND keeps failing.
+ */
+__attribute__((target("rdrnd")))
+static int ntru_rdrand64(unsigned long long *rd)
+{
+    int i;
+
+    for (i=0; i<NTRU_RDRAND_RETRY; i++)
+    {
+        if (_rdrand64_step(rd))
+            return 1;
+    }
+    return 0;
+}
+#endif
+
+/**
+ * Fill the buffer with entropy from the system.
  *
  * @param [in] r  The buffer to fill.
  * @param [in] l  The length of the buffer in bytes.
- * @return  0 on success.<Br>
- *          1 when random data is not available.
+ * @return  0 on success.<br>
+ *          1 when entropy is not available.
  */
-int pseudo_random(unsigned char *r, int l)
+int ntru_entropy(unsigned char *r, int l)
 {
 #ifdef OPT_NTRU_OPENSSL_RAND
     return RAND_bytes(r, l) != 1;
-#else
-#ifdef OPT_NTRU_RDRAND
+#elif defined(OPT_NTRU_RDRAND)
     int i;
-    uint64_t rd[4];
-
-    for (i=0; i<4; i++)
-        asm volatile ("rdrand %0" : "=r" (rd[i]));
+    unsigned long long rd;
 
-    return ntru_shake256(r, l, (unsigned char *)rd, sizeof(rd)) == 0;
+    for (i=0; i<l; i+=8)
+    {
+        if (!ntru_rdrand64(&rd))
+            return 1;
+        memcpy(r+i, &rd, (l-i < 8) ? l-i : 8);
+    }
+    rd = 0;
+    return 0;
 #else
+    int fd;
     int i;
-    static uint64_t rd[4] = { 0, 0, 0, 0 };
-
-    for (i=0; i<4 && ++rd[i] == 0; i++) ;
+    ssize_t c;
 
-    return ntru_shake256(r, l, (unsigned char *)rd, sizeof(rd)) == 0;
+    fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0)
+        return 1;
+    for (i=0; i<l; i+=c)
+    {
+        c = read(fd, r+i, l-i);
+        /* Interrupted by a signal before reading anything - try again. */
+        if ((c < 0) && (errno == EINTR))
+        {
+            c = 0;
+            continue;
+        }
+        if (c <= 0)
+            break;
+    }
+    close(fd);
+    return i != l;
 #endif
+}
+
+/**
+ * Initialize the DRBG and seed from the entropy source.
+ *
+ * @param [in] drbg  The DRBG to initialize.
+ * @return  0 on success.<br>
+ *          1 when entropy is not available.
+ */
+int ntru_drbg_init(NTRU_DRBG *drbg)
+{
+    pthread_once(&ntru_fork_once, ntru_fork_register);
+
+    memset(drbg, 0, sizeof(*drbg));
+    drbg->flags = NTRU_DRBG_FLAGS_DEFAULT;
+#ifdef OPT_NTRU_DRBG_AES
+    /* Seeded DRBGs stay on SHAKE so output doesn't depend on the CPU. */
+    if (ntru_aes_ni_available())
+        drbg->flags |= NTRU_DRBG_FLAG_AES;
 #endif
+    return ntru_drbg_reseed(drbg);
+}
+
+/**
+ * Seed the DRBG with caller supplied data.
+ * The DRBG is deterministic and will not be reseeded from entropy.
+ * Output is always SHAKE-256 so that it doesn't depend on build options or
+ * the CPU.
+ *
+ * @param [in] drbg  The DRBG to seed.
+ * @param [in] seed  The seed data.
+ * @param [in] len   The length of the seed data in bytes.
+ * @return  0 on success.
+ */
+int ntru_drbg_seed(NTRU_DRBG *drbg, const unsigned char *seed, int len)
+{
+    memset(drbg, 0, sizeof(*drbg));
+    ntru_shake256(drbg->key, sizeof(drbg->key), seed, len);
+    drbg->pos = NTRU_DRBG_BUF_LEN;
+    drbg->flags = NTRU_DRBG_FLAG_DETERMINISTIC;
+    return 0;
 }
 
+/**
+ * Reseed the DRBG by mixing entropy into the key.
+ * Any buffered output is discarded.
+ *
+ * @param [in] drbg  The DRBG to reseed.
+ * @return  0 on success.<br>
+ *          1 when entropy is not available.
+ */
+int ntru_drbg_reseed(NTRU_DRBG *drbg)
+{
+    NTRU_SHAKE shake;
+    uint8_t e[NTRU_DRBG_KEY_LEN];
+
+    if (ntru_entropy(e, sizeof(e)) != 0)
+        return 1;
+    ntru_shake256_init(&shake);
+    ntru_shake_absorb(&shake, drbg->key, sizeof(drbg->key));
+    ntru_shake_absorb(&shake, e, sizeof(e));
+    ntru_shake_squeeze(&shake, drbg->key, sizeof(drbg->key));
+    memset(e, 0, sizeof(e));
+    memset(&shake, 0, sizeof(shake));
+
+    memset(drbg->buf, 0, sizeof(drbg->buf));
+    drbg->pos = NTRU_DRBG_BUF_LEN;
+    drbg->cnt = 0;
+    drbg->fork_gen = ntru_fork_gen;
+    return 0;
+}
+
+/**
+ * Refill the DRBG's buffer from SHAKE.
+ * The buffer is filled from multiple SHAKE-256, or TurboSHAKE128, streams of
+ * key || counter || stream index, computed in parallel when the CPU supports
+ * it.
+ *
+ * @param [in] drbg  The DRBG.
+ */
+static void ntru_drbg_refill_shake(NTRU_DRBG *drbg)
+{
+    int i;
+    uint8_t in[NTRU_DRBG_STREAMS][NTRU_DRBG_KEY_LEN+8+1];
+    const uint8_t *m[NTRU_DRBG_STREAMS];
+    uint8_t *h[NTRU_DRBG_STREAMS];
+
+    for (i=0; i<8; i++)
+        in[0][NTRU_DRBG_KEY_LEN+i] = drbg->cnt >> (8*i);
+    memcpy(in[0], drbg->key, NTRU_DRBG_KEY_LEN);
+    drbg->cnt++;
+    for (i=0; i<NTRU_DRBG_STREAMS; i++)
+    {
+        memcpy(in[i], in[0], NTRU_DRBG_KEY_LEN+8);
+        in[i][NTRU_DRBG_KEY_LEN+8] = i;
+        m[i] = in[i];
+        h[i] = drbg->buf + i * (NTRU_DRBG_BUF_LEN / NTRU_DRBG_STREAMS);
+    }
+
+    if (drbg->flags & NTRU_DRBG_FLAG_TURBOSHAKE)
+    {
+        ntru_turboshake128_x8(h, NTRU_DRBG_BUF_LEN / NTRU_DRBG_STREAMS, m,
+            sizeof(in[0]), 0x1f);
+    }
+    else
+    {
+        ntru_shake256_x8(h, NTRU_DRBG_BUF_LEN / NTRU_DRBG_STREAMS, m,
+            sizeof(in[0]));
+    }
+    memset(in, 0, sizeof(in));
+}
+
+/**
+ * Refill the DRBG's buffer.
+ * The first bytes of output become the next key so that earlier output can't
+ * be recalculated from the state.
+ *
+ * @param [in] drbg  The DRBG.
+ */
+static void ntru_drbg_refill(NTRU_DRBG *drbg)
+{
+    /* AES-256-CTR with the key and the counter as nonce. */
+    if ((drbg->flags & NTRU_DRBG_FLAG_AES) &&
+        ntru_aes256_ctr(drbg->buf, NTRU_DRBG_BUF_LEN / NTRU_AES_BLOCK_LEN,
+            drbg->key, drbg->cnt, 0))
+    {
+        drbg->cnt++;
+    }
+    else
+        ntru_drbg_refill_shake(drbg);
+
+    memcpy(drbg->key, drbg->buf, NTRU_DRBG_KEY_LEN);
+    memset(drbg->buf, 0, NTRU_DRBG_KEY_LEN);
+    drbg->pos = NTRU_DRBG_KEY_LEN;
+}
+
+/**
+ * Generate random bytes from the DRBG.
+ * Output is handed out from the buffer which is refilled in bulk when empty.
+ * Reseeds when the reseed interval is reached or the process has forked.
+ *
+ * @param [in] drbg  The DRBG.
+ * @param [in] r     The buffer to fill.
+ * @param [in] l     The length of the buffer in bytes.
+ * @return  0 on success.<br>
+ *          1 when reseeding failed.
+ */
+int ntru_drbg_generate(NTRU_DRBG *drbg, unsigned char *r, int l)
+{
+    int c;
+
+    if (((drbg->flags & NTRU_DRBG_FLAG_DETERMINISTIC) == 0) &&
+        (drbg->fork_gen != ntru_fork_gen))
+    {
+        if (ntru_drbg_reseed(drbg) != 0)
+            return 1;
+    }
+
+    while (l > 0)
+    {
+        if (drbg->pos == NTRU_DRBG_BUF_LEN)
+        {
+            if (((drbg->flags & NTRU_DRBG_FLAG_DETERMINISTIC) == 0) &&
+                (drbg->cnt >= NTRU_DRBG_RESEED_INTERVAL))
+            {
+                if (ntru_drbg_reseed(drbg) != 0)
+                    return 1;
+            }
+            ntru_drbg_refill(drbg);
+        }
+
+        c = NTRU_DRBG_BUF_LEN - drbg->pos;
+        if (c > l)
+            c = l;
+        /* Hand out and wipe the bytes so they can't be used again. */
+        memcpy(r, drbg->buf + drbg->pos, c);
+        memset(drbg->buf + drbg->pos, 0, c);
+        drbg->pos += c;
+        r += c;
+        l -= c;
+    }
+
+    return 0;
+}
+
+/**
+ * Dispose of the DRBG state.
+ *
+ * @param [in] drbg  The DRBG.
+ */
+void ntru_drbg_final(NTRU_DRBG *drbg)
+{
+    memset(drbg, 0, sizeof(*drbg));
+}
+
+/** DRBG used by pseudo_random() - one per thread. */
+static __thread NTRU_DRBG ntru_thread_drbg;
+/** Indicates whether the thread's DRBG has been seeded. */
+static __thread int ntru_thread_drbg_init = 0;
+
+/**
+ * Fill the buffer with random bytes.
+ * Uses a DRBG local to the calling thread.
+ *
+ * @param [in] r  The buffer to fill.
+ * @param [in] l  The length of the buffer in bytes.
+ * @return  0 on success.<Br>
+ *          1 when random data is not available.
+ */
+int pseudo_random(unsigned char *r, int l)
+{
+    if (!ntru_thread_drbg_init)
+    {
+        if (ntru_drbg_init(&ntru_thread_drbg) != 0)
+            return 1;
+        ntru_thread_drbg_init = 1;
+    }
+
+    return ntru_drbg_generate(&ntru_thread_drbg, r, l);
+}
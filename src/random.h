@@ -24,6 +24,64 @@
 #ifndef RANDOM_H
 #define RANDOM_H
 
+#include <stdint.h>
+
+/** The number of bytes in the secret key of a DRBG. */
+#define NTRU_DRBG_KEY_LEN		32
+/** The number of SHAKE-256 streams squeezed on refill: ntru_shake256_x8(). */
+#define NTRU_DRBG_STREAMS		8
+/**
+ * The number of bytes of output buffered by a DRBG.
+ * Each stream squeezes whole SHAKE-256 blocks.
+ */
+#define NTRU_DRBG_BUF_LEN		(136 * 4 * NTRU_DRBG_STREAMS)
+/** The number of buffer refills before reseeding from entropy. */
+#define NTRU_DRBG_RESEED_INTERVAL	(1 << 12)
+
+/** DRBG was seeded by caller - never reseed from the entropy source. */
+#define NTRU_DRBG_FLAG_DETERMINISTIC	0x01
+/** Output streams are TurboSHAKE128 (12 rounds) instead of SHAKE-256. */
+#define NTRU_DRBG_FLAG_TURBOSHAKE	0x02
+/** Output is AES-256-CTR key stream using AES-NI instead of SHAKE. */
+#define NTRU_DRBG_FLAG_AES		0x04
+
+#ifdef OPT_NTRU_DRBG_TURBOSHAKE
+/** Flags set on DRBGs seeded from entropy when initialized. */
+#define NTRU_DRBG_FLAGS_DEFAULT		NTRU_DRBG_FLAG_TURBOSHAKE
+#else
+/** Flags set on DRBGs seeded from entropy when initialized. */
+#define NTRU_DRBG_FLAGS_DEFAULT		0
+#endif
+
+/**
+ * Deterministic random bit generator.
+ * One is owned by each NTRU Encryption operation object and by each thread
+ * calling pseudo_random() so that no state is shared.
+ */
+typedef struct ntru_drbg_st
+{
+    /** Secret key hashed with the counter to produce output. */
+    uint8_t key[NTRU_DRBG_KEY_LEN];
+    /** The number of buffer refills since last (re)seed. */
+    uint64_t cnt;
+    /** Index of next unused byte in the buffer. */
+    int pos;
+    /** Squeezed output not yet handed out. */
+    uint8_t buf[NTRU_DRBG_BUF_LEN];
+    /** The fork generation when last (re)seeded. */
+    unsigned int fork_gen;
+    /** Flags describing how the DRBG was seeded. */
+    int flags;
+} NTRU_DRBG;
+
+int ntru_entropy(unsigned char *r, int l);
+
+int ntru_drbg_init(NTRU_DRBG *drbg);
+int ntru_drbg_seed(NTRU_DRBG *drbg, const unsigned char *seed, int len);
+int ntru_drbg_reseed(NTRU_DRBG *drbg);
+int ntru_drbg_generate(NTRU_DRBG *drbg, unsigned char *r, int l);
+void ntru_drbg_final(NTRU_DRBG *drbg);
+
 int pseudo_random(unsigned char *a, int len);
 
 #endif
@@ -0,0 +1,150 @@
+#!/usr/bin/ruby
+# Copyright (c) 2016 Sean Parkinson
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+
+require_relative '../../rubyasm/x86_asm.rb'
+
+# Generates the Keccak-p[1600, nr] permutation for x86_64.
+# The number of rounds, nr, is even and at most 24.
+#
+# The 25 lanes don't fit in the general purpose registers with the column
+# parities, so the state is read from memory and each round writes its output
+# to the other of two buffers: the state passed in and a copy on the stack.
+# The column parities, the theta values and a row of lanes are kept in
+# registers. The chi step uses ANDN (BMI1) and theta uses RORX (BMI2).
+class NTRUENC_Keccak
+
+  # Rotation amounts of lanes by x then y.
+  ROT = [[ 0, 36,  3, 41, 18],
+         [ 1, 44, 10, 45,  2],
+         [62,  6, 43, 15, 61],
+         [28, 55, 25, 21, 56],
+         [27, 20, 39,  8, 14]]
+
+  # Round constants of the iota step.
+  RC = [0x0000000000000001, 0x0000000000008082,
+        0x800000000000808a, 0x8000000080008000,
+        0x000000000000808b, 0x0000000080000001,
+        0x8000000080008081, 0x8000000000008009,
+        0x000000000000008a, 0x0000000000000088,
+        0x0000000080008009, 0x000000008000000a,
+        0x000000008000808b, 0x800000000000008b,
+        0x8000000000008089, 0x8000000000008003,
+        0x8000000000008002, 0x8000000000000080,
+        0x000000000000800a, 0x800000008000000a,
+        0x8000000080008081, 0x8000000000008080,
+        0x0000000080000001, 0x8000000080008008]
+
+  def initialize(asm)
+    @asm = asm
+  end
+
+  # Write out one round reading from a and writing to e.
+  # rc is the memory operand of the round constant.
+  def write_round(a, e, rc)
+    asm = @asm
+
+    asm.comment "Theta: column parities"
+    0.upto(4) do |x|
+      asm.movq a[x], @c[x]
+      1.upto(4) do |y|
+        asm.xorq a[x+5*y], @c[x]
+      end
+    end
+    asm.comment "Theta: values to XOR into columns"
+    0.upto(4) do |x|
+      asm.rorxq 63, @c[(x+1)%5], @d[x]
+      asm.xorq @c[(x+4)%5], @d[x]
+    end
+    b = @c
+    t = @t
+    0.upto(4) do |y|
+      asm.comment "Rho and Pi: row #{y}"
+      0.upto(4) do |x|
+        # Lane (x, y) of B comes from lane (sx, sy) of A.
+        sx = (x + 3*y) % 5
+        sy = x
+        asm.movq a[sx+5*sy], b[x]
+        asm.xorq @d[sx], b[x]
+        r = ROT[sx][sy]
+        asm.rolq r, b[x] if r != 0
+      end
+      asm.comment "Chi: row #{y}"
+      0.upto(4) do |x|
+        asm.andnq b[(x+2)%5], b[(x+1)%5], t
+        asm.xorq b[x], t
+        asm.xorq rc, t if x == 0 && y == 0
+        asm.movq t, e[x+5*y]
+      end
+    end
+  end
+
+  def write_block()
+    asm = @asm
+    name = "ntru_keccak_block_asm"
+
+    asm.file "ntruenc_keccak_x86_64.s"
+
+    asm.start_rodata()
+    asm.set_const("keccak_rc")
+    RC.each { |v| asm.set_quad("0x%016x" % v) }
+    asm.set_const("keccak_rc_end")
+
+    asm.func name, 13, 0, 200
+    regs = asm.gr(13)
+    @c = regs[0..4]
+    @d = regs[5..9]
+    @t = regs[10]
+    rcp = regs[11]
+    cnt = regs[12]
+    s = asm.param_reg(0)
+    tmp = asm.stack_p
+
+    nr = asm.param_reg(1)
+
+    asm.comment "Start at round constant 24-nr and perform nr/2 iterations"
+    asm.movl nr.r32, cnt.r32
+    asm.shlq 3, cnt
+    asm.leaq asm.const("keccak_rc_end"), rcp
+    asm.subq cnt, rcp
+    asm.shrq 4, cnt
+    loop = asm.set_label("keccak_loop")
+    write_round(s, tmp, rcp[0])
+    write_round(tmp, s, rcp[1])
+    asm.addq 16, rcp
+    asm.subq 1, cnt
+    asm.jnz loop
+    asm.func_done
+    asm.file_done
+  end
+end
+
+case ARGV[0]
+when "gcc", nil
+  asm = GCC_X86_64.new
+when "macosx"
+  asm = MacOSX_X86_64.new
+else
+  throw "Invalid assembler: #{ARGV[0]} (gcc|macosx)"
+end
+
+keccak = NTRUENC_Keccak.new(asm)
+keccak.write_block()
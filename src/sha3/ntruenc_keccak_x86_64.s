@@ -0,0 +1,476 @@
+# Copyright (c) 2016 Sean Parkinson
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+
+	.file	"ntruenc_keccak_x86_64.s"
+	.section	.rodata
+	.align 64
+.Lconst_keccak_rc:
+	.quad 0x0000000000000001
+	.quad 0x0000000000008082
+	.quad 0x800000000000808a
+	.quad 0x8000000080008000
+	.quad 0x000000000000808b
+	.quad 0x0000000080000001
+	.quad 0x8000000080008081
+	.quad 0x8000000000008009
+	.quad 0x000000000000008a
+	.quad 0x0000000000000088
+	.quad 0x0000000080008009
+	.quad 0x000000008000000a
+	.quad 0x000000008000808b
+	.quad 0x800000000000008b
+	.quad 0x8000000000008089
+	.quad 0x8000000000008003
+	.quad 0x8000000000008002
+	.quad 0x8000000000000080
+	.quad 0x000000000000800a
+	.quad 0x800000008000000a
+	.quad 0x8000000080008081
+	.quad 0x8000000000008080
+	.quad 0x0000000080000001
+	.quad 0x8000000080008008
+.Lconst_keccak_rc_end:
+	.text
+	.p2align 4,,15
+	.globl	ntru_keccak_block_asm
+	.type	ntru_keccak_block_asm, @function
+ntru_keccak_block_asm:
+	pushq	%rbx
+	pushq	%r12
+	pushq	%r13
+	pushq	%r14
+	pushq	%r15
+	pushq	%rbp
+	subq	$200, %rsp
+	# Start at round constant 24-nr and perform nr/2 iterations
+	movl	%esi, %ebp
+	shlq	$3, %rbp
+	leaq	.Lconst_keccak_rc_end(%rip), %r15
+	subq	%rbp, %r15
+	shrq	$4, %rbp
+.Lkeccak_loop:
+	# Theta: column parities
+	movq	(%rdi), %rax
+	xorq	40(%rdi), %rax
+	xorq	80(%rdi), %rax
+	xorq	120(%rdi), %rax
+	xorq	160(%rdi), %rax
+	movq	8(%rdi), %rcx
+	xorq	48(%rdi), %rcx
+	xorq	88(%rdi), %rcx
+	xorq	128(%rdi), %rcx
+	xorq	168(%rdi), %rcx
+	movq	16(%rdi), %rdx
+	xorq	56(%rdi), %rdx
+	xorq	96(%rdi), %rdx
+	xorq	136(%rdi), %rdx
+	xorq	176(%rdi), %rdx
+	movq	24(%rdi), %r8
+	xorq	64(%rdi), %r8
+	xorq	104(%rdi), %r8
+	xorq	144(%rdi), %r8
+	xorq	184(%rdi), %r8
+	movq	32(%rdi), %r9
+	xorq	72(%rdi), %r9
+	xorq	112(%rdi), %r9
+	xorq	152(%rdi), %r9
+	xorq	192(%rdi), %r9
+	# Theta: values to XOR into columns
+	rorxq	$63, %rcx, %r10
+	xorq	%r9, %r10
+	rorxq	$63, %rdx, %r11
+	xorq	%rax, %r11
+	rorxq	$63, %r8, %rbx
+	xorq	%rcx, %rbx
+	rorxq	$63, %r9, %r12
+	xorq	%rdx, %r12
+	rorxq	$63, %rax, %r13
+	xorq	%r8, %r13
+	# Rho and Pi: row 0
+	movq	(%rdi), %rax
+	xorq	%r10, %rax
+	movq	48(%rdi), %rcx
+	xorq	%r11, %rcx
+	rolq	$44, %rcx
+	movq	96(%rdi), %rdx
+	xorq	%rbx, %rdx
+	rolq	$43, %rdx
+	movq	144(%rdi), %r8
+	xorq	%r12, %r8
+	rolq	$21, %r8
+	movq	192(%rdi), %r9
+	xorq	%r13, %r9
+	rolq	$14, %r9
+	# Chi: row 0
+	andnq	%rdx, %rcx, %r14
+	xorq	%rax, %r14
+	xorq	(%r15), %r14
+	movq	%r14, (%rsp)
+	andnq	%r8, %rdx, %r14
+	xorq	%rcx, %r14
+	movq	%r14, 8(%rsp)
+	andnq	%r9, %r8, %r14
+	xorq	%rdx, %r14
+	movq	%r14, 16(%rsp)
+	andnq	%rax, %r9, %r14
+	xorq	%r8, %r14
+	movq	%r14, 24(%rsp)
+	andnq	%rcx, %rax, %r14
+	xorq	%r9, %r14
+	movq	%r14, 32(%rsp)
+	# Rho and Pi: row 1
+	movq	24(%rdi), %rax
+	xorq	%r12, %rax
+	rolq	$28, %rax
+	movq	72(%rdi), %rcx
+	xorq	%r13, %rcx
+	rolq	$20, %rcx
+	movq	80(%rdi), %rdx
+	xorq	%r10, %rdx
+	rolq	$3, %rdx
+	movq	128(%rdi), %r8
+	xorq	%r11, %r8
+	rolq	$45, %r8
+	movq	176(%rdi), %r9
+	xorq	%rbx, %r9
+	rolq	$61, %r9
+	# Chi: row 1
+	andnq	%rdx, %rcx, %r14
+	xorq	%rax, %r14
+	movq	%r14, 40(%rsp)
+	andnq	%r8, %rdx, %r14
+	xorq	%rcx, %r14
+	movq	%r14, 48(%rsp)
+	andnq	%r9, %r8, %r14
+	xorq	%rdx, %r14
+	movq	%r14, 56(%rsp)
+	andnq	%rax, %r9, %r14
+	xorq	%r8, %r14
+	movq	%r14, 64(%rsp)
+	andnq	%rcx, %rax, %r14
+	xorq	%r9, %r14
+	movq	%r14, 72(%rsp)
+	# Rho and Pi: row 2
+	movq	8(%rdi), %rax
+	xorq	%r11, %rax
+	rolq	$1, %rax
+	movq	56(%rdi), %rcx
+	xorq	%rbx, %rcx
+	rolq	$6, %rcx
+	movq	104(%rdi), %rdx
+	xorq	%r12, %rdx
+	rolq	$25, %rdx
+	movq	152(%rdi), %r8
+	xorq	%r13, %r8
+	rolq	$8, %r8
+	movq	160(%rdi), %r9
+	xorq	%r10, %r9
+	rolq	$18, %r9
+	# Chi: row 2
+	andnq	%rdx, %rcx, %r14
+	xorq	%rax, %r14
+	movq	%r14, 80(%rsp)
+	andnq	%r8, %rdx, %r14
+	xorq	%rcx, %r14
+	movq	%r14, 88(%rsp)
+	andnq	%r9, %r8, %r14
+	xorq	%rdx, %r14
+	movq	%r14, 96(%rsp)
+	andnq	%rax, %r9, %r14
+	xorq	%r8, %r14
+	movq	%r14, 104(%rsp)
+	andnq	%rcx, %rax, %r14
+	xorq	%r9, %r14
+	movq	%r14, 112(%rsp)
+	# Rho and Pi: row 3
+	movq	32(%rdi), %rax
+	xorq	%r13, %rax
+	rolq	$27, %rax
+	movq	40(%rdi), %rcx
+	xorq	%r10, %rcx
+	rolq	$36, %rcx
+	movq	88(%rdi), %rdx
+	xorq	%r11, %rdx
+	rolq	$10, %rdx
+	movq	136(%rdi), %r8
+	xorq	%rbx, %r8
+	rolq	$15, %r8
+	movq	184(%rdi), %r9
+	xorq	%r12, %r9
+	rolq	$56, %r9
+	# Chi: row 3
+	andnq	%rdx, %rcx, %r14
+	xorq	%rax, %r14
+	movq	%r14, 120(%rsp)
+	andnq	%r8, %rdx, %r14
+	xorq	%rcx, %r14
+	movq	%r14, 128(%rsp)
+	andnq	%r9, %r8, %r14
+	xorq	%rdx, %r14
+	movq	%r14, 136(%rsp)
+	andnq	%rax, %r9, %r14
+	xorq	%r8, %r14
+	movq	%r14, 144(%rsp)
+	andnq	%rcx, %rax, %r14
+	xorq	%r9, %r14
+	movq	%r14, 152(%rsp)
+	# Rho and Pi: row 4
+	movq	16(%rdi), %rax
+	xorq	%rbx, %rax
+	rolq	$62, %rax
+	movq	64(%rdi), %rcx
+	xorq	%r12, %rcx
+	rolq	$55, %rcx
+	movq	112(%rdi), %rdx
+	xorq	%r13, %rdx
+	rolq	$39, %rdx
+	movq	120(%rdi), %r8
+	xorq	%r10, %r8
+	rolq	$41, %r8
+	movq	168(%rdi), %r9
+	xorq	%r11, %r9
+	rolq	$2, %r9
+	# Chi: row 4
+	andnq	%rdx, %rcx, %r14
+	xorq	%rax, %r14
+	movq	%r14, 160(%rsp)
+	andnq	%r8, %rdx, %r14
+	xorq	%rcx, %r14
+	movq	%r14, 168(%rsp)
+	andnq	%r9, %r8, %r14
+	xorq	%rdx, %r14
+	movq	%r14, 176(%rsp)
+	andnq	%rax, %r9, %r14
+	xorq	%r8, %r14
+	movq	%r14, 184(%rsp)
+	andnq	%rcx, %rax, %r14
+	xorq	%r9, %r14
+	movq	%r14, 192(%rsp)
+	# Theta: column parities
+	movq	(%rsp), %rax
+	xorq	40(%rsp), %rax
+	xorq	80(%rsp), %rax
+	xorq	120(%rsp), %rax
+	xorq	160(%rsp), %rax
+	movq	8(%rsp), %rcx
+	xorq	48(%rsp), %rcx
+	xorq	88(%rsp), %rcx
+	xorq	128(%rsp), %rcx
+	xorq	168(%rsp), %rcx
+	movq	16(%rsp), %rdx
+	xorq	56(%rsp), %rdx
+	xorq	96(%rsp), %rdx
+	xorq	136(%rsp), %rdx
+	xorq	176(%rsp), %rdx
+	movq	24(%rsp), %r8
+	xorq	64(%rsp), %r8
+	xorq	104(%rsp), %r8
+	xorq	144(%rsp), %r8
+	xorq	184(%rsp), %r8
+	movq	32(%rsp), %r9
+	xorq	72(%rsp), %r9
+	xorq	112(%rsp), %r9
+	xorq	152(%rsp), %r9
+	xorq	192(%rsp), %r9
+	# Theta: values to XOR into columns
+	rorxq	$63, %rcx, %r10
+	xorq	%r9, %r10
+	rorxq	$63, %rdx, %r11
+	xorq	%rax, %r11
+	rorxq	$63, %r8, %rbx
+	xorq	%rcx, %rbx
+	rorxq	$63, %r9, %r12
+	xorq	%rdx, %r12
+	rorxq	$63, %rax, %r13
+	xorq	%r8, %r13
+	# Rho and Pi: row 0
+	movq	(%rsp), %rax
+	xorq	%r10, %rax
+	movq	48(%rsp), %rcx
+	xorq	%r11, %rcx
+	rolq	$44, %rcx
+	movq	96(%rsp), %rdx
+	xorq	%rbx, %rdx
+	rolq	$43, %rdx
+	movq	144(%rsp), %r8
+	xorq	%r12, %r8
+	rolq	$21, %r8
+	movq	192(%rsp), %r9
+	xorq	%r13, %r9
+	rolq	$14, %r9
+	# Chi: row 0
+	andnq	%rdx, %rcx, %r14
+	xorq	%rax, %r14
+	xorq	8(%r15), %r14
+	movq	%r14, (%rdi)
+	andnq	%r8, %rdx, %r14
+	xorq	%rcx, %r14
+	movq	%r14, 8(%rdi)
+	andnq	%r9, %r8, %r14
+	xorq	%rdx, %r14
+	movq	%r14, 16(%rdi)
+	andnq	%rax, %r9, %r14
+	xorq	%r8, %r14
+	movq	%r14, 24(%rdi)
+	andnq	%rcx, %rax, %r14
+	xorq	%r9, %r14
+	movq	%r14, 32(%rdi)
+	# Rho and Pi: row 1
+	movq	24(%rsp), %rax
+	xorq	%r12, %rax
+	rolq	$28, %rax
+	movq	72(%rsp), %rcx
+	xorq	%r13, %rcx
+	rolq	$20, %rcx
+	movq	80(%rsp), %rdx
+	xorq	%r10, %rdx
+	rolq	$3, %rdx
+	movq	128(%rsp), %r8
+	xorq	%r11, %r8
+	rolq	$45, %r8
+	movq	176(%rsp), %r9
+	xorq	%rbx, %r9
+	rolq	$61, %r9
+	# Chi: row 1
+	andnq	%rdx, %rcx, %r14
+	xorq	%rax, %r14
+	movq	%r14, 40(%rdi)
+	andnq	%r8, %rdx, %r14
+	xorq	%rcx, %r14
+	movq	%r14, 48(%rdi)
+	andnq	%r9, %r8, %r14
+	xorq	%rdx, %r14
+	movq	%r14, 56(%rdi)
+	andnq	%rax, %r9, %r14
+	xorq	%r8, %r14
+	movq	%r14, 64(%rdi)
+	andnq	%rcx, %rax, %r14
+	xorq	%r9, %r14
+	movq	%r14, 72(%rdi)
+	# Rho and Pi: row 2
+	movq	8(%rsp), %rax
+	xorq	%r11, %rax
+	rolq	$1, %rax
+	movq	56(%rsp), %rcx
+	xorq	%rbx, %rcx
+	rolq	$6, %rcx
+	movq	104(%rsp), %rdx
+	xorq	%r12, %rdx
+	rolq	$25, %rdx
+	movq	152(%rsp), %r8
+	xorq	%r13, %r8
+	rolq	$8, %r8
+	movq	160(%rsp), %r9
+	xorq	%r10, %r9
+	rolq	$18, %r9
+	# Chi: row 2
+	andnq	%rdx, %rcx, %r14
+	xorq	%rax, %r14
+	movq	%r14, 80(%rdi)
+	andnq	%r8, %rdx, %r14
+	xorq	%rcx, %r14
+	movq	%r14, 88(%rdi)
+	andnq	%r9, %r8, %r14
+	xorq	%rdx, %r14
+	movq	%r14, 96(%rdi)
+	andnq	%rax, %r9, %r14
+	xorq	%r8, %r14
+	movq	%r14, 104(%rdi)
+	andnq	%rcx, %rax, %r14
+	xorq	%r9, %r14
+	movq	%r14, 112(%rdi)
+	# Rho and Pi: row 3
+	movq	32(%rsp), %rax
+	xorq	%r13, %rax
+	rolq	$27, %rax
+	movq	40(%rsp), %rcx
+	xorq	%r10, %rcx
+	rolq	$36, %rcx
+	movq	88(%rsp), %rdx
+	xorq	%r11, %rdx
+	rolq	$10, %rdx
+	movq	136(%rsp), %r8
+	xorq	%rbx, %r8
+	rolq	$15, %r8
+	movq	184(%rsp), %r9
+	xorq	%r12, %r9
+	rolq	$56, %r9
+	# Chi: row 3
+	andnq	%rdx, %rcx, %r14
+	xorq	%rax, %r14
+	movq	%r14, 120(%rdi)
+	andnq	%r8, %rdx, %r14
+	xorq	%rcx, %r14
+	movq	%r14, 128(%rdi)
+	andnq	%r9, %r8, %r14
+	xorq	%rdx, %r14
+	movq	%r14, 136(%rdi)
+	andnq	%rax, %r9, %r14
+	xorq	%r8, %r14
+	movq	%r14, 144(%rdi)
+	andnq	%rcx, %rax, %r14
+	xorq	%r9, %r14
+	movq	%r14, 152(%rdi)
+	# Rho and Pi: row 4
+	movq	16(%rsp), %rax
+	xorq	%rbx, %rax
+	rolq	$62, %rax
+	movq	64(%rsp), %rcx
+	xorq	%r12, %rcx
+	rolq	$55, %rcx
+	movq	112(%rsp), %rdx
+	xorq	%r13, %rdx
+	rolq	$39, %rdx
+	movq	120(%rsp), %r8
+	xorq	%r10, %r8
+	rolq	$41, %r8
+	movq	168(%rsp), %r9
+	xorq	%r11, %r9
+	rolq	$2, %r9
+	# Chi: row 4
+	andnq	%rdx, %rcx, %r14
+	xorq	%rax, %r14
+	movq	%r14, 160(%rdi)
+	andnq	%r8, %rdx, %r14
+	xorq	%rcx, %r14
+	movq	%r14, 168(%rdi)
+	andnq	%r9, %r8, %r14
+	xorq	%rdx, %r14
+	movq	%r14, 176(%rdi)
+	andnq	%rax, %r9, %r14
+	xorq	%r8, %r14
+	movq	%r14, 184(%rdi)
+	andnq	%rcx, %rax, %r14
+	xorq	%r9, %r14
+	movq	%r14, 192(%rdi)
+	addq	$16, %r15
+	subq	$1, %rbp
+	jnz	.Lkeccak_loop
+	addq	$200, %rsp
+	popq	%rbp
+	popq	%r15
+	popq	%r14
+	popq	%r13
+	popq	%r12
+	popq	%rbx
+	ret
+	.size	ntru_keccak_block_asm, .-ntru_keccak_block_asm
+	.section	.note.GNU-stack,"",@progbits
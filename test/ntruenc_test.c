@@ -25,10 +25,15 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <string.h>
+#include <pthread.h>
+#include <sys/wait.h>
 
 #include "ntruenc.h"
-#include "ntruenc_key_lcl.h"
+#include "ntruenc_store.h"
+#include "ntruenc_lcl.h"
 #include "random.h"
+#include "ntruenc_sha3.h"
+#include "ntruenc_aes.h"
 
 #ifdef CC_CLANG
 #define PRIu64 "llu"
@@ -44,6 +49,92 @@ static int valid[] = {112, 128, 192, 256};
 /* Number of cycles/sec. */
 uint64_t cps = 0;
 
+#ifdef NTRUENC_STATIC
+/*
+ * The library doesn't allocate memory in the static profile.
+ * The test provides the storage of the objects instead.
+ */
+static int test_ntruenc_new(int strength, int flags, NTRUENC **ne)
+{
+    int ret;
+    NTRUENC *n;
+
+    n = malloc(NTRUENC_get_obj_size());
+    if (n == NULL)
+        return NTRU_ERR_ALLOC;
+    ret = NTRUENC_init(n, strength, flags);
+    if (ret != 0)
+    {
+        NTRUENC_final(n);
+        free(n);
+        return ret;
+    }
+    *ne = n;
+    return 0;
+}
+
+static void test_ntruenc_free(NTRUENC *ne)
+{
+    NTRUENC_final(ne);
+    free(ne);
+}
+
+static int test_priv_key_new(NTRUENC_PARAMS *params, NTRUENC_PRIV_KEY **key)
+{
+    int ret;
+    NTRUENC_PRIV_KEY *k;
+
+    k = malloc(NTRUENC_PRIV_KEY_get_obj_size());
+    if (k == NULL)
+        return NTRU_ERR_ALLOC;
+    ret = NTRUENC_PRIV_KEY_init(k, params);
+    if (ret != 0)
+    {
+        free(k);
+        return ret;
+    }
+    *key = k;
+    return 0;
+}
+
+static void test_priv_key_free(NTRUENC_PRIV_KEY *key)
+{
+    NTRUENC_PRIV_KEY_final(key);
+    free(key);
+}
+
+static int test_pub_key_new(NTRUENC_PARAMS *params, NTRUENC_PUB_KEY **key)
+{
+    int ret;
+    NTRUENC_PUB_KEY *k;
+
+    k = malloc(NTRUENC_PUB_KEY_get_obj_size());
+    if (k == NULL)
+        return NTRU_ERR_ALLOC;
+    ret = NTRUENC_PUB_KEY_init(k, params);
+    if (ret != 0)
+    {
+        free(k);
+        return ret;
+    }
+    *key = k;
+    return 0;
+}
+
+static void test_pub_key_free(NTRUENC_PUB_KEY *key)
+{
+    NTRUENC_PUB_KEY_final(key);
+    free(key);
+}
+
+#define NTRUENC_new		test_ntruenc_new
+#define NTRUENC_free		test_ntruenc_free
+#define NTRUENC_PRIV_KEY_new	test_priv_key_new
+#define NTRUENC_PRIV_KEY_free	test_priv_key_free
+#define NTRUENC_PUB_KEY_new	test_pub_key_new
+#define NTRUENC_PUB_KEY_free	test_pub_key_free
+#endif
+
 /*
  * Get the current cycle count from the CPU.
  *
@@ -53,174 +144,2112 @@ uint64_t get_cycles()
 {
     unsigned int hi, lo;
 
-    asm volatile ("rdtsc\n\t" : "=a" (lo), "=d"(hi));
-    return ((uint64_t)lo) | (((uint64_t)hi) << 32);
+    asm volatile ("rdtsc\n\t" : "=a" (lo), "=d"(hi));
+    return ((uint64_t)lo) | (((uint64_t)hi) << 32);
+}
+
+/*
+ * Calculate the number of cycles/second.
+ */
+void calc_cps()
+{
+    uint64_t end, start = get_cycles();
+    sleep(1);
+    end = get_cycles();
+    cps = end-start;
+    printf("Cycles/sec: %"PRIu64"\n", cps);
+}
+
+/*
+ * Determine the number of encryption operations that can be performed per
+ * second.
+ *
+ * @param [in] ne       The NTRU Encryption operation object.
+ * @param [in] data     The message or key data.
+ * @param [in] len      The length of the message or key data.
+ * @param [in] pub_key  The public key.
+ */
+void enc_cycles(NTRUENC *ne, unsigned char *data, int len,
+    NTRUENC_PUB_KEY *pub_key)
+{
+    int i;
+    uint64_t start, end, diff;
+    int num_ops;
+    unsigned char *enc;
+    int elen;
+
+    NTRUENC_PUB_KEY_get_enc_len(pub_key, &elen);
+    enc = malloc(elen);
+
+    NTRUENC_encrypt_init(ne, pub_key);
+
+    /* Prime the caches, etc */
+    for (i=0; i<200; i++)
+        NTRUENC_encrypt(ne, data, len, enc, elen);
+
+    /* Approximate number of ops in a second. */
+    start = get_cycles();
+    for (i=0; i<100; i++)
+        NTRUENC_encrypt(ne, data, len, enc, elen);
+    end = get_cycles();
+    num_ops = cps/((end-start)/100);
+
+    /* Perform about 1 seconds worth of operations. */
+    start = get_cycles();
+    for (i=0; i<num_ops; i++)
+        NTRUENC_encrypt(ne, data, len, enc, elen);
+    end = get_cycles();
+
+    diff = end - start;
+
+    printf("enc: %7d %2.3f  %7"PRIu64" %6"PRIu64"\n", num_ops, diff/(cps*1.0),
+        diff/num_ops, cps/(diff/num_ops));
+
+    NTRUENC_encrypt_final(ne);
+
+    free(enc);
+}
+
+/*
+ * Determine the number of decryption operations that can be performed per
+ * second.
+ *
+ * @param [in] ne        The NTRU Encryption operation object.
+ * @param [in] enc       Encrypted data.
+ * @param [in] elen      The length of the encrypted data.
+ * @param [in] priv_key  The private key.
+ */
+void dec_cycles(NTRUENC *ne, unsigned char *enc, int elen,
+    NTRUENC_PRIV_KEY *priv_key)
+{
+    int i;
+    uint64_t start, end, diff;
+    int num_ops;
+    unsigned char *dec;
+    int len;
+    int olen;
+    int n;
+
+    NTRUENC_PRIV_KEY_num_entries(priv_key, &n);
+    len = (n + 7) / 8;
+    dec = malloc(len);
+
+    NTRUENC_decrypt_init(ne, priv_key);
+
+    /* Prime the caches, etc */
+    for (i=0; i<200; i++)
+        NTRUENC_decrypt(ne, enc, elen, dec, len, &olen);
+
+    /* Approximate number of ops in a second. */
+    start = get_cycles();
+    for (i=0; i<100; i++)
+        NTRUENC_decrypt(ne, enc, elen, dec, len, &olen);
+    end = get_cycles();
+    num_ops = cps/((end-start)/100);
+
+    /* Perform about 1 seconds worth of operations. */
+    start = get_cycles();
+    for (i=0; i<num_ops; i++)
+        NTRUENC_decrypt(ne, enc, elen, dec, len, &olen);
+    end = get_cycles();
+
+    diff = end - start;
+
+    printf("dec: %7d %2.3f  %7"PRIu64" %6"PRIu64"\n", num_ops, diff/(cps*1.0),
+        diff/num_ops, cps/(diff/num_ops));
+
+    NTRUENC_decrypt_final(ne);
+
+    free(dec);
+}
+
+/*
+ * Determine the number of key generation operations that can be performed per
+ * second.
+ *
+ * @param [in] priv_key  The public key.
+ * @param [in] pub_key   The public key.
+ */
+void keygen_cycles(NTRUENC *ne, NTRUENC_PARAMS *params,
+    NTRUENC_PRIV_KEY *priv_key, NTRUENC_PUB_KEY *pub_key)
+{
+    int i;
+    uint64_t start, end, diff;
+    int num_ops;
+
+    NTRUENC_keygen_init(ne, params);
+    /* Prime the caches, etc */
+    for (i=0; i<100; i++)
+        NTRUENC_keygen(ne, &priv_key, &pub_key);
+
+    /* Approximate number of ops in a second. */
+    start = get_cycles();
+    for (i=0; i<100; i++)
+        NTRUENC_keygen(ne, &priv_key, &pub_key);
+    end = get_cycles();
+    num_ops = cps/((end-start)/100);
+
+    /* Perform about 1 seconds worth of operations. */
+    start = get_cycles();
+    for (i=0; i<num_ops; i++)
+        NTRUENC_keygen(ne, &priv_key, &pub_key);
+    end = get_cycles();
+
+    diff = end - start;
+
+    printf("kgn: %7d %2.3f  %7"PRIu64" %6"PRIu64"\n", num_ops, diff/(cps*1.0),
+        diff/num_ops, cps/(diff/num_ops));
+
+    NTRUENC_keygen_final(ne);
+}
+
+/*
+ * Generate a random vector as the hash.
+ *
+ * @param [in] msg       The message buffer.
+ * @param [in] len       The length of the buffer.
+ */
+int random_data(unsigned char *msg, int len)
+{
+    return pseudo_random(msg, len);
+}
+
+/*
+ * Test that seeded key generation and encryption are deterministic and
+ * that a private key stored as a seed decrypts.
+ *
+ * @param [in] ne      The NTRU Encryption operation object.
+ * @param [in] params  The NTRU encryption parameters.
+ * @param [in] data    The message or key data.
+ * @param [in] len     The length of the message or key data.
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntruenc_seeded(NTRUENC *ne, NTRUENC_PARAMS *params,
+    unsigned char *data, int len)
+{
+    int ret;
+    int i;
+    unsigned char seed[NTRU_KEY_SEED_LEN];
+    unsigned char priv_seed[1 + NTRU_KEY_SEED_LEN + 1];
+    NTRUENC_PRIV_KEY *priv_key[2] = { NULL, NULL };
+    NTRUENC_PUB_KEY *pub_key[2] = { NULL, NULL };
+    unsigned char *pub[2] = { NULL, NULL };
+    unsigned char *enc[2] = { NULL, NULL };
+    unsigned char *dec = NULL;
+    int pub_len, elen, olen;
+
+    for (i=0; i<(int)sizeof(seed); i++)
+        seed[i] = i;
+
+#ifdef NTRUENC_STATIC
+    /* Keys are not created by key generation. */
+    for (i=0; i<2; i++)
+    {
+        ret = NTRUENC_PRIV_KEY_new(params, &priv_key[i]);
+        if (ret == 0)
+            ret = NTRUENC_PUB_KEY_new(params, &pub_key[i]);
+        if (ret != 0)
+            goto end;
+    }
+#endif
+    ret = NTRUENC_keygen_init(ne, params);
+    if (ret != 0)
+        goto end;
+    for (i=0; i<2 && ret == 0; i++)
+        ret = NTRUENC_keygen_ex(ne, &priv_key[i], &pub_key[i], seed,
+            sizeof(seed));
+    NTRUENC_keygen_final(ne);
+    fprintf(stderr, ", kg seed: %d", ret);
+    if (ret != 0)
+        goto end;
+
+    NTRUENC_PUB_KEY_get_len(pub_key[0], &pub_len);
+    NTRUENC_PUB_KEY_get_enc_len(pub_key[0], &elen);
+    ret = 1;
+    for (i=0; i<2; i++)
+    {
+        pub[i] = malloc(pub_len);
+        enc[i] = malloc(elen);
+        if ((pub[i] == NULL) || (enc[i] == NULL))
+            goto end;
+        if (NTRUENC_PUB_KEY_encode(pub_key[i], pub[i], pub_len) != 0)
+            goto end;
+    }
+    dec = malloc(len);
+    if ((dec == NULL) || (memcmp(pub[0], pub[1], pub_len) != 0))
+        goto end;
+
+    ret = NTRUENC_encrypt_init(ne, pub_key[0]);
+    for (i=0; i<2 && ret == 0; i++)
+        ret = NTRUENC_encrypt_ex(ne, data, len, enc[i], elen, seed,
+            sizeof(seed));
+    NTRUENC_encrypt_final(ne);
+    fprintf(stderr, ", enc seed: %d", ret);
+    if (ret != 0)
+        goto end;
+    ret = 1;
+    if (memcmp(enc[0], enc[1], elen) != 0)
+        goto end;
+
+    ret = NTRUENC_decrypt_init(ne, priv_key[1]);
+    if (ret == 0)
+        ret = NTRUENC_decrypt(ne, enc[0], elen, dec, len, &olen);
+    NTRUENC_decrypt_final(ne);
+    if ((ret == 0) && ((olen != len) || (memcmp(dec, data, len) != 0)))
+        ret = 1;
+    fprintf(stderr, ", dec seed: %d", ret);
+    if (ret != 0)
+        goto end;
+
+    /* Private key stored as the seed and regenerated on decode. */
+    ret = NTRUENC_keygen_init(ne, params);
+    if (ret == 0)
+        ret = NTRUENC_keygen_from_seed(ne, &priv_key[0], &pub_key[0], seed,
+            sizeof(seed));
+    NTRUENC_keygen_final(ne);
+    if (ret == 0)
+        ret = NTRUENC_PRIV_KEY_encode_ex(priv_key[0], NTRU_FORMAT_SEED,
+            priv_seed, sizeof(priv_seed));
+    if (ret == 0)
+        ret = NTRUENC_PRIV_KEY_decode(priv_key[1], priv_seed,
+            sizeof(priv_seed));
+    if (ret == 0)
+        ret = NTRUENC_encrypt_init(ne, pub_key[0]);
+    if (ret == 0)
+        ret = NTRUENC_encrypt(ne, data, len, enc[0], elen);
+    NTRUENC_encrypt_final(ne);
+    if (ret == 0)
+        ret = NTRUENC_decrypt_init(ne, priv_key[1]);
+    if (ret == 0)
+        ret = NTRUENC_decrypt(ne, enc[0], elen, dec, len, &olen);
+    NTRUENC_decrypt_final(ne);
+    if ((ret == 0) && ((olen != len) || (memcmp(dec, data, len) != 0)))
+        ret = 1;
+    fprintf(stderr, ", seed key: %d", ret);
+end:
+    for (i=0; i<2; i++)
+    {
+        if (enc[i] != NULL) free(enc[i]);
+        if (pub[i] != NULL) free(pub[i]);
+        NTRUENC_PUB_KEY_free(pub_key[i]);
+        NTRUENC_PRIV_KEY_free(priv_key[i]);
+    }
+    if (dec != NULL) free(dec);
+    return ret;
+}
+
+/*
+ * Test seeded key generation and encryption against known answers.
+ * The output must not change with build options, the CPU or SIMD paths used.
+ * The SHA3-256 hashes of the encoded public key and encrypted data are
+ * compared.
+ *
+ * @param [in] ne        The NTRU Encryption operation object.
+ * @param [in] params    The NTRU encryption parameters.
+ * @param [in] strength  The security strength of the parameters.
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntruenc_seeded_kat(NTRUENC *ne, NTRUENC_PARAMS *params,
+    int strength)
+{
+    int ret = 0;
+    int i, k;
+    int s;
+    unsigned char seed[NTRU_KEY_SEED_LEN];
+    unsigned char msg[16];
+    unsigned char h[2][32];
+    NTRUENC_PRIV_KEY *priv_key = NULL;
+    NTRUENC_PUB_KEY *pub_key = NULL;
+    unsigned char *pub = NULL;
+    unsigned char *enc = NULL;
+    int pub_len, elen;
+    static const int off[3] = { 0, NTRU_SIMD_AVX2, NTRU_SIMD_ALL };
+    /* Public key and encrypted data hashes for each valid strength. */
+    static const unsigned char kat[VALID_NUM][2][32] =
+    {
+        {
+            {
+                0x6b, 0xa7, 0xac, 0xc2, 0x93, 0x8b, 0x33, 0x4b,
+                0xa8, 0xd9, 0xa2, 0x22, 0xd4, 0x9b, 0x82, 0xa4,
+                0x21, 0x4e, 0xee, 0x8a, 0x92, 0x1b, 0xd9, 0x96,
+                0xf5, 0x42, 0x5b, 0xf6, 0xc8, 0x3f, 0x86, 0x0a
+            },
+            {
+                0x25, 0xb7, 0x98, 0x23, 0xd1, 0x86, 0x37, 0xb3,
+                0x39, 0x0a, 0xcb, 0x12, 0xa6, 0xe9, 0xc0, 0x50,
+                0x19, 0x1c, 0xe1, 0xbc, 0xf0, 0x36, 0xa4, 0xf8,
+                0xfd, 0x0c, 0x7d, 0x85, 0x8c, 0x53, 0x3e, 0x50
+            }
+        },
+        {
+            {
+                0x4b, 0x02, 0xfe, 0x5f, 0x01, 0xba, 0x2a, 0xff,
+                0xa4, 0x44, 0x9e, 0xee, 0x3e, 0x21, 0x86, 0x29,
+                0xbd, 0xa1, 0x1c, 0x79, 0xeb, 0x87, 0xbb, 0x73,
+                0x1b, 0x46, 0x22, 0x26, 0x34, 0x32, 0x1b, 0x7d
+            },
+            {
+                0x89, 0xbb, 0xfa, 0x4c, 0x21, 0x75, 0x71, 0x1d,
+                0xdc, 0xc6, 0x10, 0xc1, 0x67, 0xba, 0xc6, 0xbd,
+                0x2a, 0x40, 0x11, 0x46, 0xad, 0x0f, 0xc0, 0x86,
+                0xc3, 0x8f, 0x5a, 0x4c, 0x94, 0xab, 0xfd, 0x32
+            }
+        },
+        {
+            {
+                0xeb, 0xa5, 0xde, 0x34, 0x41, 0x77, 0x7f, 0xff,
+                0xe5, 0x07, 0xc2, 0xb2, 0xc4, 0x3d, 0xef, 0xef,
+                0xff, 0x59, 0xe0, 0x49, 0x70, 0xe2, 0xd3, 0xae,
+                0x91, 0xd8, 0xe3, 0x05, 0xd8, 0xe0, 0xcb, 0xd7
+            },
+            {
+                0xad, 0x82, 0x71, 0x3b, 0xb9, 0xd0, 0xd7, 0xd6,
+                0xca, 0x59, 0x2b, 0xa2, 0x63, 0x37, 0x3c, 0x38,
+                0xa1, 0x1e, 0x57, 0xe0, 0x5a, 0xc0, 0xaa, 0xbc,
+                0xb6, 0xe8, 0xeb, 0x3b, 0x28, 0x30, 0xa4, 0xd3
+            }
+        },
+        {
+            {
+                0x40, 0xd1, 0xd9, 0xb4, 0x72, 0xa2, 0xed, 0xc9,
+                0x14, 0xa8, 0x0a, 0xfb, 0xc8, 0x63, 0x2d, 0x3c,
+                0x83, 0x7a, 0x01, 0x7b, 0x4d, 0xe8, 0xf5, 0x8b,
+                0xf7, 0xf0, 0x35, 0x03, 0xd6, 0x11, 0x07, 0x75
+            },
+            {
+                0xce, 0x82, 0xfe, 0xd1, 0x11, 0xf3, 0x7f, 0xb3,
+                0xd3, 0x37, 0x0e, 0xdf, 0x75, 0x1c, 0x90, 0x71,
+                0xdd, 0xad, 0xf6, 0xed, 0x21, 0xa3, 0x8b, 0x2c,
+                0xaa, 0xad, 0xbf, 0x53, 0x2a, 0x3f, 0x04, 0xfd
+            }
+        }
+    };
+
+    for (s=0; (s<VALID_NUM) && (valid[s]!=strength); s++)
+        ;
+    for (i=0; i<(int)sizeof(seed); i++)
+        seed[i] = 0xa0 + i;
+    for (i=0; i<(int)sizeof(msg); i++)
+        msg[i] = i;
+
+    for (k=0; (ret == 0) && (k<3); k++)
+    {
+        ntruenc_simd_off = off[k];
+#ifdef NTRUENC_STATIC
+        /* Keys are not created by key generation. */
+        if (priv_key == NULL)
+            ret = NTRUENC_PRIV_KEY_new(params, &priv_key);
+        if ((ret == 0) && (pub_key == NULL))
+            ret = NTRUENC_PUB_KEY_new(params, &pub_key);
+#endif
+        if (ret == 0)
+            ret = NTRUENC_keygen_init(ne, params);
+        if (ret == 0)
+            ret = NTRUENC_keygen_ex(ne, &priv_key, &pub_key, seed,
+                sizeof(seed));
+        NTRUENC_keygen_final(ne);
+        if ((ret == 0) && (pub == NULL))
+        {
+            NTRUENC_PUB_KEY_get_len(pub_key, &pub_len);
+            NTRUENC_PUB_KEY_get_enc_len(pub_key, &elen);
+            pub = malloc(pub_len);
+            enc = malloc(elen);
+            if ((pub == NULL) || (enc == NULL))
+                ret = 1;
+        }
+        if (ret == 0)
+            ret = NTRUENC_PUB_KEY_encode(pub_key, pub, pub_len);
+        if (ret == 0)
+            ret = NTRUENC_encrypt_init(ne, pub_key);
+        if (ret == 0)
+            ret = NTRUENC_encrypt_ex(ne, msg, sizeof(msg), enc, elen, seed,
+                sizeof(seed));
+        NTRUENC_encrypt_final(ne);
+        if (ret == 0)
+        {
+            ntru_sha3_256(h[0], pub, pub_len);
+            ntru_sha3_256(h[1], enc, elen);
+            if ((s == VALID_NUM) || (memcmp(h, kat[s], sizeof(h)) != 0))
+                ret = 1;
+        }
+    }
+    ntruenc_simd_off = 0;
+    fprintf(stderr, ", seed kat: %d", ret);
+
+    NTRUENC_PUB_KEY_free(pub_key);
+    NTRUENC_PRIV_KEY_free(priv_key);
+    if (enc != NULL) free(enc);
+    if (pub != NULL) free(pub);
+    return ret;
+}
+
+/*
+ * Test that key vectors have the layout of the library: aligned and padded
+ * with zeros.
+ *
+ * @param [in] priv  The private key.
+ * @param [in] pub   The public key.
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntruenc_vec_layout(NTRUENC_PRIV_KEY *priv, NTRUENC_PUB_KEY *pub)
+{
+    int ret = 0;
+    int i;
+    int n = priv->params->n;
+
+    if ((((size_t)priv->f | (size_t)pub->h) & (NTRU_VEC_ALIGN - 1)) != 0)
+        ret = 1;
+    for (i=n; i<NTRU_VEC_LEN(n); i++)
+    {
+        if ((priv->f[i] != 0) || (pub->h[i] != 0))
+            ret = 1;
+    }
+    fprintf(stderr, ", layout: %d", ret);
+    return ret;
+}
+
+/*
+ * Test that repeated encryption and decryption operations reuse the arena:
+ * vectors are bound into the same memory each time and the arena is zeroized
+ * and unbound by the final calls.
+ *
+ * @param [in] ne    The NTRU Encryption operation object.
+ * @param [in] pub   The public key.
+ * @param [in] priv  The private key.
+ * @param [in] data  The message or key data.
+ * @param [in] len   The length of the message or key data.
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntruenc_arena(NTRUENC *ne, NTRUENC_PUB_KEY *pub,
+    NTRUENC_PRIV_KEY *priv, unsigned char *data, int len)
+{
+    int ret;
+    int i, j;
+    short *arena = ne->arena;
+    void *arena_mem = ne->arena_mem;
+    int arena_len = ne->arena_len;
+    unsigned char *enc = NULL;
+    unsigned char *dec = NULL;
+    int elen, olen;
+
+    NTRUENC_PUB_KEY_get_enc_len(pub, &elen);
+    ret = 1;
+    enc = malloc(elen);
+    dec = malloc(len);
+    if ((arena == NULL) || (enc == NULL) || (dec == NULL))
+        goto end;
+
+    ret = 0;
+    for (i=0; (ret == 0) && (i<3); i++)
+    {
+        ret = NTRUENC_encrypt_init(ne, pub);
+        if ((ret == 0) && (ne->m != arena))
+            ret = 1;
+        if (ret == 0)
+            ret = NTRUENC_encrypt(ne, data, len, enc, elen);
+        NTRUENC_encrypt_final(ne);
+        if ((ret == 0) && (ne->m != NULL))
+            ret = 1;
+        if (ret == 0)
+            ret = NTRUENC_decrypt_init(ne, priv);
+        if ((ret == 0) && (ne->m != arena))
+            ret = 1;
+        if (ret == 0)
+            ret = NTRUENC_decrypt(ne, enc, elen, dec, len, &olen);
+        NTRUENC_decrypt_final(ne);
+        if ((ret == 0) && ((olen != len) || (memcmp(dec, data, len) != 0)))
+            ret = 1;
+        if ((ret == 0) && ((ne->m != NULL) || (ne->arena != arena) ||
+            (ne->arena_mem != arena_mem) || (ne->arena_len != arena_len)))
+        {
+            ret = 1;
+        }
+        for (j=0; (ret == 0) && (j<arena_len/(int)sizeof(short)); j++)
+        {
+            if (arena[j] != 0)
+                ret = 1;
+        }
+    }
+end:
+    fprintf(stderr, ", arena: %d", ret);
+    if (dec != NULL) free(dec);
+    if (enc != NULL) free(enc);
+    return ret;
+}
+
+#ifndef NTRUENC_STATIC
+/*
+ * Test that encryption with precomputed blinding values decrypts.
+ *
+ * @param [in] ne    The NTRU Encryption operation object.
+ * @param [in] pub   The public key.
+ * @param [in] priv  The private key.
+ * @param [in] data  The message or key data.
+ * @param [in] len   The length of the message or key data.
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntruenc_precompute(NTRUENC *ne, NTRUENC_PUB_KEY *pub,
+    NTRUENC_PRIV_KEY *priv, unsigned char *data, int len)
+{
+    int ret;
+    int i;
+    int cnt;
+    unsigned char *enc[3] = { NULL, NULL, NULL };
+    unsigned char *dec = NULL;
+    int elen, olen;
+
+    NTRUENC_PUB_KEY_get_enc_len(pub, &elen);
+    ret = 1;
+    for (i=0; i<3; i++)
+    {
+        enc[i] = malloc(elen);
+        if (enc[i] == NULL)
+            goto end;
+    }
+    dec = malloc(len);
+    if (dec == NULL)
+        goto end;
+
+    /* Two from the queue and one when the queue is empty. */
+    ret = NTRUENC_encrypt_init(ne, pub);
+    if (ret == 0)
+        ret = NTRUENC_encrypt_precompute(ne, 2);
+    for (i=0; i<3 && ret == 0; i++)
+        ret = NTRUENC_encrypt(ne, data, len, enc[i], elen);
+    if (ret == 0)
+        ret = NTRUENC_encrypt_precomputed(ne, &cnt);
+    if ((ret == 0) && (cnt != 0))
+        ret = 1;
+    NTRUENC_encrypt_final(ne);
+    fprintf(stderr, ", enc pre: %d", ret);
+    if (ret != 0)
+        goto end;
+
+    ret = NTRUENC_decrypt_init(ne, priv);
+    for (i=0; i<3 && ret == 0; i++)
+    {
+        ret = NTRUENC_decrypt(ne, enc[i], elen, dec, len, &olen);
+        if ((ret == 0) && ((olen != len) || (memcmp(dec, data, len) != 0)))
+            ret = 1;
+    }
+    NTRUENC_decrypt_final(ne);
+    fprintf(stderr, ", dec pre: %d", ret);
+end:
+    for (i=0; i<3; i++)
+    {
+        if (enc[i] != NULL) free(enc[i]);
+    }
+    if (dec != NULL) free(dec);
+    return ret;
+}
+#endif
+
+/*
+ * Test the 11-bit packed format of keys and encrypted data, the ternary
+ * format of private keys and public keys referencing packed data.
+ *
+ * @param [in] ne        The NTRU Encryption operation object.
+ * @param [in] params    The NTRU Encryption parameters.
+ * @param [in] pub_gen   The generated public key.
+ * @param [in] priv_gen  The generated private key.
+ * @param [in] data      The data to encrypt.
+ * @param [in] len       The length of the data.
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntruenc_format(NTRUENC *ne, NTRUENC_PARAMS *params,
+    NTRUENC_PUB_KEY *pub_gen, NTRUENC_PRIV_KEY *priv_gen, unsigned char *data,
+    int len)
+{
+    int ret;
+    NTRUENC_PRIV_KEY *priv_key = NULL;
+    NTRUENC_PUB_KEY *pub_key = NULL;
+    unsigned char *priv = NULL;
+    unsigned char *pub = NULL;
+    unsigned char *enc = NULL;
+    unsigned char *dec = NULL;
+    int priv_len, pub_len, elen, olen, tern_len;
+
+    NTRUENC_PRIV_KEY_get_len_ex(priv_gen, NTRU_FORMAT_11BITS, &priv_len);
+    NTRUENC_PRIV_KEY_get_len_ex(priv_gen, NTRU_FORMAT_TERNARY, &tern_len);
+    NTRUENC_PUB_KEY_get_len_ex(pub_gen, NTRU_FORMAT_11BITS, &pub_len);
+    NTRUENC_PUB_KEY_get_enc_len_ex(pub_gen, NTRU_FORMAT_11BITS, &elen);
+    ret = 1;
+    priv = malloc(priv_len);
+    pub = malloc(pub_len);
+    enc = malloc(elen);
+    dec = malloc(len);
+    if ((priv == NULL) || (pub == NULL) || (enc == NULL) || (dec == NULL))
+        goto end;
+
+    ret = NTRUENC_PRIV_KEY_new(params, &priv_key);
+    if (ret == 0)
+        ret = NTRUENC_PUB_KEY_new(params, &pub_key);
+    if (ret == 0)
+        ret = NTRUENC_PRIV_KEY_encode_ex(priv_gen, NTRU_FORMAT_11BITS, priv,
+            priv_len);
+    if (ret == 0)
+        ret = NTRUENC_PRIV_KEY_decode(priv_key, priv, priv_len);
+    /* Re-encode the decoded private key as trits and decode again. */
+    if (ret == 0)
+        ret = NTRUENC_PRIV_KEY_encode_ex(priv_key, NTRU_FORMAT_TERNARY, priv,
+            tern_len);
+    if (ret == 0)
+        ret = NTRUENC_PRIV_KEY_decode(priv_key, priv, tern_len);
+    if (ret == 0)
+        ret = NTRUENC_PUB_KEY_encode_ex(pub_gen, NTRU_FORMAT_11BITS, pub,
+            pub_len);
+    if (ret == 0)
+        ret = NTRUENC_PUB_KEY_decode(pub_key, pub, pub_len);
+    fprintf(stderr, ", 11-bit/ternary keys: %d", ret);
+    if (ret != 0)
+        goto end;
+
+    ret = NTRUENC_encrypt_init(ne, pub_key);
+    if (ret == 0)
+        ret = NTRUENC_set_format(ne, NTRU_FORMAT_11BITS);
+    if (ret == 0)
+        ret = NTRUENC_encrypt(ne, data, len, enc, elen);
+    NTRUENC_set_format(ne, NTRU_FORMAT_12BITS);
+    NTRUENC_encrypt_final(ne);
+    if (ret == 0)
+        ret = NTRUENC_decrypt_init(ne, priv_key);
+    if (ret == 0)
+        ret = NTRUENC_decrypt(ne, enc, elen, dec, len, &olen);
+    if ((ret == 0) && ((olen != len) || (memcmp(dec, data, len) != 0)))
+        ret = 1;
+    NTRUENC_decrypt_final(ne);
+    fprintf(stderr, ", 11-bit enc/dec: %d", ret);
+    if (ret != 0)
+        goto end;
+
+    /* Public key referencing the packed data. */
+    ret = NTRUENC_PUB_KEY_set_packed(pub_key, pub, pub_len);
+    if (ret == 0)
+        ret = NTRUENC_encrypt_init(ne, pub_key);
+    if (ret == 0)
+        ret = NTRUENC_set_format(ne, NTRU_FORMAT_11BITS);
+    if (ret == 0)
+        ret = NTRUENC_encrypt(ne, data, len, enc, elen);
+    NTRUENC_set_format(ne, NTRU_FORMAT_12BITS);
+    NTRUENC_encrypt_final(ne);
+    if (ret == 0)
+        ret = NTRUENC_decrypt_init(ne, priv_key);
+    if (ret == 0)
+        ret = NTRUENC_decrypt(ne, enc, elen, dec, len, &olen);
+    if ((ret == 0) && ((olen != len) || (memcmp(dec, data, len) != 0)))
+        ret = 1;
+    NTRUENC_decrypt_final(ne);
+    fprintf(stderr, ", packed enc/dec: %d", ret);
+end:
+    if (dec != NULL) free(dec);
+    if (enc != NULL) free(enc);
+    if (pub != NULL) free(pub);
+    if (priv != NULL) free(priv);
+    NTRUENC_PUB_KEY_free(pub_key);
+    NTRUENC_PRIV_KEY_free(priv_key);
+    return ret;
+}
+
+#ifndef NTRUENC_STATIC
+/*
+ * Test a public key looked up in a key store encrypts.
+ *
+ * @param [in] ne      The NTRU Encryption operation object.
+ * @param [in] params  The NTRU Encryption parameters.
+ * @param [in] pub     The public key.
+ * @param [in] priv    The private key.
+ * @param [in] data    The data to encrypt.
+ * @param [in] len     The length of the data.
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntruenc_store(NTRUENC *ne, NTRUENC_PARAMS *params,
+    NTRUENC_PUB_KEY *pub, NTRUENC_PRIV_KEY *priv, unsigned char *data,
+    int len)
+{
+    int ret;
+    const char *filename = "ntruenc_test.store";
+    NTRUENC_STORE *store = NULL;
+    NTRUENC_PUB_KEY *view = NULL;
+    NTRUENC_PUB_KEY *key0 = NULL;
+    FILE *f;
+    unsigned char id[NTRU_KEY_ID_LEN];
+    unsigned char *enc = NULL;
+    unsigned char *dec = NULL;
+    int elen, olen, cnt;
+
+    NTRUENC_PUB_KEY_get_enc_len(pub, &elen);
+    ret = 1;
+    enc = malloc(elen);
+    dec = malloc(len);
+    if ((enc == NULL) || (dec == NULL))
+        goto end;
+
+    ret = NTRUENC_PUB_KEY_get_id(pub, id, sizeof(id));
+    if (ret == 0)
+        ret = NTRUENC_STORE_write(filename, &pub, NULL, 1);
+    if (ret == 0)
+        ret = NTRUENC_STORE_open(filename, &store);
+    if (ret == 0)
+        ret = NTRUENC_STORE_num_keys(store, &cnt);
+    if ((ret == 0) && (cnt != 1))
+        ret = 1;
+    if (ret == 0)
+        ret = NTRUENC_PUB_KEY_new(params, &view);
+    if (ret == 0)
+        ret = NTRUENC_STORE_get_key(store, id, sizeof(id), view);
+    fprintf(stderr, ", store: %d", ret);
+    if (ret != 0)
+        goto end;
+
+    ret = NTRUENC_encrypt_init(ne, view);
+    if (ret == 0)
+        ret = NTRUENC_encrypt(ne, data, len, enc, elen);
+    NTRUENC_encrypt_final(ne);
+    if (ret == 0)
+        ret = NTRUENC_decrypt_init(ne, priv);
+    if (ret == 0)
+        ret = NTRUENC_decrypt(ne, enc, elen, dec, len, &olen);
+    NTRUENC_decrypt_final(ne);
+    if ((ret == 0) && ((olen != len) || (memcmp(dec, data, len) != 0)))
+        ret = 1;
+    /* Unknown identifier must not be found. */
+    id[0] ^= 1;
+    if ((ret == 0) &&
+        (NTRUENC_STORE_get_key(store, id, sizeof(id), view) !=
+         NTRU_ERR_NOT_FOUND))
+    {
+        ret = 1;
+    }
+    fprintf(stderr, ", store enc/dec: %d", ret);
+    if (ret != 0)
+        goto end;
+
+    /* A NULL first key is bad data like any other NULL key. */
+    if (NTRUENC_STORE_write(filename, &key0, NULL, 1) != NTRU_ERR_BAD_DATA)
+        ret = 1;
+    /* The file ends with the padding of the only key - corrupt it. */
+    NTRUENC_STORE_close(store);
+    store = NULL;
+    id[0] ^= 1;
+    f = fopen(filename, "r+b");
+    if ((f == NULL) || (fseek(f, -1, SEEK_END) != 0) ||
+        (fputc(0x01, f) == EOF))
+    {
+        ret = 1;
+    }
+    if ((f != NULL) && (fclose(f) != 0))
+        ret = 1;
+    if (ret == 0)
+        ret = NTRUENC_STORE_open(filename, &store);
+    if ((ret == 0) &&
+        (NTRUENC_STORE_get_key(store, id, sizeof(id), view) !=
+         NTRU_ERR_BAD_DATA))
+    {
+        ret = 1;
+    }
+    fprintf(stderr, ", store bad: %d", ret);
+end:
+    NTRUENC_PUB_KEY_free(view);
+    NTRUENC_STORE_close(store);
+    remove(filename);
+    if (dec != NULL) free(dec);
+    if (enc != NULL) free(enc);
+    return ret;
+}
+
+/*
+ * Test encrypting and decrypting a batch of values.
+ * Batch encrypted values are decrypted individually and individually
+ * encrypted values are decrypted as a batch.
+ *
+ * @param [in] ne      The NTRU Encryption operation object.
+ * @param [in] params  The NTRU Encryption parameters.
+ * @param [in] pub     The public key.
+ * @param [in] priv    The private key.
+ * @param [in] data    The data to encrypt.
+ * @param [in] len     The length of the data.
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntruenc_batch(NTRUENC *ne, NTRUENC_PARAMS *params,
+    NTRUENC_PUB_KEY *pub, NTRUENC_PRIV_KEY *priv, unsigned char *data,
+    int len)
+{
+    int ret;
+    int i;
+    int cnt = 5;
+    NTRUENC_BATCH *batch = NULL;
+    unsigned char *msg[NTRU_BATCH_MAX];
+    int mlen[NTRU_BATCH_MAX];
+    unsigned char *enc[NTRU_BATCH_MAX];
+    int elens[NTRU_BATCH_MAX];
+    unsigned char *dec[NTRU_BATCH_MAX];
+    int olen[NTRU_BATCH_MAX];
+    int err[NTRU_BATCH_MAX];
+    unsigned char *buf = NULL;
+    int elen;
+
+    NTRUENC_PUB_KEY_get_enc_len(pub, &elen);
+    ret = 1;
+    buf = malloc(cnt * (elen + len));
+    if (buf == NULL)
+        goto end;
+    for (i=0; i<cnt; i++)
+    {
+        msg[i] = data + i;
+        mlen[i] = len - i;
+        enc[i] = buf + i * elen;
+        elens[i] = elen;
+        dec[i] = buf + cnt * elen + i * len;
+    }
+
+    ret = NTRUENC_BATCH_new(params, &batch);
+    if (ret == 0)
+        ret = NTRUENC_encrypt_init(ne, pub);
+    if (ret == 0)
+        ret = NTRUENC_encrypt_batch(ne, msg, mlen, cnt, batch);
+    if ((ret == 0) && (NTRUENC_BATCH_num(batch) != cnt))
+        ret = 1;
+    if (ret == 0)
+        ret = NTRUENC_BATCH_store(batch, NTRU_FORMAT_12BITS, enc, elen);
+    NTRUENC_encrypt_final(ne);
+    if (ret == 0)
+        ret = NTRUENC_decrypt_init(ne, priv);
+    for (i=0; (ret == 0) && (i<cnt); i++)
+    {
+        ret = NTRUENC_decrypt(ne, enc[i], elen, dec[i], len, &olen[i]);
+        if ((ret == 0) && ((olen[i] != mlen[i]) ||
+            (memcmp(dec[i], msg[i], mlen[i]) != 0)))
+        {
+            ret = 1;
+        }
+    }
+    NTRUENC_decrypt_final(ne);
+    fprintf(stderr, ", batch enc: %d", ret);
+    if (ret != 0)
+        goto end;
+
+    ret = NTRUENC_encrypt_init(ne, pub);
+    for (i=0; (ret == 0) && (i<cnt); i++)
+        ret = NTRUENC_encrypt(ne, msg[i], mlen[i], enc[i], elen);
+    NTRUENC_encrypt_final(ne);
+    if (ret == 0)
+        ret = NTRUENC_BATCH_load(batch, enc, elens, cnt);
+    if (ret == 0)
+        ret = NTRUENC_decrypt_init(ne, priv);
+    if (ret == 0)
+        ret = NTRUENC_decrypt_batch(ne, batch, dec, len, olen, err);
+    for (i=0; (ret == 0) && (i<cnt); i++)
+    {
+        if ((err[i] != 0) || (olen[i] != mlen[i]) ||
+            (memcmp(dec[i], msg[i], mlen[i]) != 0))
+        {
+            ret = 1;
+        }
+    }
+    fprintf(stderr, ", batch dec: %d", ret);
+end:
+    NTRUENC_encrypt_final(ne);
+    NTRUENC_decrypt_final(ne);
+    NTRUENC_BATCH_free(batch);
+    if (buf != NULL) free(buf);
+    return ret;
+}
+#endif
+
+#ifndef NTRUENC_STATIC
+/* The number of threads sharing the prepared keys. */
+#define TEST_PREP_THREADS	4
+
+/* The data of a thread using shared prepared keys. */
+typedef struct test_prep_thread_st
+{
+    /* The strength of the operation object to create. */
+    int strength;
+    /* The prepared public key. */
+    NTRUENC_PREP_KEY *pub;
+    /* The prepared private key. */
+    NTRUENC_PREP_KEY *priv;
+    /* The public key for one-shot encryption. */
+    NTRUENC_PUB_KEY *pub_key;
+    /* The private key for one-shot decryption. */
+    NTRUENC_PRIV_KEY *priv_key;
+    /* The data to encrypt. */
+    unsigned char *data;
+    /* The length of the data. */
+    int len;
+    /* The length of the encrypted data. */
+    int elen;
+    /* The result of the thread's testing. */
+    int ret;
+} TEST_PREP_THREAD;
+
+/*
+ * Encrypt and decrypt with the prepared keys using an operation object of
+ * the thread, and with the keys using the one-shot operations.
+ *
+ * @param [in] arg  The data of the thread.
+ * @return  NULL.
+ */
+static void *test_prep_thread(void *arg)
+{
+    TEST_PREP_THREAD *t = arg;
+    int ret;
+    int i;
+    int olen;
+    NTRUENC *ne = NULL;
+    unsigned char *enc = NULL;
+    unsigned char *dec = NULL;
+
+    ret = NTRUENC_new(t->strength, 0, &ne);
+    if (ret != 0)
+        goto end;
+    ret = 1;
+    enc = malloc(t->elen);
+    dec = malloc(t->len);
+    if ((enc == NULL) || (dec == NULL))
+        goto end;
+
+    ret = 0;
+    for (i=0; (i<8) && (ret == 0); i++)
+    {
+        ret = NTRUENC_encrypt_init_prep(ne, t->pub);
+        if (ret == 0)
+            ret = NTRUENC_encrypt(ne, t->data, t->len, enc, t->elen);
+        NTRUENC_encrypt_final(ne);
+        if (ret == 0)
+            ret = NTRUENC_decrypt_init_prep(ne, t->priv);
+        if (ret == 0)
+            ret = NTRUENC_decrypt(ne, enc, t->elen, dec, t->len, &olen);
+        NTRUENC_decrypt_final(ne);
+        if ((ret == 0) && ((olen != t->len) ||
+            (memcmp(dec, t->data, t->len) != 0)))
+        {
+            ret = 1;
+        }
+    }
+    /* One-shot operations with the thread's cached operation object. */
+    for (i=0; (i<8) && (ret == 0); i++)
+    {
+        ret = NTRUENC_encrypt_oneshot(t->pub_key, t->data, t->len, enc,
+            t->elen);
+        if (ret == 0)
+            ret = NTRUENC_decrypt_oneshot(t->priv_key, enc, t->elen, dec,
+                t->len, &olen);
+        if ((ret == 0) && ((olen != t->len) ||
+            (memcmp(dec, t->data, t->len) != 0)))
+        {
+            ret = 1;
+        }
+    }
+end:
+    if (dec != NULL) free(dec);
+    if (enc != NULL) free(enc);
+    NTRUENC_free(ne);
+    t->ret = ret;
+    return NULL;
+}
+
+/*
+ * Test prepared keys shared by operation objects in a number of threads and
+ * the one-shot operations of threads.
+ *
+ * @param [in] strength  The strength of the operation objects.
+ * @param [in] pub       The public key.
+ * @param [in] priv      The private key.
+ * @param [in] data      The data to encrypt.
+ * @param [in] len       The length of the data.
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntruenc_prep(int strength, NTRUENC_PUB_KEY *pub,
+    NTRUENC_PRIV_KEY *priv, unsigned char *data, int len)
+{
+    int ret;
+    int i;
+    int started = 0;
+    NTRUENC_PREP_KEY *pub_prep = NULL;
+    NTRUENC_PREP_KEY *priv_prep = NULL;
+    TEST_PREP_THREAD t[TEST_PREP_THREADS];
+    pthread_t thread[TEST_PREP_THREADS];
+
+    ret = NTRUENC_PREP_KEY_new_pub(pub, &pub_prep);
+    if (ret == 0)
+        ret = NTRUENC_PREP_KEY_new_priv(priv, &priv_prep);
+    if (ret != 0)
+        goto end;
+
+    for (i=0; i<TEST_PREP_THREADS; i++)
+    {
+        t[i].strength = strength;
+        t[i].pub = pub_prep;
+        t[i].priv = priv_prep;
+        t[i].pub_key = pub;
+        t[i].priv_key = priv;
+        t[i].data = data;
+        t[i].len = len;
+        NTRUENC_PUB_KEY_get_enc_len(pub, &t[i].elen);
+        t[i].ret = 1;
+        if (pthread_create(&thread[i], NULL, test_prep_thread, &t[i]) != 0)
+        {
+            ret = 1;
+            break;
+        }
+        started++;
+    }
+    for (i=0; i<started; i++)
+    {
+        pthread_join(thread[i], NULL);
+        ret |= t[i].ret;
+    }
+    fprintf(stderr, ", prep/one-shot threads: %d", ret);
+end:
+    NTRUENC_PREP_KEY_free(priv_prep);
+    NTRUENC_PREP_KEY_free(pub_prep);
+    return ret;
+}
+#endif
+
+/*
+ * Test encrypting and decrypting the largest message encoded as trits.
+ *
+ * @param [in] ne    The NTRU Encryption operation object.
+ * @param [in] pub   The public key.
+ * @param [in] priv  The private key.
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntruenc_msg_trits(NTRUENC *ne, NTRUENC_PUB_KEY *pub,
+    NTRUENC_PRIV_KEY *priv)
+{
+    int ret;
+    unsigned char *data = NULL;
+    unsigned char *dec = NULL;
+    unsigned char *enc = NULL;
+    int len, olen, elen, n;
+
+    NTRUENC_PUB_KEY_num_entries(pub, &n);
+    NTRUENC_PUB_KEY_get_enc_len(pub, &elen);
+    /* Length header in 12 elements and then 3 bits in every 2 elements. */
+    len = (((n - 12) / 2) * 3) / 8;
+    ret = 1;
+    data = malloc(len + 1);
+    dec = malloc(len + 1);
+    enc = malloc(elen);
+    if ((data == NULL) || (dec == NULL) || (enc == NULL))
+        goto end;
+
+    ret = random_data(data, len + 1);
+    if (ret == 0)
+        ret = NTRUENC_set_msg_format(ne, NTRU_MSG_TRITS);
+    if (ret == 0)
+        ret = NTRUENC_encrypt_init(ne, pub);
+    if ((ret == 0) &&
+        (NTRUENC_encrypt(ne, data, len + 1, enc, elen) != NTRU_ERR_BAD_LEN))
+    {
+        ret = 1;
+    }
+    if (ret == 0)
+        ret = NTRUENC_encrypt(ne, data, len, enc, elen);
+    NTRUENC_encrypt_final(ne);
+    if (ret == 0)
+        ret = NTRUENC_decrypt_init(ne, priv);
+    if (ret == 0)
+        ret = NTRUENC_decrypt(ne, enc, elen, dec, len, &olen);
+    NTRUENC_decrypt_final(ne);
+    if ((ret == 0) && ((olen != len) || (memcmp(dec, data, len) != 0)))
+        ret = 1;
+    fprintf(stderr, ", trits msg: %d,%d", ret, len);
+end:
+    NTRUENC_set_msg_format(ne, NTRU_MSG_BITS);
+    if (enc != NULL) free(enc);
+    if (dec != NULL) free(dec);
+    if (data != NULL) free(data);
+    return ret;
+}
+
+/*
+ * Generate the next pseudo-random value for test vectors - xorshift64.
+ *
+ * @param [in] x  The generator state.
+ * @return  The next value.
+ */
+static uint64_t test_next64(uint64_t *x)
+{
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+/*
+ * Test each implementation of the Keccak block operation available on this
+ * CPU against the reference on the same states for 24 and 12 rounds.
+ *
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntru_keccak_impl()
+{
+    int ret = 0;
+    int i, j, k, impl;
+    int cnt = 0;
+    static const int nr[2] = { 24, 12 };
+    uint64_t x = 0x9e3779b97f4a7c15UL;
+    uint64_t in[25], ref[25], s[25];
+
+    /* Keccak-f[1600] of the zero state. */
+    for (i=0; i<25; i++)
+        ref[i] = 0;
+    ntru_keccak_block_impl(NTRU_KECCAK_IMPL_REF, ref, 24);
+    if ((ref[0] != 0xf1258f7940e1dde7UL) || (ref[24] != 0xeaf1ff7b5ceca249UL))
+        ret = 1;
+
+    for (k=0; k<8 && ret==0; k++)
+    {
+        /* First state is all zeros and the others are pseudo-random. */
+        for (i=0; i<25; i++)
+            in[i] = (k == 0) ? 0 : test_next64(&x);
+        for (j=0; j<2 && ret==0; j++)
+        {
+            memcpy(ref, in, sizeof(in));
+            ntru_keccak_block_impl(NTRU_KECCAK_IMPL_REF, ref, nr[j]);
+            for (impl=0; impl<NTRU_KECCAK_IMPL_NUM && ret==0; impl++)
+            {
+                memcpy(s, in, sizeof(in));
+                if (!ntru_keccak_block_impl(impl, s, nr[j]))
+                    continue;
+                if (memcmp(s, ref, sizeof(s)) != 0)
+                    ret = 1;
+                cnt++;
+            }
+        }
+    }
+    fprintf(stderr, "Keccak impl: %d,%d", ret, cnt);
+
+    return ret;
+}
+
+/*
+ * Test SHAKE-256 against known answers: the empty message, "abc" and the
+ * 200 byte message of 0xa3 with 512 bytes of output.
+ * The incremental API is tested on the long message absorbing and squeezing
+ * in pieces that don't line up with the block size.
+ *
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntru_shake256_kat()
+{
+    int ret = 0;
+    int i;
+    NTRU_SHAKE ctx;
+    unsigned char m[200];
+    unsigned char h[512];
+    static const unsigned char kat_empty[32] =
+    {
+        0x46, 0xb9, 0xdd, 0x2b, 0x0b, 0xa8, 0x8d, 0x13,
+        0x23, 0x3b, 0x3f, 0xeb, 0x74, 0x3e, 0xeb, 0x24,
+        0x3f, 0xcd, 0x52, 0xea, 0x62, 0xb8, 0x1b, 0x82,
+        0xb5, 0x0c, 0x27, 0x64, 0x6e, 0xd5, 0x76, 0x2f
+    };
+    static const unsigned char kat_abc[32] =
+    {
+        0x48, 0x33, 0x66, 0x60, 0x13, 0x60, 0xa8, 0x77,
+        0x1c, 0x68, 0x63, 0x08, 0x0c, 0xc4, 0x11, 0x4d,
+        0x8d, 0xb4, 0x45, 0x30, 0xf8, 0xf1, 0xe1, 0xee,
+        0x4f, 0x94, 0xea, 0x37, 0xe7, 0x8b, 0x57, 0x39
+    };
+    /* First and last 32 bytes of 512 bytes of output. */
+    static const unsigned char kat_a3[2][32] =
+    {
+        {
+            0xcd, 0x8a, 0x92, 0x0e, 0xd1, 0x41, 0xaa, 0x04,
+            0x07, 0xa2, 0x2d, 0x59, 0x28, 0x86, 0x52, 0xe9,
+            0xd9, 0xf1, 0xa7, 0xee, 0x0c, 0x1e, 0x7c, 0x1c,
+            0xa6, 0x99, 0x42, 0x4d, 0xa8, 0x4a, 0x90, 0x4d
+        },
+        {
+            0x6a, 0x1a, 0x9d, 0x78, 0x46, 0x43, 0x6e, 0x4d,
+            0xca, 0x57, 0x28, 0xb6, 0xf7, 0x60, 0xee, 0xf0,
+            0xca, 0x92, 0xbf, 0x0b, 0xe5, 0x61, 0x5e, 0x96,
+            0x95, 0x9d, 0x76, 0x71, 0x97, 0xa0, 0xbe, 0xeb
+        }
+    };
+
+    ntru_shake256(h, 32, NULL, 0);
+    if (memcmp(h, kat_empty, 32) != 0)
+        ret = 1;
+    ntru_shake256(h, 32, (const uint8_t *)"abc", 3);
+    if (memcmp(h, kat_abc, 32) != 0)
+        ret = 1;
+
+    memset(m, 0xa3, sizeof(m));
+    ntru_shake256(h, sizeof(h), m, sizeof(m));
+    if ((memcmp(h, kat_a3[0], 32) != 0) ||
+        (memcmp(h + sizeof(h) - 32, kat_a3[1], 32) != 0))
+    {
+        ret = 1;
+    }
+
+    memset(h, 0, sizeof(h));
+    ntru_shake256_init(&ctx);
+    for (i=0; i<(int)sizeof(m); i+=7)
+        ntru_shake_absorb(&ctx, m+i, (sizeof(m)-i < 7) ? sizeof(m)-i : 7);
+    ntru_shake_final(&ctx);
+    for (i=0; i<(int)sizeof(h); i+=45)
+        ntru_shake_squeeze(&ctx, h+i, (sizeof(h)-i < 45) ? sizeof(h)-i : 45);
+    if ((memcmp(h, kat_a3[0], 32) != 0) ||
+        (memcmp(h + sizeof(h) - 32, kat_a3[1], 32) != 0))
+    {
+        ret = 1;
+    }
+    fprintf(stderr, ", SHAKE-256 KAT: %d", ret);
+
+    return ret;
+}
+
+/*
+ * Test TurboSHAKE128 against the known answers in RFC 9861.
+ * Long outputs are checked on the last 32 bytes only.
+ * The incremental API is tested on the longest output.
+ *
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntru_turboshake128_kat()
+{
+    int ret = 0;
+    int i, j;
+    NTRU_SHAKE ctx;
+    unsigned char *m = NULL;
+    unsigned char *h = NULL;
+    static const struct
+    {
+        /* 0 for the pattern message or the byte to fill the message with. */
+        unsigned char fill;
+        /* The length of the message. */
+        int n;
+        /* The domain separation byte. */
+        unsigned char d;
+        /* The length of the output. */
+        int l;
+        /* The last 32 bytes of the output. */
+        unsigned char h[32];
+    } kat[] =
+    {
+        /* The empty message. */
+        {
+            0x00, 0, 0x1f, 32,
+            {
+                0x1e, 0x41, 0x5f, 0x1c, 0x59, 0x83, 0xaf, 0xf2,
+                0x16, 0x92, 0x17, 0x27, 0x7d, 0x17, 0xbb, 0x53,
+                0x8c, 0xd9, 0x45, 0xa3, 0x97, 0xdd, 0xec, 0x54,
+                0x1f, 0x1c, 0xe4, 0x1a, 0xf2, 0xc1, 0xb7, 0x4c
+            }
+        },
+        {
+            0x00, 0, 0x1f, 64,
+            {
+                0x3e, 0x8c, 0xca, 0xe2, 0xa4, 0xda, 0xe5, 0x6c,
+                0x84, 0xa0, 0x4c, 0x23, 0x85, 0xc0, 0x3c, 0x15,
+                0xe8, 0x19, 0x3b, 0xdf, 0x58, 0x73, 0x73, 0x63,
+                0x32, 0x16, 0x91, 0xc0, 0x54, 0x62, 0xc8, 0xdf
+            }
+        },
+        {
+            0x00, 0, 0x1f, 10032,
+            {
+                0xa3, 0xb9, 0xb0, 0x38, 0x59, 0x00, 0xce, 0x76,
+                0x1f, 0x22, 0xae, 0xd5, 0x48, 0xe7, 0x54, 0xda,
+                0x10, 0xa5, 0x24, 0x2d, 0x62, 0xe8, 0xc6, 0x58,
+                0xe3, 0xf3, 0xa9, 0x23, 0xa7, 0x55, 0x56, 0x07
+            }
+        },
+        /* Message of the pattern 00 01 .. fa repeated. */
+        {
+            0x00, 17, 0x1f, 32,
+            {
+                0x9c, 0x97, 0xd0, 0x36, 0xa3, 0xba, 0xc8, 0x19,
+                0xdb, 0x70, 0xed, 0xe0, 0xca, 0x55, 0x4e, 0xc6,
+                0xe4, 0xc2, 0xa1, 0xa4, 0xff, 0xbf, 0xd9, 0xec,
+                0x26, 0x9c, 0xa6, 0xa1, 0x11, 0x16, 0x12, 0x33
+            }
+        },
+        {
+            0x00, 289, 0x1f, 32,
+            {
+                0x96, 0xc7, 0x7c, 0x27, 0x9e, 0x01, 0x26, 0xf7,
+                0xfc, 0x07, 0xc9, 0xb0, 0x7f, 0x5c, 0xda, 0xe1,
+                0xe0, 0xbe, 0x60, 0xbd, 0xbe, 0x10, 0x62, 0x00,
+                0x40, 0xe7, 0x5d, 0x72, 0x23, 0xa6, 0x24, 0xd2
+            }
+        },
+        {
+            0x00, 4913, 0x1f, 32,
+            {
+                0xd4, 0x97, 0x6e, 0xb5, 0x6b, 0xcf, 0x11, 0x85,
+                0x20, 0x58, 0x2b, 0x70, 0x9f, 0x73, 0xe1, 0xd6,
+                0x85, 0x3e, 0x00, 0x1f, 0xda, 0xf8, 0x0e, 0x1b,
+                0x13, 0xe0, 0xd0, 0x59, 0x9d, 0x5f, 0xb3, 0x72
+            }
+        },
+        /* Message of 0xff bytes with other domain separation bytes. */
+        {
+            0xff, 3, 0x01, 32,
+            {
+                0xbf, 0x32, 0x3f, 0x94, 0x04, 0x94, 0xe8, 0x8e,
+                0xe1, 0xc5, 0x40, 0xfe, 0x66, 0x0b, 0xe8, 0xa0,
+                0xc9, 0x3f, 0x43, 0xd1, 0x5e, 0xc0, 0x06, 0x99,
+                0x84, 0x62, 0xfa, 0x99, 0x4e, 0xed, 0x5d, 0xab
+            }
+        },
+        {
+            0xff, 1, 0x06, 32,
+            {
+                0x8e, 0xc9, 0xc6, 0x64, 0x65, 0xed, 0x0d, 0x4a,
+                0x6c, 0x35, 0xd1, 0x35, 0x06, 0x71, 0x8d, 0x68,
+                0x7a, 0x25, 0xcb, 0x05, 0xc7, 0x4c, 0xca, 0x1e,
+                0x42, 0x50, 0x1a, 0xbd, 0x83, 0x87, 0x4a, 0x67
+            }
+        },
+        {
+            0xff, 3, 0x07, 32,
+            {
+                0xb6, 0x58, 0x57, 0x60, 0x01, 0xca, 0xd9, 0xb1,
+                0xe5, 0xf3, 0x99, 0xa9, 0xf7, 0x77, 0x23, 0xbb,
+                0xa0, 0x54, 0x58, 0x04, 0x2d, 0x68, 0x20, 0x6f,
+                0x72, 0x52, 0x68, 0x2d, 0xba, 0x36, 0x63, 0xed
+            }
+        },
+        {
+            0xff, 7, 0x0b, 32,
+            {
+                0x8d, 0xee, 0xaa, 0x1a, 0xec, 0x47, 0xcc, 0xee,
+                0x56, 0x9f, 0x65, 0x9c, 0x21, 0xdf, 0xa8, 0xe1,
+                0x12, 0xdb, 0x3c, 0xee, 0x37, 0xb1, 0x81, 0x78,
+                0xb2, 0xac, 0xd8, 0x05, 0xb7, 0x99, 0xcc, 0x37
+            }
+        },
+        {
+            0xff, 1, 0x30, 32,
+            {
+                0x55, 0x31, 0x22, 0xe2, 0x13, 0x5e, 0x36, 0x3c,
+                0x32, 0x92, 0xbe, 0xd2, 0xc6, 0x42, 0x1f, 0xa2,
+                0x32, 0xba, 0xb0, 0x3d, 0xaa, 0x07, 0xc7, 0xd6,
+                0x63, 0x66, 0x03, 0x28, 0x65, 0x06, 0x32, 0x5b
+            }
+        },
+        {
+            0xff, 3, 0x7f, 32,
+            {
+                0x16, 0x27, 0x4c, 0xc6, 0x56, 0xd4, 0x4c, 0xef,
+                0xd4, 0x22, 0x39, 0x5d, 0x0f, 0x90, 0x53, 0xbd,
+                0xa6, 0xd2, 0x8e, 0x12, 0x2a, 0xba, 0x15, 0xc7,
+                0x65, 0xe5, 0xad, 0x0e, 0x6e, 0xaf, 0x26, 0xf9
+            }
+        }
+
+    };
+
+    m = malloc(17*17*17);
+    h = malloc(10032);
+    if ((m == NULL) || (h == NULL))
+    {
+        ret = 1;
+        goto end;
+    }
+
+    for (i=0; i<(int)(sizeof(kat)/sizeof(*kat)) && ret==0; i++)
+    {
+        for (j=0; j<kat[i].n; j++)
+            m[j] = (kat[i].fill == 0) ? j % 251 : kat[i].fill;
+        ntru_turboshake128(h, kat[i].l, m, kat[i].n, kat[i].d);
+        if (memcmp(h + kat[i].l - 32, kat[i].h, 32) != 0)
+            ret = 1;
+    }
+
+    if (ret == 0)
+    {
+        /* Squeeze the 10032 bytes in pieces that aren't a whole block. */
+        memset(h, 0, 10032);
+        ntru_turboshake128_init(&ctx, 0x1f);
+        ntru_shake_final(&ctx);
+        for (i=0; i<10032; i+=1000)
+            ntru_shake_squeeze(&ctx, h+i, (10032-i < 1000) ? 10032-i : 1000);
+        if (memcmp(h + 10032 - 32, kat[2].h, 32) != 0)
+            ret = 1;
+    }
+end:
+    fprintf(stderr, ", TurboSHAKE128 KAT: %d", ret);
+    if (h != NULL) free(h);
+    if (m != NULL) free(m);
+    return ret;
+}
+
+/*
+ * Test the multi-buffer SHAKE-256 and TurboSHAKE128 operations lane by lane
+ * against the single buffer operations.
+ * Each lane has a different message and the message lengths are either side
+ * of the block sizes.
+ *
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntru_shake_xn()
+{
+    int ret = 0;
+    int i, j, k, w;
+    uint64_t x = 0x2545f4914f6cdd1dUL;
+    unsigned char m[8][300];
+    unsigned char h[8][300];
+    unsigned char r[300];
+    const uint8_t *mp[8];
+    uint8_t *hp[8];
+    static const int len[] = { 0, 1, 135, 136, 137, 167, 168, 169, 300 };
+
+    for (k=0; k<8; k++)
+    {
+        for (j=0; j<(int)sizeof(m[k]); j++)
+            m[k][j] = (unsigned char)test_next64(&x);
+        mp[k] = m[k];
+        hp[k] = h[k];
+    }
+
+    for (i=0; i<(int)(sizeof(len)/sizeof(*len)) && ret==0; i++)
+    {
+        for (w=4; w<=8 && ret==0; w+=4)
+        {
+            if (w == 4)
+                ntru_shake256_x4(hp, sizeof(h[0]), mp, len[i]);
+            else
+                ntru_shake256_x8(hp, sizeof(h[0]), mp, len[i]);
+            for (k=0; k<w; k++)
+            {
+                ntru_shake256(r, sizeof(r), m[k], len[i]);
+                if (memcmp(r, h[k], sizeof(r)) != 0)
+                    ret = 1;
+            }
+
+            if (w == 4)
+                ntru_turboshake128_x4(hp, sizeof(h[0]), mp, len[i], 0x1f);
+            else
+                ntru_turboshake128_x8(hp, sizeof(h[0]), mp, len[i], 0x1f);
+            for (k=0; k<w; k++)
+            {
+                ntru_turboshake128(r, sizeof(r), m[k], len[i], 0x1f);
+                if (memcmp(r, h[k], sizeof(r)) != 0)
+                    ret = 1;
+            }
+        }
+    }
+    fprintf(stderr, ", SHAKE x4/x8: %d", ret);
+
+    return ret;
+}
+
+/*
+ * Test AES-256-CTR when AES-NI is available.
+ * The FIPS-197 AES-256 vector is checked as a counter block encrypted on its
+ * own and as the fourth block of eight encrypted together.
+ * Key stream with a block count that isn't a multiple of eight, and that
+ * carries into the upper 32 bits of the counter, is compared with blocks
+ * encrypted one at a time.
+ *
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntru_aes256_ctr()
+{
+    int ret = 0;
+    int i;
+    unsigned char key[NTRU_AES256_KEY_LEN];
+    unsigned char r[21][NTRU_AES_BLOCK_LEN];
+    unsigned char b[NTRU_AES_BLOCK_LEN];
+    /* Counter block is plaintext: 00112233445566778899aabbccddeeff. */
+    static const uint64_t n = 0x7766554433221100UL;
+    static const uint64_t c = 0xffeeddccbbaa9988UL;
+    static const unsigned char ct[NTRU_AES_BLOCK_LEN] =
+    {
+        0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf,
+        0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89
+    };
+
+    if (!ntru_aes_ni_available())
+    {
+        fprintf(stderr, ", AES-256-CTR: skipped");
+        return 0;
+    }
+
+    for (i=0; i<(int)sizeof(key); i++)
+        key[i] = i;
+
+    ntru_aes256_ctr(b, 1, key, n, c);
+    if (memcmp(b, ct, sizeof(ct)) != 0)
+        ret = 1;
+    ntru_aes256_ctr(r[0], 8, key, n, c - 3);
+    if (memcmp(r[3], ct, sizeof(ct)) != 0)
+        ret = 1;
+
+    ntru_aes256_ctr(r[0], 21, key, n, 0xfffffff9UL);
+    for (i=0; i<21; i++)
+    {
+        ntru_aes256_ctr(b, 1, key, n, 0xfffffff9UL + i);
+        if (memcmp(b, r[i], sizeof(b)) != 0)
+            ret = 1;
+    }
+    fprintf(stderr, ", AES-256-CTR: %d", ret);
+
+    return ret;
+}
+
+/*
+ * Test the SIMD message bit expansion, compaction and padding check against
+ * the C code.
+ * Lengths are not multiples of the SIMD widths so that the C code handles
+ * a tail. Invalid 0 elements and out of range elements are placed in the
+ * SIMD part and in the tail.
+ *
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntruenc_msg_simd()
+{
+    int ret = 0;
+    int i, j, k, p;
+    uint64_t x = 0x5851f42d4c957f2dUL;
+    unsigned char data[67];
+    unsigned char out[2][67];
+    short m[2][67*8];
+    short t[67*8];
+    int r[2];
+    static const int len[] = { 1, 2, 3, 5, 7, 31, 33, 67 };
+    static const int orn[] = { 1, 15, 16, 17, 31, 33, 401, 439 };
+    static const int off[2] = { NTRU_SIMD_ALL, 0 };
+
+    for (i=0; i<(int)(sizeof(len)/sizeof(*len)) && ret==0; i++)
+    {
+        for (j=0; j<len[i]; j++)
+            data[j] = (unsigned char)test_next64(&x);
+        for (k=0; k<2; k++)
+        {
+            ntruenc_simd_off = off[k];
+            ntruenc_msg_expand(data, len[i], m[k]);
+        }
+        if (memcmp(m[0], m[1], len[i]*8*sizeof(short)) != 0)
+            ret = 1;
+
+        /* Round trip. */
+        for (k=0; k<2; k++)
+        {
+            ntruenc_simd_off = off[k];
+            r[k] = ntruenc_msg_compact(m[1], len[i], out[k]);
+            if ((r[k] != 0) || (memcmp(out[k], data, len[i]) != 0))
+                ret = 1;
+        }
+
+        /* Invalid 0 element and out of range elements at the start, middle
+         * and end. */
+        for (p=0; p<3 && ret==0; p++)
+        {
+            memcpy(t, m[1], len[i]*8*sizeof(short));
+            j = p * (len[i]*8 - 1) / 2;
+            t[j] = 0;
+            t[(j + 3) % (len[i]*8)] = 5;
+            t[(j + 5) % (len[i]*8)] = -7;
+            for (k=0; k<2; k++)
+            {
+                ntruenc_simd_off = off[k];
+                r[k] = ntruenc_msg_compact(t, len[i], out[k]);
+            }
+            if ((r[0] == 0) || (r[1] == 0) ||
+                (memcmp(out[0], out[1], len[i]) != 0))
+            {
+                ret = 1;
+            }
+        }
+    }
+
+    /* Padding check: all zero then a single non-zero element anywhere. */
+    memset(t, 0, sizeof(t));
+    for (i=0; i<(int)(sizeof(orn)/sizeof(*orn)) && ret==0; i++)
+    {
+        for (k=0; k<2; k++)
+        {
+            ntruenc_simd_off = off[k];
+            if (ntruenc_msg_or(t, orn[i]) != 0)
+                ret = 1;
+        }
+        for (j=0; j<orn[i] && ret==0; j++)
+        {
+            t[j] = (j & 1) ? -32768 : 0x100;
+            for (k=0; k<2; k++)
+            {
+                ntruenc_simd_off = off[k];
+                if (ntruenc_msg_or(t, orn[i]) == 0)
+                    ret = 1;
+            }
+            t[j] = 0;
+        }
+    }
+    ntruenc_simd_off = 0;
+    fprintf(stderr, ", msg SIMD: %d", ret);
+
+    return ret;
+}
+
+/*
+ * Test the SSSE3 and AVX2 packing and unpacking against the C code for each
+ * vector length.
+ * Elements are random 12-bit values for the 12-bit format and random 16-bit
+ * values for the 11-bit format, where the bits above 11 must be dropped.
+ * 11-bit data with non-zero padding bits or in a larger buffer must be
+ * rejected.
+ *
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntruenc_pack_simd()
+{
+    int ret = 0;
+    int i, j, k, f, len;
+    uint64_t x = 0xda942042e4dd58b5UL;
+    short a[743];
+    short u[3][743];
+    unsigned char *data[3] = { NULL, NULL, NULL };
+    unsigned char *big = NULL;
+    int blen;
+    int r[3];
+    static const int n[] = { 401, 439, 593, 743 };
+    static const int fmt[] = { NTRU_FORMAT_12BITS, NTRU_FORMAT_11BITS };
+    static const int off[3] = { NTRU_SIMD_ALL, NTRU_SIMD_AVX2, 0 };
+
+    for (i=0; i<(int)(sizeof(n)/sizeof(*n)) && ret==0; i++)
+    {
+        for (f=0; f<2 && ret==0; f++)
+        {
+            for (j=0; j<n[i]; j++)
+            {
+                a[j] = (short)test_next64(&x);
+                if (fmt[f] == NTRU_FORMAT_12BITS)
+                    a[j] &= 0xfff;
+            }
+            /* Exact length so reading past the end is caught by tools. */
+            len = ntruenc_pack_len(n[i], fmt[f]);
+            for (k=0; k<3; k++)
+            {
+                data[k] = malloc(len);
+                if (data[k] == NULL)
+                    ret = 1;
+            }
+
+            for (k=0; k<3 && ret==0; k++)
+            {
+                ntruenc_simd_off = off[k];
+                ret = ntruenc_pack(a, n[i], fmt[f], data[k], len);
+                if ((ret == 0) && (memcmp(data[k], data[0], len) != 0))
+                    ret = 1;
+            }
+            for (k=0; k<3 && ret==0; k++)
+            {
+                ntruenc_simd_off = off[k];
+                ret = ntruenc_unpack(data[0], len, n[i], u[k]);
+                if ((ret == 0) &&
+                    (memcmp(u[k], u[0], n[i]*sizeof(short)) != 0))
+                {
+                    ret = 1;
+                }
+            }
+            /* Round trip keeps the bottom 11 or 12 bits. */
+            for (j=0; j<n[i] && ret==0; j++)
+            {
+                if (fmt[f] == NTRU_FORMAT_11BITS)
+                    ret = (u[0][j] != ((a[j] & 0x7ff) | -(a[j] & 0x400)));
+                else
+                    ret = (u[0][j] != a[j]);
+            }
+
+            if ((ret == 0) && (fmt[f] == NTRU_FORMAT_11BITS))
+            {
+                /* 11-bit data in a larger buffer is not 12-bit data. */
+                big = malloc(2 * len);
+                if (big == NULL)
+                    ret = 1;
+                for (k=0; (ret == 0) && (k<3); k++)
+                {
+                    blen = (k == 2) ? 2 * len : len + k + 1;
+                    memset(big, 0, 2 * len);
+                    memcpy(big, data[0], len);
+                    if (ntruenc_unpack(big, blen, n[i], u[k]) !=
+                        NTRU_ERR_BAD_LEN)
+                    {
+                        ret = 1;
+                    }
+                }
+                if (big != NULL) free(big);
+                big = NULL;
+            }
+            if ((ret == 0) && (fmt[f] == NTRU_FORMAT_11BITS))
+            {
+                /* Top padding bit set. */
+                data[0][len-1] |= 0x80;
+                for (k=0; k<3; k++)
+                {
+                    ntruenc_simd_off = off[k];
+                    r[k] = ntruenc_unpack(data[0], len, n[i], u[k]);
+                    if (r[k] != NTRU_ERR_BAD_DATA)
+                        ret = 1;
+                }
+            }
+
+            for (k=0; k<3; k++)
+            {
+                if (data[k] != NULL) free(data[k]);
+                data[k] = NULL;
+            }
+        }
+    }
+    ntruenc_simd_off = 0;
+    fprintf(stderr, ", pack SIMD: %d", ret);
+
+    return ret;
 }
 
 /*
- * Calculate the number of cycles/second.
+ * Compare two signed 32-bit values for qsort().
+ *
+ * @param [in] a  The first value.
+ * @param [in] b  The second value.
+ * @return  -1, 0 or 1 as a is less than, equal to or greater than b.
  */
-void calc_cps()
+static int test_cmp_int32(const void *a, const void *b)
 {
-    uint64_t end, start = get_cycles();
-    sleep(1);
-    end = get_cycles();
-    cps = end-start;
-    printf("Cycles/sec: %"PRIu64"\n", cps);
+    int32_t x = *(const int32_t *)a;
+    int32_t y = *(const int32_t *)b;
+
+    return (x > y) - (x < y);
 }
 
 /*
- * Determine the number of encryption operations that can be performed per
- * second.
+ * Test the AVX2 sorting network and the C sorting network against qsort().
+ * Lengths either side of powers of 2 and of the largest AVX2 length are
+ * used. Values include duplicates and the extremes.
  *
- * @param [in] ne       The NTRU Encryption operation object.
- * @param [in] data     The message or key data.
- * @param [in] len      The length of the message or key data.
- * @param [in] pub_key  The public key.
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
  */
-void enc_cycles(NTRUENC *ne, unsigned char *data, int len,
-    NTRUENC_PUB_KEY *pub_key)
+int test_ntruenc_sort()
 {
-    int i;
-    uint64_t start, end, diff;
-    int num_ops;
-    unsigned char *enc;
-    int elen;
-
-    NTRUENC_PUB_KEY_get_enc_len(pub_key, &elen);
-    enc = malloc(elen);
-
-    NTRUENC_encrypt_init(ne, pub_key);
-
-    /* Prime the caches, etc */
-    for (i=0; i<200; i++)
-        NTRUENC_encrypt(ne, data, len, enc, elen);
-
-    /* Approximate number of ops in a second. */
-    start = get_cycles();
-    for (i=0; i<100; i++)
-        NTRUENC_encrypt(ne, data, len, enc, elen);
-    end = get_cycles();
-    num_ops = cps/((end-start)/100);
-
-    /* Perform about 1 seconds worth of operations. */
-    start = get_cycles();
-    for (i=0; i<num_ops; i++)
-        NTRUENC_encrypt(ne, data, len, enc, elen);
-    end = get_cycles();
-
-    diff = end - start;
+    int ret = 0;
+    int i, j, k;
+    uint64_t x = 0x853c49e6748fea9bUL;
+    int32_t *v = NULL;
+    int32_t *s[2] = { NULL, NULL };
+    static const int n[] = { 0, 1, 2, 3, 7, 31, 32, 33, 401, 439, 593, 743,
+        1023, 1024, 1025, 2000 };
+    static const int off[2] = { NTRU_SIMD_ALL, 0 };
 
-    printf("enc: %7d %2.3f  %7"PRIu64" %6"PRIu64"\n", num_ops, diff/(cps*1.0),
-        diff/num_ops, cps/(diff/num_ops));
+    v = malloc(2000 * sizeof(*v));
+    s[0] = malloc(2000 * sizeof(*v));
+    s[1] = malloc(2000 * sizeof(*v));
+    if ((v == NULL) || (s[0] == NULL) || (s[1] == NULL))
+    {
+        ret = 1;
+        goto end;
+    }
 
-    NTRUENC_encrypt_final(ne);
+    for (i=0; i<(int)(sizeof(n)/sizeof(*n)) && ret==0; i++)
+    {
+        for (j=0; j<n[i]; j++)
+        {
+            v[j] = (int32_t)test_next64(&x);
+            /* Small values give duplicates. */
+            if (j & 1)
+                v[j] &= 0xf;
+        }
+        if (n[i] > 2)
+        {
+            v[0] = INT32_MAX;
+            v[n[i]-1] = INT32_MIN;
+        }
 
-    free(enc);
+        for (k=0; k<2; k++)
+        {
+            memcpy(s[k], v, n[i] * sizeof(*v));
+            ntruenc_simd_off = off[k];
+            ntruenc_sort_int32(s[k], n[i]);
+        }
+        qsort(v, n[i], sizeof(*v), test_cmp_int32);
+        for (k=0; k<2; k++)
+        {
+            if (memcmp(s[k], v, n[i] * sizeof(*v)) != 0)
+                ret = 1;
+        }
+    }
+end:
+    ntruenc_simd_off = 0;
+    fprintf(stderr, ", sort: %d", ret);
+    if (s[1] != NULL) free(s[1]);
+    if (s[0] != NULL) free(s[0]);
+    if (v != NULL) free(v);
+    return ret;
 }
 
 /*
- * Determine the number of decryption operations that can be performed per
- * second.
+ * Test that sampled vectors have exactly df elements of v and of -v, and
+ * that the AVX2 and C sorts sample the same vector from the same seed.
  *
- * @param [in] ne        The NTRU Encryption operation object.
- * @param [in] enc       Encrypted data.
- * @param [in] elen      The length of the encrypted data.
- * @param [in] priv_key  The private key.
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
  */
-void dec_cycles(NTRUENC *ne, unsigned char *enc, int elen,
-    NTRUENC_PRIV_KEY *priv_key)
+int test_ntruenc_sample_weight()
 {
-    int i;
-    uint64_t start, end, diff;
-    int num_ops;
-    unsigned char *dec;
-    int len;
-    int olen;
-    int n;
+    int ret = 0;
+    int i, j, k, t;
+    int cnt[3];
+    NTRUENC_METHS *meths;
+    NTRU_DRBG drbg;
+    short a[2][NTRU_S256_N];
+    unsigned char seed[1];
+    static const int off[2] = { NTRU_SIMD_ALL, 0 };
+    static const struct
+    {
+        int strength;
+        int n;
+        int df;
+        int q;
+    } p[] =
+    {
+        { 112, NTRU_S112_N, NTRU_S112_DF, NTRU_S112_Q },
+        { 128, NTRU_S128_N, NTRU_S128_DF, NTRU_S128_Q },
+        { 192, NTRU_S192_N, NTRU_S192_DF, NTRU_S192_Q },
+        { 256, NTRU_S256_N, NTRU_S256_DF, NTRU_S256_Q },
+    };
 
-    NTRUENC_PRIV_KEY_num_entries(priv_key, &n);
-    len = (n + 7) / 8;
-    dec = malloc(len);
+    for (i=0; i<(int)(sizeof(p)/sizeof(*p)) && ret==0; i++)
+    {
+        ret = ntruenc_meths_get(p[i].strength, 0, &meths);
+        for (t=0; t<8 && ret==0; t++)
+        {
+            seed[0] = t;
+            for (k=0; k<2 && ret==0; k++)
+            {
+                ntru_drbg_seed(&drbg, seed, sizeof(seed));
+                ntruenc_simd_off = off[k];
+                ret = meths->random(a[k], p[i].df, p[i].df, 1, &drbg);
+                ntru_drbg_final(&drbg);
+            }
 
-    NTRUENC_decrypt_init(ne, priv_key);
+            cnt[0] = cnt[1] = cnt[2] = 0;
+            for (j=0; j<p[i].n; j++)
+            {
+                if (a[1][j] == 0)
+                    cnt[0]++;
+                else if (a[1][j] == 1)
+                    cnt[1]++;
+                else if (a[1][j] == p[i].q - 1)
+                    cnt[2]++;
+            }
+            if ((cnt[1] != p[i].df) || (cnt[2] != p[i].df) ||
+                (cnt[0] != p[i].n - 2 * p[i].df) ||
+                (memcmp(a[0], a[1], p[i].n * sizeof(short)) != 0))
+            {
+                ret = 1;
+            }
+        }
+    }
+    ntruenc_simd_off = 0;
+    fprintf(stderr, ", sample weight: %d", ret);
 
-    /* Prime the caches, etc */
-    for (i=0; i<200; i++)
-        NTRUENC_decrypt(ne, enc, elen, dec, len, &olen);
+    return ret;
+}
 
-    /* Approximate number of ops in a second. */
-    start = get_cycles();
-    for (i=0; i<100; i++)
-        NTRUENC_decrypt(ne, enc, elen, dec, len, &olen);
-    end = get_cycles();
-    num_ops = cps/((end-start)/100);
+/*
+ * Test the DRBG: seeding is deterministic, the reseed interval is honoured
+ * and a forked child doesn't repeat the parent's output.
+ *
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
+ */
+int test_ntru_drbg()
+{
+    int ret = 0;
+    int fd[2] = { -1, -1 };
+    pid_t pid;
+    int status;
+    NTRU_DRBG drbg[2];
+    unsigned char seed[2] = { 1, 2 };
+    unsigned char key[NTRU_DRBG_KEY_LEN];
+    unsigned char r[3][64];
 
-    /* Perform about 1 seconds worth of operations. */
-    start = get_cycles();
-    for (i=0; i<num_ops; i++)
-        NTRUENC_decrypt(ne, enc, elen, dec, len, &olen);
-    end = get_cycles();
+    /* Same seed gives the same output and a different seed doesn't. */
+    ntru_drbg_seed(&drbg[0], seed, 1);
+    ntru_drbg_seed(&drbg[1], seed, 1);
+    ntru_drbg_generate(&drbg[0], r[0], sizeof(r[0]));
+    ntru_drbg_generate(&drbg[1], r[1], sizeof(r[1]));
+    if (memcmp(r[0], r[1], sizeof(r[0])) != 0)
+        ret = 1;
+    ntru_drbg_seed(&drbg[1], seed + 1, 1);
+    ntru_drbg_generate(&drbg[1], r[1], sizeof(r[1]));
+    if (memcmp(r[0], r[1], sizeof(r[0])) == 0)
+        ret = 1;
 
-    diff = end - start;
+    /* A seeded DRBG is never reseeded. */
+    drbg[0].cnt = NTRU_DRBG_RESEED_INTERVAL;
+    drbg[0].pos = NTRU_DRBG_BUF_LEN;
+    ntru_drbg_generate(&drbg[0], r[0], 1);
+    if (drbg[0].cnt != NTRU_DRBG_RESEED_INTERVAL + 1)
+        ret = 1;
+    ntru_drbg_final(&drbg[0]);
+    ntru_drbg_final(&drbg[1]);
 
-    printf("dec: %7d %2.3f  %7"PRIu64" %6"PRIu64"\n", num_ops, diff/(cps*1.0),
-        diff/num_ops, cps/(diff/num_ops));
+    /* Refilling at the reseed interval mixes in new entropy first. */
+    if ((ret == 0) && (ntru_drbg_init(&drbg[0]) != 0))
+        ret = 1;
+    if (ret == 0)
+    {
+        memcpy(key, drbg[0].key, sizeof(key));
+        drbg[0].cnt = NTRU_DRBG_RESEED_INTERVAL;
+        drbg[0].pos = NTRU_DRBG_BUF_LEN;
+        if ((ntru_drbg_generate(&drbg[0], r[0], 1) != 0) ||
+            (drbg[0].cnt != 1) || (memcmp(drbg[0].key, key, sizeof(key)) == 0))
+        {
+            ret = 1;
+        }
+    }
 
-    NTRUENC_decrypt_final(ne);
+    /* Child's output must not be what the parent generates next. */
+    if ((ret == 0) && (pipe(fd) != 0))
+        ret = 1;
+    if (ret == 0)
+    {
+        pid = fork();
+        if (pid == 0)
+        {
+            status = ntru_drbg_generate(&drbg[0], r[2], sizeof(r[2]));
+            if ((status != 0) ||
+                (write(fd[1], r[2], sizeof(r[2])) != (ssize_t)sizeof(r[2])))
+            {
+                _exit(1);
+            }
+            _exit(0);
+        }
+        /* Reading gets end of file if the child exits without writing. */
+        close(fd[1]);
+        fd[1] = -1;
+        if ((pid < 0) ||
+            (ntru_drbg_generate(&drbg[0], r[1], sizeof(r[1])) != 0) ||
+            (read(fd[0], r[2], sizeof(r[2])) != (ssize_t)sizeof(r[2])) ||
+            (waitpid(pid, &status, 0) != pid) || (status != 0) ||
+            (memcmp(r[1], r[2], sizeof(r[1])) == 0))
+        {
+            ret = 1;
+        }
+    }
+    if (fd[0] >= 0) close(fd[0]);
+    if (fd[1] >= 0) close(fd[1]);
+    ntru_drbg_final(&drbg[0]);
+    fprintf(stderr, ", DRBG: %d", ret);
 
-    free(dec);
+    return ret;
 }
 
 /*
- * Determine the number of key generation operations that can be performed per
- * second.
+ * Test that the DRBG's output doesn't depend on how requests line up with
+ * its buffer.
+ * Output generated in one call is compared with output generated in pieces
+ * that end just before, at and just after the end of the buffer.
  *
- * @param [in] priv_key  The public key.
- * @param [in] pub_key   The public key.
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
  */
-void keygen_cycles(NTRUENC *ne, NTRUENC_PARAMS *params,
-    NTRUENC_PRIV_KEY *priv_key, NTRUENC_PUB_KEY *pub_key)
+int test_ntru_drbg_buffer()
 {
-    int i;
-    uint64_t start, end, diff;
-    int num_ops;
-
-    NTRUENC_keygen_init(ne, params);
-    /* Prime the caches, etc */
-    for (i=0; i<100; i++)
-        NTRUENC_keygen(ne, &priv_key, &pub_key);
-
-    /* Approximate number of ops in a second. */
-    start = get_cycles();
-    for (i=0; i<100; i++)
-        NTRUENC_keygen(ne, &priv_key, &pub_key);
-    end = get_cycles();
-    num_ops = cps/((end-start)/100);
+    int ret = 0;
+    int i, o;
+    NTRU_DRBG drbg;
+    unsigned char seed[1] = { 3 };
+    unsigned char *r[2] = { NULL, NULL };
+    /* Bytes handed out between refills. */
+    const int avail = NTRU_DRBG_BUF_LEN - NTRU_DRBG_KEY_LEN;
+    const int len = 4 * avail + 17;
+    const int piece[] = { 0, 1, avail - 2, 1, 1, avail, avail + 1, 5, 0 };
 
-    /* Perform about 1 seconds worth of operations. */
-    start = get_cycles();
-    for (i=0; i<num_ops; i++)
-        NTRUENC_keygen(ne, &priv_key, &pub_key);
-    end = get_cycles();
+    r[0] = malloc(len);
+    r[1] = malloc(len);
+    if ((r[0] == NULL) || (r[1] == NULL))
+    {
+        ret = 1;
+        goto end;
+    }
 
-    diff = end - start;
+    ntru_drbg_seed(&drbg, seed, sizeof(seed));
+    ret = ntru_drbg_generate(&drbg, r[0], len);
+    ntru_drbg_final(&drbg);
 
-    printf("kgn: %7d %2.3f  %7"PRIu64" %6"PRIu64"\n", num_ops, diff/(cps*1.0),
-        diff/num_ops, cps/(diff/num_ops));
+    ntru_drbg_seed(&drbg, seed, sizeof(seed));
+    for (i=0,o=0; i<(int)(sizeof(piece)/sizeof(*piece)) && ret==0; i++)
+    {
+        ret = ntru_drbg_generate(&drbg, r[1] + o, piece[i]);
+        o += piece[i];
+    }
+    if (ret == 0)
+        ret = ntru_drbg_generate(&drbg, r[1] + o, len - o);
+    ntru_drbg_final(&drbg);
 
-    NTRUENC_keygen_final(ne);
+    if ((ret == 0) && (memcmp(r[0], r[1], len) != 0))
+        ret = 1;
+end:
+    fprintf(stderr, ", DRBG buffer: %d", ret);
+    if (r[1] != NULL) free(r[1]);
+    if (r[0] != NULL) free(r[0]);
+    return ret;
 }
 
 /*
- * Generate a random vector as the hash.
+ * Test the cryptographic primitives that don't depend on the strength.
  *
- * @param [in] msg       The message buffer.
- * @param [in] len       The length of the buffer.
+ * @return  0 on successful testing.<br>
+ *          1 otherwise.
  */
-int random_data(unsigned char *msg, int len)
+int test_ntru_primitives()
 {
-    return pseudo_random(msg, len);
+    int ret;
+
+    printf("Primitives\n");
+
+    ret = test_ntru_keccak_impl();
+    if (ret == 0)
+        ret = test_ntru_shake256_kat();
+    if (ret == 0)
+        ret = test_ntru_turboshake128_kat();
+    if (ret == 0)
+        ret = test_ntru_shake_xn();
+    if (ret == 0)
+        ret = test_ntru_aes256_ctr();
+    if (ret == 0)
+        ret = test_ntruenc_msg_simd();
+    if (ret == 0)
+        ret = test_ntruenc_pack_simd();
+    if (ret == 0)
+        ret = test_ntruenc_sort();
+    if (ret == 0)
+        ret = test_ntruenc_sample_weight();
+    if (ret == 0)
+        ret = test_ntru_drbg();
+    if (ret == 0)
+        ret = test_ntru_drbg_buffer();
+
+    printf("\n");
+
+    return ret;
 }
 
 /*
@@ -354,6 +2383,65 @@ int test_ntruenc(int strength, int flags, int speed)
     }
     fprintf(stderr, ",%d", olen);
 
+    /* Buffer too short for the message. */
+    ret = NTRUENC_decrypt_init(ne, priv_key);
+    if (ret == 0)
+    {
+        ret = (NTRUENC_decrypt(ne, enc, elen, dec, len - 1, &olen) !=
+               NTRU_ERR_BAD_LEN);
+    }
+    NTRUENC_decrypt_final(ne);
+    fprintf(stderr, ", dec short: %d", ret);
+    if (ret != 0)
+        goto end;
+
+    ret = test_ntruenc_vec_layout(priv_key, pub_key);
+    if (ret != 0)
+        goto end;
+
+    ret = test_ntruenc_arena(ne, pub_key, priv_key, data, len);
+    if (ret != 0)
+        goto end;
+
+    ret = test_ntruenc_seeded(ne, params, data, len);
+    if (ret != 0)
+        goto end;
+
+    ret = test_ntruenc_seeded_kat(ne, params, strength);
+    if (ret != 0)
+        goto end;
+
+#ifndef NTRUENC_STATIC
+    ret = test_ntruenc_precompute(ne, pub_key, priv_key, data, len);
+    if (ret != 0)
+        goto end;
+#endif
+
+    ret = test_ntruenc_format(ne, params, pub_key_gen, priv_key_gen, data,
+        len);
+    if (ret != 0)
+        goto end;
+
+#ifndef NTRUENC_STATIC
+    ret = test_ntruenc_store(ne, params, pub_key, priv_key, data, len);
+    if (ret != 0)
+        goto end;
+
+    ret = test_ntruenc_batch(ne, params, pub_key, priv_key, data, len);
+    if (ret != 0)
+        goto end;
+#endif
+
+    ret = test_ntruenc_msg_trits(ne, pub_key, priv_key);
+    if (ret != 0)
+        goto end;
+
+#ifndef NTRUENC_STATIC
+    ret = test_ntruenc_prep(strength, pub_key, priv_key, data, len);
+    if (ret != 0)
+        goto end;
+#endif
+
     if (speed)
     {
         printf("\n");
@@ -420,9 +2508,16 @@ int main(int argc, char *argv[])
     if (speed)
         calc_cps();
 
+    ret = test_ntru_primitives();
+
     /* Test all  */
     for (i=0; i<VALID_NUM; i++)
     {
+#ifdef NTRUENC_STATIC
+        /* Objects only have storage for the configured strength. */
+        if (valid[i] > NTRUENC_STATIC_STRENGTH)
+            continue;
+#endif
         if ((which == 0) || ((which & (1<<i)) != 0))
             ret |= test_ntruenc(valid[i], flags, speed);
     }